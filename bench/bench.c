@@ -0,0 +1,286 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <uv.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
+#include <rutabaga/surface.h>
+#include <rutabaga/layout.h>
+#include <rutabaga/opengl.h>
+
+#include "bench.h"
+
+#define DEFAULT_REPS  5
+#define MAX_REPS      100
+
+/**
+ * output
+ *
+ * every result is one JSON object on a line of its own, so the output
+ * can be diffed, grepped, or fed to whatever is tracking the numbers.
+ */
+
+static void
+print_json_string(const char *str)
+{
+	putchar('"');
+
+	for (; str && *str; str++) {
+		if (*str == '"' || *str == '\\')
+			printf("\\%c", *str);
+		else if ((unsigned char) *str < 0x20)
+			printf("\\u%04x", *str);
+		else
+			putchar(*str);
+	}
+
+	putchar('"');
+}
+
+static void
+print_environment(struct bench_env *env)
+{
+	printf("{\"gl_vendor\": ");
+	print_json_string((const char *) glGetString(GL_VENDOR));
+	printf(", \"gl_renderer\": ");
+	print_json_string((const char *) glGetString(GL_RENDERER));
+	printf(", \"gl_version\": ");
+	print_json_string((const char *) glGetString(GL_VERSION));
+	printf(", \"window\": [%d, %d], \"reps\": %d}\n",
+			(int) env->win->w, (int) env->win->h, env->reps);
+}
+
+static int
+cmp_u64(const void *_a, const void *_b)
+{
+	const uint64_t *a = _a, *b = _b;
+	return (*a > *b) - (*a < *b);
+}
+
+static void
+report(const struct bench *b, unsigned long ops,
+		uint64_t *samples, int nsamples)
+{
+	qsort(samples, nsamples, sizeof(*samples), cmp_u64);
+
+	printf("{\"name\": ");
+	print_json_string(b->name);
+	printf(", \"ops\": %lu, \"reps\": %d, "
+			"\"min_ns\": %.1f, \"median_ns\": %.1f, \"max_ns\": %.1f}\n",
+			ops, nsamples,
+			samples[0] / (double) ops,
+			samples[nsamples / 2] / (double) ops,
+			samples[nsamples - 1] / (double) ops);
+
+	fflush(stdout);
+}
+
+/**
+ * public API
+ */
+
+uint64_t
+bench_now(void)
+{
+	return uv_hrtime();
+}
+
+int
+bench_enabled(struct bench_env *env, const char *name)
+{
+	int i;
+
+	if (!env->nfilters)
+		return 1;
+
+	for (i = 0; i < env->nfilters; i++)
+		if (strstr(name, env->filters[i]))
+			return 1;
+
+	return 0;
+}
+
+void
+bench_run(struct bench_env *env, const struct bench *b, void *ctx)
+{
+	uint64_t samples[MAX_REPS], start;
+	unsigned long ops = 0;
+	int rep, reps;
+
+	if (!bench_enabled(env, b->name))
+		return;
+
+	reps = b->once ? 1 : env->reps;
+
+	/* the first go is a warmup. it takes the hit for glyphs being
+	 * rasterised, caches being filled, and so on. */
+	for (rep = b->once ? 0 : -1; rep < reps; rep++) {
+		if (b->setup)
+			b->setup(env, ctx);
+
+		start = bench_now();
+		ops = b->run(env, ctx);
+
+		if (rep >= 0)
+			samples[rep] = bench_now() - start;
+
+		if (b->teardown)
+			b->teardown(env, ctx);
+	}
+
+	if (ops)
+		report(b, ops, samples, reps);
+}
+
+void
+bench_run_on_tree(struct bench_env *env, bench_tree_kind_t kind,
+		const struct bench *benches, size_t nbenches)
+{
+	struct bench_tree *tree;
+	struct bench named;
+	char name[128];
+	size_t i;
+
+	for (i = 0; i < nbenches; i++) {
+		named = benches[i];
+
+		snprintf(name, sizeof(name), "%s/%s",
+				benches[i].name, bench_tree_name(kind));
+		named.name = name;
+
+		/* the tree is only built if something's going to use it. */
+		if (!bench_enabled(env, name) || !(tree = bench_tree_get(env, kind)))
+			continue;
+
+		bench_run(env, &named, tree);
+	}
+}
+
+void
+bench_draw_frame(struct bench_env *env, int full)
+{
+	struct rtb_window *win = env->win;
+
+	if (win->state == RTB_STATE_UNATTACHED || win->need_reconfigure) {
+		rtb_window_reinit(win);
+		win->need_reconfigure = 0;
+	}
+
+	if (full) {
+		rtb_surface_invalidate(RTB_SURFACE(win));
+		win->buffer_age = 0;
+	} else
+		win->buffer_age = 1;
+
+	rtb_window_draw(win, 0);
+	glFinish();
+}
+
+/**
+ * main
+ */
+
+static void
+usage(const char *argv0)
+{
+	fprintf(stderr,
+			"usage: %s [-r reps] [filter...]\n\n"
+			"runs every benchmark whose name contains one of the filters,\n"
+			"or all of them if there aren't any. results are printed as\n"
+			"one JSON object per line, with timings in nanoseconds per\n"
+			"operation.\n", argv0);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct bench_env env = {
+		.reps = DEFAULT_REPS
+	};
+
+	int opt;
+
+	while ((opt = getopt(argc, argv, "hr:")) != -1) {
+		switch (opt) {
+		case 'r':
+			env.reps = atoi(optarg);
+			if (env.reps < 1 || env.reps > MAX_REPS) {
+				fprintf(stderr, "rtb-bench: reps has to be 1-%d\n", MAX_REPS);
+				return EXIT_FAILURE;
+			}
+
+			break;
+
+		default:
+			usage(argv[0]);
+			return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	env.filters = &argv[optind];
+	env.nfilters = argc - optind;
+
+	if (!(env.rtb = rtb_new())) {
+		fprintf(stderr, "rtb-bench: couldn't initialise rutabaga\n");
+		return EXIT_FAILURE;
+	}
+
+	if (!(env.win = rtb_window_open(env.rtb, 1024, 768, "rtb-bench"))) {
+		fprintf(stderr, "rtb-bench: couldn't open a window\n");
+		rtb_free(env.rtb);
+		return EXIT_FAILURE;
+	}
+
+	/* the trees are laid on top of each other, at the window's origin.
+	 * see bench_tree_get(). */
+	rtb_elem_set_layout(RTB_ELEMENT(env.win), rtb_layout_unmanaged);
+
+	/* there's no event loop. everything happens on this thread, the
+	 * same way it would inside of an event handler. */
+	rtb_window_lock(env.win);
+	bench_draw_frame(&env, 1);
+
+	print_environment(&env);
+
+	bench_tree_suite(&env);
+	bench_style_suite(&env);
+	bench_event_suite(&env);
+	bench_text_suite(&env);
+	bench_frame_suite(&env);
+
+	bench_trees_free(&env);
+	rtb_window_close(env.win);
+	rtb_free(env.rtb);
+
+	return EXIT_SUCCESS;
+}
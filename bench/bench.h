@@ -0,0 +1,174 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/element.h>
+#include <rutabaga/window.h>
+
+#define ARRAY_LENGTH(a) (sizeof(a) / sizeof(*a))
+
+/**
+ * synthetic element trees
+ */
+
+typedef enum {
+	/* 10,000 knobs in one container. */
+	BENCH_TREE_KNOBS,
+
+	/* 256 containers, each nested in the last, with a knob at the
+	 * bottom. */
+	BENCH_TREE_DEEP,
+
+	/* 10 hpack rows of 100 buttons each. */
+	BENCH_TREE_WIDE,
+
+	/* a patchbay with 2,000 nodes, each with an input and an output
+	 * port, chained together with patches. */
+	BENCH_TREE_PATCHBAY,
+
+	/* 10 hpack rows of 50 knobs and 50 buttons, in turn, so that
+	 * neighbouring widgets are drawn with different style images. */
+	BENCH_TREE_MIXED,
+
+	BENCH_TREE_KIND_COUNT
+} bench_tree_kind_t;
+
+struct bench_tree_obj {
+	struct rtb_element *elem;
+	void (*free)(struct rtb_element *);
+};
+
+struct bench_tree {
+	bench_tree_kind_t kind;
+	struct rtb_element *root;
+
+	/* the element furthest from the root, for rootward reflows and the
+	 * like. */
+	struct rtb_element *deepest;
+
+	/* every element the tree allocated, in the order they were added. */
+	struct bench_tree_obj *objs;
+	size_t nobjs;
+	size_t objs_size;
+
+	/* elements of the same kind that are spread out across the tree,
+	 * for hit testing and per-element queries. */
+	struct rtb_element **leaves;
+	size_t nleaves;
+};
+
+/**
+ * structures
+ */
+
+struct bench_env {
+	struct rutabaga *rtb;
+	struct rtb_window *win;
+
+	int reps;
+	char **filters;
+	int nfilters;
+
+	/* built the first time they're needed, and kept around (attached to
+	 * the window) for the rest of the run, since the bigger ones take a
+	 * while to put together. */
+	struct bench_tree *trees[BENCH_TREE_KIND_COUNT];
+};
+
+struct bench {
+	const char *name;
+
+	/* setup and teardown are called around every repetition and aren't
+	 * timed. either can be NULL. */
+	void (*setup)(struct bench_env *, void *ctx);
+	void (*teardown)(struct bench_env *, void *ctx);
+
+	/* returns how many operations it did. timings are reported per
+	 * operation. */
+	unsigned long (*run)(struct bench_env *, void *ctx);
+
+	/* if set, the benchmark is run once, cold, no matter how many
+	 * repetitions were asked for. for the ones that are slow enough
+	 * that repeating them doesn't tell you much more. */
+	int once;
+};
+
+/**
+ * trees
+ */
+
+/* allocates the tree's elements. the root isn't added to anything. */
+int bench_tree_build(struct bench_env *, struct bench_tree *,
+		bench_tree_kind_t);
+
+/* adds the tree's root to the window and lays it out. */
+void bench_tree_attach(struct bench_env *, struct bench_tree *);
+
+/* detaches the tree (if it was attached) and frees everything. */
+void bench_tree_free(struct bench_env *, struct bench_tree *);
+
+/* the shared, attached tree of the given kind, which is made the only
+ * visible one. NULL if it couldn't be built. */
+struct bench_tree *bench_tree_get(struct bench_env *, bench_tree_kind_t);
+void bench_trees_free(struct bench_env *);
+
+const char *bench_tree_name(bench_tree_kind_t);
+
+/**
+ * public API
+ */
+
+int bench_enabled(struct bench_env *, const char *name);
+void bench_run(struct bench_env *, const struct bench *, void *ctx);
+
+/* runs each of the benchmarks against the shared tree of the given kind,
+ * which is passed as `ctx`. the tree's name is appended to each
+ * benchmark's. */
+void bench_run_on_tree(struct bench_env *, bench_tree_kind_t,
+		const struct bench *, size_t nbenches);
+
+/* lays out the window if it needs it, draws a frame and waits for the
+ * GPU to finish. if `full` is set, everything in the window is redrawn,
+ * otherwise only what's been damaged. */
+void bench_draw_frame(struct bench_env *, int full);
+
+uint64_t bench_now(void);
+
+/**
+ * suites
+ */
+
+void bench_tree_suite(struct bench_env *);
+void bench_style_suite(struct bench_env *);
+void bench_event_suite(struct bench_env *);
+void bench_text_suite(struct bench_env *);
+void bench_frame_suite(struct bench_env *);
@@ -0,0 +1,132 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/element.h>
+#include <rutabaga/window.h>
+#include <rutabaga/platform.h>
+#include <rutabaga/mouse.h>
+
+#include "bench.h"
+
+#define MOTIONS  1000
+#define CLICKS   100
+
+static void
+leaf_center(struct bench_tree *tree, unsigned long i, int *x, int *y)
+{
+	struct rtb_element *leaf;
+
+	/* step through the leaves with a stride that's coprime to any
+	 * plausible count, so that successive targets are far apart. */
+	leaf = tree->leaves[(i * 7919) % tree->nleaves];
+
+	*x = leaf->x + (leaf->w / 2.f);
+	*y = leaf->y + (leaf->h / 2.f);
+}
+
+static void
+pointer_setup(struct bench_env *env, void *ctx)
+{
+	rtb__platform_mouse_enter_window(env->win,
+			env->win->w - 1, env->win->h - 1);
+}
+
+static void
+pointer_teardown(struct bench_env *env, void *ctx)
+{
+	rtb__platform_mouse_leave_window(env->win,
+			env->win->w - 1, env->win->h - 1);
+}
+
+static unsigned long
+motion(struct bench_env *env, void *ctx)
+{
+	struct bench_tree *tree = ctx;
+	unsigned long i;
+	int x, y;
+
+	/* every other motion is into the bottom right corner of the window,
+	 * which none of the trees reach, so each one has a full retarget()
+	 * to do: leave events all the way up, then enter events all the way
+	 * down. */
+	for (i = 0; i < MOTIONS; i += 2) {
+		leaf_center(tree, i, &x, &y);
+		rtb__platform_mouse_motion(env->win, x, y);
+		rtb__platform_mouse_motion(env->win,
+				env->win->w - 1, env->win->h - 1);
+	}
+
+	return MOTIONS;
+}
+
+static unsigned long
+click(struct bench_env *env, void *ctx)
+{
+	struct bench_tree *tree = ctx;
+	unsigned long i;
+	int x, y;
+
+	for (i = 0; i < CLICKS; i++) {
+		leaf_center(tree, i, &x, &y);
+
+		rtb__platform_mouse_motion(env->win, x, y);
+		rtb__platform_mouse_press(env->win, RTB_MOUSE_BUTTON1, x, y);
+		rtb__platform_mouse_release(env->win, RTB_MOUSE_BUTTON1, x, y);
+	}
+
+	return CLICKS;
+}
+
+/**
+ * suite
+ */
+
+void
+bench_event_suite(struct bench_env *env)
+{
+	static const struct bench on_tree[] = {
+		{
+			.name     = "event/motion",
+			.setup    = pointer_setup,
+			.run      = motion,
+			.teardown = pointer_teardown
+		},
+
+		{
+			.name     = "event/click",
+			.setup    = pointer_setup,
+			.run      = click,
+			.teardown = pointer_teardown
+		}
+	};
+
+	int kind;
+
+	for (kind = 0; kind < BENCH_TREE_KIND_COUNT; kind++)
+		bench_run_on_tree(env, kind, on_tree, ARRAY_LENGTH(on_tree));
+}
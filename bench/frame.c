@@ -0,0 +1,136 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/element.h>
+#include <rutabaga/window.h>
+#include <rutabaga/surface.h>
+
+#include "bench.h"
+
+#define FRAMES  20
+
+/* the window's batch numbers over the last repetition of "frame/full"
+ * on each tree. */
+static struct {
+	unsigned long frames;
+	unsigned long submitted;
+	unsigned long draw_calls;
+} full_batch[BENCH_TREE_KIND_COUNT];
+
+static unsigned long
+full_frame(struct bench_env *env, void *ctx)
+{
+	struct bench_tree *tree = ctx;
+	const struct rtb_render_batch *batch;
+	unsigned long submitted, draw_calls;
+	int i;
+
+	batch = &RTB_SURFACE(env->win)->render_ctx.batch;
+	submitted  = batch->stats.submitted;
+	draw_calls = batch->stats.draw_calls;
+
+	for (i = 0; i < FRAMES; i++)
+		bench_draw_frame(env, 1);
+
+	full_batch[tree->kind].frames     = FRAMES;
+	full_batch[tree->kind].submitted  = batch->stats.submitted - submitted;
+	full_batch[tree->kind].draw_calls = batch->stats.draw_calls - draw_calls;
+
+	return FRAMES;
+}
+
+static unsigned long
+damaged_frame(struct bench_env *env, void *ctx)
+{
+	struct bench_tree *tree = ctx;
+	int i;
+
+	/* one element changing per frame, like a meter or a knob being
+	 * turned. */
+	for (i = 0; i < FRAMES; i++) {
+		rtb_elem_mark_dirty(tree->leaves[(i * 7919) % tree->nleaves]);
+		bench_draw_frame(env, 0);
+	}
+
+	return FRAMES;
+}
+
+static unsigned long
+idle_frame(struct bench_env *env, void *ctx)
+{
+	int i;
+
+	/* nothing's dirty, so this is the cost of checking. */
+	for (i = 0; i < FRAMES; i++)
+		bench_draw_frame(env, 0);
+
+	return FRAMES;
+}
+
+/* how many draws a full frame submits to the batch, and how many draw
+ * calls they're merged into. */
+static void
+report_batch(bench_tree_kind_t kind)
+{
+	unsigned long frames = full_batch[kind].frames;
+
+	if (!frames)
+		return;
+
+	printf("{\"name\": \"frame/full/%s/batch\", "
+			"\"submitted_per_frame\": %lu, "
+			"\"draw_calls_per_frame\": %lu}\n",
+			bench_tree_name(kind),
+			full_batch[kind].submitted / frames,
+			full_batch[kind].draw_calls / frames);
+
+	fflush(stdout);
+}
+
+/**
+ * suite
+ */
+
+void
+bench_frame_suite(struct bench_env *env)
+{
+	static const struct bench on_tree[] = {
+		{.name = "frame/full",    .run = full_frame},
+		{.name = "frame/damaged", .run = damaged_frame},
+		{.name = "frame/idle",    .run = idle_frame}
+	};
+
+	int kind;
+
+	for (kind = 0; kind < BENCH_TREE_KIND_COUNT; kind++) {
+		bench_run_on_tree(env, kind, on_tree, ARRAY_LENGTH(on_tree));
+		report_batch(kind);
+	}
+}
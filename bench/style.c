@@ -0,0 +1,153 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/element.h>
+#include <rutabaga/window.h>
+#include <rutabaga/atom.h>
+#include <rutabaga/style.h>
+
+#include "bench.h"
+
+#define QUERY_PASSES  10
+#define TYPE_REFS     100000
+#define TYPE_PASSES   10
+
+/**
+ * property queries
+ */
+
+static unsigned long
+query_prop(struct bench_env *env, void *ctx)
+{
+	struct bench_tree *tree = ctx;
+	size_t i;
+	int pass;
+
+	for (pass = 0; pass < QUERY_PASSES; pass++)
+		for (i = 0; i < tree->nleaves; i++)
+			rtb_style_query_prop(tree->leaves[i],
+					"background-color", RTB_STYLE_PROP_COLOR, 1);
+
+	return QUERY_PASSES * tree->nleaves;
+}
+
+static unsigned long
+query_prop_in_tree(struct bench_env *env, void *ctx)
+{
+	struct bench_tree *tree = ctx;
+	int pass;
+
+	/* this walks all the way up from the leaf looking for a font, which
+	 * is what labels do when they're restyled. */
+	for (pass = 0; pass < QUERY_PASSES; pass++)
+		rtb_style_query_prop_in_tree(tree->deepest,
+				"font", RTB_STYLE_PROP_FONT, 1);
+
+	return QUERY_PASSES;
+}
+
+/**
+ * types
+ */
+
+static unsigned long
+type_ref(struct bench_env *env, void *ctx)
+{
+	struct rtb_type_atom_descriptor *elem, *knob;
+	int i;
+
+	/* what every knob does when it's attached. the unref takes the
+	 * whole chain back down. */
+	for (i = 0; i < TYPE_REFS; i++) {
+		elem = rtb_type_ref(env->win, NULL, "net.illest.rutabaga.element");
+		knob = rtb_type_ref(env->win, elem,
+				"net.illest.rutabaga.widgets.knob");
+		rtb_type_unref(knob);
+	}
+
+	return TYPE_REFS;
+}
+
+static unsigned long
+is_type(struct bench_tree *tree, const char *type_name)
+{
+	struct rtb_type_atom_descriptor *desc;
+	size_t i;
+	int pass;
+
+	if (!(desc = rtb_type_lookup(tree->root->window, type_name)))
+		abort();
+
+	for (pass = 0; pass < TYPE_PASSES; pass++)
+		for (i = 0; i < tree->nleaves; i++)
+			rtb_is_type(desc, RTB_TYPE_ATOM(tree->leaves[i]));
+
+	return TYPE_PASSES * tree->nleaves;
+}
+
+static unsigned long
+is_type_hit(struct bench_env *env, void *ctx)
+{
+	/* the root of every type chain, so the walk goes the whole way. */
+	return is_type(ctx, "net.illest.rutabaga.element");
+}
+
+static unsigned long
+is_type_miss(struct bench_env *env, void *ctx)
+{
+	return is_type(ctx, "net.illest.rutabaga.window");
+}
+
+/**
+ * suite
+ */
+
+void
+bench_style_suite(struct bench_env *env)
+{
+	static const struct bench type_refs = {
+		.name = "style/type_ref",
+		.run  = type_ref
+	};
+
+	static const struct bench on_tree[] = {
+		{.name = "style/query_prop",         .run = query_prop},
+		{.name = "style/query_prop_in_tree", .run = query_prop_in_tree},
+		{.name = "style/is_type/hit",        .run = is_type_hit},
+		{.name = "style/is_type/miss",       .run = is_type_miss}
+	};
+
+	int kind;
+
+	bench_run(env, &type_refs, NULL);
+
+	for (kind = 0; kind < BENCH_TREE_KIND_COUNT; kind++)
+		bench_run_on_tree(env, kind, on_tree, ARRAY_LENGTH(on_tree));
+}
@@ -0,0 +1,1286 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <uv.h>
+
+#ifdef RTB_ASSET_XZ
+#include <lzma.h>
+#endif
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/asset.h>
+#include <rutabaga/opengl.h>
+#include <rutabaga/element.h>
+#include <rutabaga/window.h>
+#include <rutabaga/text-object.h>
+#include <rutabaga/text-cache.h>
+#include <rutabaga/style.h>
+
+#include <rutabaga/widgets/label.h>
+
+#include "bench.h"
+
+#define SHORT_UPDATES      1000
+#define PARAGRAPH_UPDATES  100
+#define SET_TEXTS          1000
+
+#define FIELD_CHARS        2000
+#define TYPED_CHARS        200
+
+#define LARGE_FONT_GLYPHS  2000
+#define LARGE_FONT_CHARS   200
+#define LARGE_FONT_UPDATES 100
+
+#define PORTS              3000
+#define PORTS_PER_CLIENT   16
+
+#define ATLAS_GLYPHS       2000
+
+#define PACK_RECTS         10000
+#define PACK_ATLAS_SIZE    4096
+
+#define SHEET_MAX_FONTS    16
+
+#define ASSET_LOADS        100
+
+struct text_state {
+	struct rtb_label *label;
+	struct rtb_text_object *tobj;
+	char *paragraph;
+
+	/* a long, single-line label that gets typed into. */
+	struct rtb_label *field;
+	char field_text[FIELD_CHARS + TYPED_CHARS + 1];
+
+	/* the label's font again, with its own atlas and a couple thousand
+	 * glyphs already loaded, so that glyph lookups have something to
+	 * look through. */
+	struct {
+		struct rtb_font_manager fm;
+		struct rtb_font font;
+		struct rtb_text_object *tobj;
+
+		char *latin1;
+		char *unicode;
+	} large;
+
+	/* a patchbay's worth of port names, "capture_1" and so on, laid
+	 * out either the way every label used to, or through the window's
+	 * text cache. */
+	struct {
+		char names[PORTS][16];
+
+		struct rtb_text_object *tobjs[PORTS];
+		struct rtb_text_run *runs[PORTS];
+
+		/* the cache's stats before the runs were taken, and while
+		 * they were still held. */
+		struct rtb_text_cache_stats before, during;
+	} ports;
+
+	/* a fresh font manager that gets glyphs loaded into it one at a
+	 * time, the way they trickle in while text is typed. */
+	struct {
+		struct rtb_font_manager fm;
+		struct rtb_font font;
+		int loaded;
+
+		rtb_utf32_t codepoints[ATLAS_GLYPHS];
+
+		/* the atlas as the last repetition left it. */
+		size_t uploaded, width, height, depth;
+	} atlas;
+
+	/* glyph-sized rectangles, between CJK at a small UI size and CJK at
+	 * a heading size, packed into an atlas of their own. */
+	struct {
+		ivec2 sizes[PACK_RECTS];
+		ivec4 regions[PACK_RECTS];
+		texture_atlas_t *atlas;
+
+		/* the rectangles' area over the area of the atlas rows they
+		 * ended up using. */
+		double efficiency;
+		int missed;
+	} pack;
+
+	/* the fonts a style sheet asks for, loaded into a font manager of
+	 * their own, once as bitmaps and once as distance fields. */
+	struct sheet {
+		const char *name;
+
+		struct {
+			const void *base;
+			size_t size;
+			int pt_size;
+		} defs[SHEET_MAX_FONTS];
+		int ndefs;
+
+		struct rtb_font_manager fm;
+		struct rtb_font fonts[SHEET_MAX_FONTS];
+		int loaded;
+
+		/* glyph area (in bytes) in the atlas the fonts went into,
+		 * and the size of the whole texture. */
+		size_t bytes[2], texture_bytes[2];
+	} sheets[2], *sheet;
+
+	/* a directory of our own for the glyph cache, which the cold
+	 * benchmarks empty before every repetition. empty if it couldn't
+	 * be made. */
+	char glyph_cache_dir[64];
+
+	/* LARGE_FONT_CHARS of greek and cyrillic, which none of the font's
+	 * glyphs have been loaded for yet, laid out by a fresh font manager,
+	 * the way a paste into a field would be. */
+	struct {
+		struct rtb_font_manager fm;
+		struct rtb_font font;
+		struct rtb_text_object *tobj;
+		int loaded;
+
+		char *text;
+	} paste;
+
+	/* the label's face, written out to be loaded back in as an external
+	 * asset, as it is and xz-compressed. empty if it couldn't be
+	 * written. */
+	char face_path[64];
+	char face_xz_path[64];
+};
+
+static const char *short_strings[] = {
+	"rutabaga",
+	"cabbage patch",
+	"a little longer than that"
+};
+
+static const char *unicode_strings[] = {
+	"naïve café",
+	"Ünïcödé ßtrîñg",
+	"ελληνικά, кириллица"
+};
+
+/**
+ * text objects
+ */
+
+static unsigned long
+update(struct text_state *state, const char **strings, size_t nstrings,
+		int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		rtb_text_object_update(state->tobj, state->label->font,
+				strings[i % nstrings], 1.f);
+
+	return count;
+}
+
+static unsigned long
+update_short(struct bench_env *env, void *ctx)
+{
+	return update(ctx, short_strings, ARRAY_LENGTH(short_strings),
+			SHORT_UPDATES);
+}
+
+static unsigned long
+update_unicode(struct bench_env *env, void *ctx)
+{
+	return update(ctx, unicode_strings, ARRAY_LENGTH(unicode_strings),
+			SHORT_UPDATES);
+}
+
+static unsigned long
+update_paragraph(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	const char *strings[] = {state->paragraph};
+
+	return update(state, strings, 1, PARAGRAPH_UPDATES);
+}
+
+static unsigned long
+update_large_font(struct text_state *state, const char *text)
+{
+	int i;
+
+	if (!state->large.tobj)
+		return 0;
+
+	for (i = 0; i < LARGE_FONT_UPDATES; i++)
+		rtb_text_object_update(state->large.tobj, &state->large.font,
+				text, 1.f);
+
+	return LARGE_FONT_UPDATES;
+}
+
+static unsigned long
+update_large_font_latin1(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	return update_large_font(state, state->large.latin1);
+}
+
+static unsigned long
+update_large_font_unicode(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	return update_large_font(state, state->large.unicode);
+}
+
+/**
+ * labels
+ */
+
+static unsigned long
+label_set_text(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	char buf[32];
+	int i;
+
+	/* the kind of thing a meter readout does: same width every time,
+	 * so there's no reflow, just a redraw. */
+	for (i = 0; i < SET_TEXTS; i++) {
+		snprintf(buf, sizeof(buf), "%.2f dB", (i % 1000) / 100.f);
+		rtb_label_set_text(state->label, buf);
+	}
+
+	return SET_TEXTS;
+}
+
+/**
+ * typing
+ */
+
+static void
+field_setup(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+
+	state->field_text[FIELD_CHARS] = '\0';
+	rtb_label_set_text(state->field, state->field_text);
+}
+
+/* what a text input used to do on every keystroke: set the whole text
+ * again. */
+static unsigned long
+type_set_text(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	int i;
+
+	for (i = 0; i < TYPED_CHARS; i++) {
+		state->field_text[FIELD_CHARS + i] = 'a' + (i % 26);
+		state->field_text[FIELD_CHARS + i + 1] = '\0';
+
+		rtb_label_set_text(state->field, state->field_text);
+	}
+
+	return TYPED_CHARS;
+}
+
+static unsigned long
+type_splice(struct text_state *state, int at)
+{
+	char c[2] = {0, 0};
+	int i;
+
+	for (i = 0; i < TYPED_CHARS; i++) {
+		c[0] = 'a' + (i % 26);
+		rtb_label_splice_text(state->field, at + i, 0, c);
+	}
+
+	return TYPED_CHARS;
+}
+
+static unsigned long
+type_splice_end(struct bench_env *env, void *ctx)
+{
+	return type_splice(ctx, FIELD_CHARS);
+}
+
+static unsigned long
+type_splice_middle(struct bench_env *env, void *ctx)
+{
+	return type_splice(ctx, FIELD_CHARS / 2);
+}
+
+/**
+ * port names
+ */
+
+static unsigned long
+ports_private(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	int i;
+
+	for (i = 0; i < PORTS; i++) {
+		state->ports.tobjs[i] = rtb_text_object_new(&env->win->font_manager);
+		rtb_text_object_update(state->ports.tobjs[i], state->label->font,
+				state->ports.names[i], 1.f);
+	}
+
+	return PORTS;
+}
+
+static void
+ports_private_teardown(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	int i;
+
+	for (i = 0; i < PORTS; i++)
+		rtb_text_object_free(state->ports.tobjs[i]);
+}
+
+static void
+ports_shared_setup(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	state->ports.before = env->win->font_manager.text_cache->stats;
+}
+
+static unsigned long
+ports_shared(struct bench_env *env, void *ctx)
+{
+	struct rtb_text_cache *cache = env->win->font_manager.text_cache;
+	struct text_state *state = ctx;
+	int i;
+
+	for (i = 0; i < PORTS; i++)
+		state->ports.runs[i] = rtb_text_cache_get(cache,
+				state->label->font, state->ports.names[i], 1.f);
+
+	return PORTS;
+}
+
+static void
+ports_shared_teardown(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	int i;
+
+	state->ports.during = env->win->font_manager.text_cache->stats;
+
+	for (i = 0; i < PORTS; i++)
+		if (state->ports.runs[i])
+			rtb_text_run_release(state->ports.runs[i]);
+}
+
+/* the cache's numbers for the last repetition of "text/ports/shared",
+ * taken while it still held all of its runs. */
+static void
+report_text_cache(struct text_state *state, const char *name)
+{
+	const struct rtb_text_cache_stats *b = &state->ports.before;
+	const struct rtb_text_cache_stats *d = &state->ports.during;
+	unsigned long hits, misses;
+
+	hits   = d->hits - b->hits;
+	misses = d->misses - b->misses;
+
+	printf("{\"name\": \"%s\", \"hits\": %lu, \"misses\": %lu, "
+			"\"hit_rate\": %.3f, \"runs\": %u, \"bytes\": %zu, "
+			"\"bytes_saved\": %zu}\n",
+			name, hits, misses,
+			(hits + misses) ? hits / (double) (hits + misses) : 0.0,
+			d->runs, d->bytes, d->bytes_saved);
+
+	fflush(stdout);
+}
+
+/**
+ * glyph atlas
+ */
+
+static void
+atlas_setup(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	texture_font_t *txfont = state->label->font->txfont;
+
+	if (txfont->location != TEXTURE_FONT_MEMORY
+			|| rtb_font_manager_init(&state->atlas.fm,
+				env->win->dpi.x, env->win->dpi.y))
+		return;
+
+	if (rtb_font_manager_load_embedded_font(&state->atlas.fm,
+				&state->atlas.font, state->label->font->size,
+				txfont->memory.base, txfont->memory.size)) {
+		rtb_font_manager_fini(&state->atlas.fm);
+		return;
+	}
+
+	state->atlas.loaded = 1;
+}
+
+static unsigned long
+atlas_load_glyphs(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	texture_font_t *txfont = state->atlas.font.txfont;
+	int i;
+
+	if (!state->atlas.loaded)
+		return 0;
+
+	/* every glyph is uploaded as soon as it's rasterised. */
+	for (i = 0; i < ATLAS_GLYPHS; i++)
+		texture_font_get_glyph(txfont, state->atlas.codepoints[i]);
+
+	glFinish();
+	return ATLAS_GLYPHS;
+}
+
+static void
+atlas_teardown(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	texture_atlas_t *atlas = state->atlas.fm.atlas;
+
+	if (!state->atlas.loaded)
+		return;
+
+	state->atlas.uploaded = atlas->uploaded;
+	state->atlas.width  = atlas->width;
+	state->atlas.height = atlas->height;
+	state->atlas.depth  = atlas->depth;
+
+	rtb_font_manager_fini(&state->atlas.fm);
+	state->atlas.loaded = 0;
+}
+
+static void
+report_atlas(struct text_state *state, const char *name)
+{
+	printf("{\"name\": \"%s\", \"glyphs\": %d, \"width\": %zu, "
+			"\"height\": %zu, \"uploaded\": %zu, "
+			"\"uploaded_per_glyph\": %zu}\n",
+			name, ATLAS_GLYPHS, state->atlas.width, state->atlas.height,
+			state->atlas.uploaded, state->atlas.uploaded / ATLAS_GLYPHS);
+
+	fflush(stdout);
+}
+
+static void
+pack_setup(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+
+	state->pack.atlas = texture_atlas_new(PACK_ATLAS_SIZE, PACK_ATLAS_SIZE,
+			1, env->win->dpi.x, env->win->dpi.y);
+}
+
+static unsigned long
+pack(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	ivec2 *size;
+	int i;
+
+	for (i = 0; i < PACK_RECTS; i++) {
+		size = &state->pack.sizes[i];
+		state->pack.regions[i] = texture_atlas_get_region(state->pack.atlas,
+				size->x, size->y);
+	}
+
+	return PACK_RECTS;
+}
+
+static void
+pack_teardown(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	size_t area = 0, bottom = 0;
+	ivec4 *region;
+	int i;
+
+	state->pack.missed = 0;
+
+	for (i = 0; i < PACK_RECTS; i++) {
+		region = &state->pack.regions[i];
+
+		if (region->x < 0) {
+			state->pack.missed++;
+			continue;
+		}
+
+		area += region->width * region->height;
+		if ((size_t) (region->y + region->height) > bottom)
+			bottom = region->y + region->height;
+	}
+
+	state->pack.efficiency = bottom
+		? area / (double) (bottom * state->pack.atlas->width) : 0.0;
+
+	texture_atlas_delete(state->pack.atlas);
+}
+
+static void
+report_pack(struct text_state *state, const char *name)
+{
+	printf("{\"name\": \"%s\", \"rects\": %d, \"missed\": %d, "
+			"\"efficiency\": %.3f}\n",
+			name, PACK_RECTS, state->pack.missed, state->pack.efficiency);
+
+	fflush(stdout);
+}
+
+static void
+make_pack_sizes(ivec2 *sizes, int count)
+{
+	uint32_t seed = 1;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		seed = seed * 1103515245 + 12345;
+		sizes[i].x = 12 + (seed >> 16) % 37;
+		seed = seed * 1103515245 + 12345;
+		sizes[i].y = 12 + (seed >> 16) % 37;
+	}
+}
+
+/**
+ * style sheet fonts
+ */
+
+typedef enum {
+	/* every glyph is rasterised, every time. */
+	SHEET_UNCACHED,
+
+	/* rasterised, and then written to an empty glyph cache. */
+	SHEET_COLD,
+
+	/* read from the glyph cache the last repetition wrote. */
+	SHEET_WARM
+} sheet_cache_t;
+
+static void
+clear_dir(const char *path)
+{
+	char file[512];
+	struct dirent *ent;
+	DIR *dir;
+
+	if (!(dir = opendir(path)))
+		return;
+
+	while ((ent = readdir(dir))) {
+		if (ent->d_name[0] == '.')
+			continue;
+
+		snprintf(file, sizeof(file), "%s/%s", path, ent->d_name);
+		unlink(file);
+	}
+
+	closedir(dir);
+}
+
+static void
+sheet_setup(struct bench_env *env, struct text_state *state,
+		struct sheet *sheet, rtb_font_raster_t raster, sheet_cache_t cache)
+{
+	const char *dir = state->glyph_cache_dir;
+
+	state->sheet = sheet;
+
+	if (cache != SHEET_UNCACHED && !*dir)
+		return;
+
+	if (rtb_font_manager_init(&sheet->fm, env->win->dpi.x, env->win->dpi.y))
+		return;
+
+	if (cache == SHEET_COLD)
+		clear_dir(dir);
+
+	rtb_font_manager_set_glyph_cache_dir(&sheet->fm,
+			(cache == SHEET_UNCACHED) ? NULL : dir);
+
+	sheet->fm.raster = raster;
+	sheet->loaded = 1;
+}
+
+static unsigned long
+sheet_load(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	struct sheet *sheet = state->sheet;
+	int i;
+
+	if (!sheet->loaded)
+		return 0;
+
+	for (i = 0; i < sheet->ndefs; i++)
+		rtb_font_manager_load_embedded_font(&sheet->fm, &sheet->fonts[i],
+				sheet->defs[i].pt_size, sheet->defs[i].base,
+				sheet->defs[i].size);
+
+	return sheet->ndefs;
+}
+
+static void
+sheet_teardown(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	struct sheet *sheet = state->sheet;
+	texture_atlas_t *atlas;
+	int raster;
+
+	if (!sheet->loaded)
+		return;
+
+	raster = sheet->fm.raster;
+	atlas = (raster == RTB_FONT_RASTER_SDF)
+		? sheet->fm.sdf_atlas : sheet->fm.atlas;
+
+	sheet->bytes[raster] = atlas ? atlas->used * atlas->depth : 0;
+	sheet->texture_bytes[raster] = atlas
+		? atlas->width * atlas->height * atlas->depth : 0;
+
+	rtb_font_manager_fini(&sheet->fm);
+	sheet->loaded = 0;
+}
+
+#define SHEET_BENCH(idx, mode, raster, cache)								\
+	static void																\
+	sheet_##idx##_##mode##_setup(struct bench_env *env, void *ctx)			\
+	{																		\
+		struct text_state *state = ctx;										\
+		sheet_setup(env, state, &state->sheets[idx], raster, cache);		\
+	}
+
+SHEET_BENCH(0, bitmap, RTB_FONT_RASTER_BITMAP, SHEET_UNCACHED)
+SHEET_BENCH(0, sdf, RTB_FONT_RASTER_SDF, SHEET_UNCACHED)
+SHEET_BENCH(1, bitmap, RTB_FONT_RASTER_BITMAP, SHEET_UNCACHED)
+SHEET_BENCH(1, sdf, RTB_FONT_RASTER_SDF, SHEET_UNCACHED)
+
+SHEET_BENCH(0, cold, RTB_FONT_RASTER_BITMAP, SHEET_COLD)
+SHEET_BENCH(0, warm, RTB_FONT_RASTER_BITMAP, SHEET_WARM)
+SHEET_BENCH(1, cold, RTB_FONT_RASTER_BITMAP, SHEET_COLD)
+SHEET_BENCH(1, warm, RTB_FONT_RASTER_BITMAP, SHEET_WARM)
+
+#undef SHEET_BENCH
+
+static void
+report_sheet(struct sheet *sheet, const char *name)
+{
+	size_t bitmap = sheet->bytes[RTB_FONT_RASTER_BITMAP];
+	size_t sdf = sheet->bytes[RTB_FONT_RASTER_SDF];
+
+	printf("{\"name\": \"%s\", \"fonts\": %d, \"bitmap_bytes\": %zu, "
+			"\"sdf_bytes\": %zu, \"saved_bytes\": %ld, "
+			"\"bitmap_texture_bytes\": %zu, \"sdf_texture_bytes\": %zu}\n",
+			name, sheet->ndefs, bitmap, sdf, (long) bitmap - (long) sdf,
+			sheet->texture_bytes[RTB_FONT_RASTER_BITMAP],
+			sheet->texture_bytes[RTB_FONT_RASTER_SDF]);
+
+	fflush(stdout);
+}
+
+/* the window's own style sheet, and one that asks for six sizes of its
+ * first face. */
+static void
+make_sheets(struct rtb_window *win, struct sheet *sheets)
+{
+	static const int sizes[] = {9, 11, 13, 15, 18, 24};
+
+	const struct rtb_style_property_definition *prop;
+	const struct rtb_style_font_definition *def;
+	struct sheet *sheet = &sheets[0];
+	struct rtb_style *style;
+	const void *base;
+	size_t size;
+	int i, state;
+
+	sheet->name = "default";
+
+	for (style = win->style_list; style->for_type; style++) {
+		for (state = 0; state < RTB_DRAW_STATE_COUNT; state++) {
+			for (prop = style->properties[state];
+					prop->property_name; prop++) {
+				if (prop->type != RTB_STYLE_PROP_FONT)
+					continue;
+
+				def = &prop->font;
+				if (!(base = rtb_asset_data(RTB_ASSET(def->face), &size)))
+					continue;
+
+				for (i = 0; i < sheet->ndefs; i++)
+					if (sheet->defs[i].base == base
+							&& sheet->defs[i].pt_size == def->size)
+						break;
+
+				if (i < sheet->ndefs || i == SHEET_MAX_FONTS)
+					continue;
+
+				sheet->defs[i].base = base;
+				sheet->defs[i].size = size;
+				sheet->defs[i].pt_size = def->size;
+				sheet->ndefs++;
+			}
+		}
+	}
+
+	sheets[1].name = "six_sizes";
+
+	for (i = 0; sheet->ndefs && i < (int) ARRAY_LENGTH(sizes); i++) {
+		sheets[1].defs[i] = sheet->defs[0];
+		sheets[1].defs[i].pt_size = sizes[i];
+		sheets[1].ndefs++;
+	}
+}
+
+/**
+ * external assets
+ */
+
+static unsigned long
+load_asset(const char *path, int map, rtb_asset_compression_t compression)
+{
+	struct rtb_asset asset = {
+		.location    = RTB_ASSET_EXTERNAL,
+		.compression = compression,
+		.external    = {
+			.path = (char *) path,
+			.map  = map
+		}
+	};
+
+	int i;
+
+	if (!path[0])
+		return 0;
+
+	for (i = 0; i < ASSET_LOADS; i++) {
+		if (rtb_asset_load(&asset))
+			break;
+
+		rtb_asset_free(&asset);
+	}
+
+	return i;
+}
+
+static unsigned long
+asset_read(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	return load_asset(state->face_path, 0, RTB_ASSET_UNCOMPRESSED);
+}
+
+static unsigned long
+asset_map(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	return load_asset(state->face_path, 1, RTB_ASSET_UNCOMPRESSED);
+}
+
+/* what it costs to decompress a face the first time it's used, when
+ * it's built with --compress-assets. */
+static unsigned long
+asset_xz(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+	return load_asset(state->face_xz_path, 1, RTB_ASSET_COMPRESSED_XZ);
+}
+
+/* `path` is a mkstemp() template, and is emptied if it can't be
+ * written. */
+static void
+write_temp(char *path, const void *data, size_t size)
+{
+	FILE *f;
+	int fd;
+
+	if ((fd = mkstemp(path)) < 0) {
+		path[0] = '\0';
+		return;
+	}
+
+	if (!(f = fdopen(fd, "wb"))) {
+		close(fd);
+		goto err;
+	}
+
+	if (fwrite(data, size, 1, f) != 1) {
+		fclose(f);
+		goto err;
+	}
+
+	if (!fclose(f))
+		return;
+
+err:
+	unlink(path);
+	path[0] = '\0';
+}
+
+#ifdef RTB_ASSET_XZ
+static void
+write_face_xz(struct text_state *state, const void *data, size_t size)
+{
+	size_t bound, xz_size = 0;
+	uint8_t *xz;
+
+	bound = lzma_stream_buffer_bound(size);
+	if (!(xz = malloc(bound)))
+		return;
+
+	/* the same settings waftools/rtb_style.py uses. */
+	if (lzma_easy_buffer_encode(9 | LZMA_PRESET_EXTREME, LZMA_CHECK_CRC32,
+				NULL, data, size, xz, &xz_size, bound) == LZMA_OK) {
+		snprintf(state->face_xz_path, sizeof(state->face_xz_path),
+				"/tmp/rtb-bench-face-XXXXXX");
+		write_temp(state->face_xz_path, xz, xz_size);
+	}
+
+	free(xz);
+}
+#endif
+
+static void
+write_face(struct text_state *state)
+{
+	texture_font_t *txfont = state->label->font->txfont;
+
+	if (txfont->location != TEXTURE_FONT_MEMORY)
+		return;
+
+	snprintf(state->face_path, sizeof(state->face_path),
+			"/tmp/rtb-bench-face-XXXXXX");
+	write_temp(state->face_path, txfont->memory.base, txfont->memory.size);
+
+#ifdef RTB_ASSET_XZ
+	write_face_xz(state, txfont->memory.base, txfont->memory.size);
+#endif
+}
+
+/**
+ * glyph rasterisation
+ */
+
+static void
+paste_setup(struct bench_env *env, struct text_state *state,
+		struct rtb_window *win, rtb_glyph_policy_t policy)
+{
+	texture_font_t *txfont = state->label->font->txfont;
+
+	if (txfont->location != TEXTURE_FONT_MEMORY
+			|| rtb_font_manager_init(&state->paste.fm,
+				env->win->dpi.x, env->win->dpi.y))
+		return;
+
+	/* without a window, glyphs are rasterised as they're asked for. */
+	state->paste.fm.window = win;
+	state->paste.fm.glyph_policy = policy;
+
+	if (rtb_font_manager_load_embedded_font(&state->paste.fm,
+				&state->paste.font, state->label->font->size,
+				txfont->memory.base, txfont->memory.size))
+		goto err_font;
+
+	if (!(state->paste.tobj = rtb_text_object_new(&state->paste.fm)))
+		goto err_font;
+
+	state->paste.loaded = 1;
+	return;
+
+err_font:
+	rtb_font_manager_fini(&state->paste.fm);
+}
+
+static void
+paste_inline_setup(struct bench_env *env, void *ctx)
+{
+	paste_setup(env, ctx, NULL, RTB_GLYPHS_WAIT);
+}
+
+static void
+paste_wait_setup(struct bench_env *env, void *ctx)
+{
+	paste_setup(env, ctx, env->win, RTB_GLYPHS_WAIT);
+}
+
+static void
+paste_placeholder_setup(struct bench_env *env, void *ctx)
+{
+	paste_setup(env, ctx, env->win, RTB_GLYPHS_PLACEHOLDER);
+}
+
+/* only the layout is timed, which is as long as the UI thread is held
+ * up for. whatever's still being rasterised is waited for in the
+ * teardown. */
+static unsigned long
+paste(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+
+	if (!state->paste.loaded)
+		return 0;
+
+	rtb_text_object_update(state->paste.tobj, &state->paste.font,
+			state->paste.text, 1.f);
+
+	return LARGE_FONT_CHARS;
+}
+
+static void
+paste_teardown(struct bench_env *env, void *ctx)
+{
+	struct text_state *state = ctx;
+
+	if (!state->paste.loaded)
+		return;
+
+	rtb_text_object_free(state->paste.tobj);
+	rtb_font_manager_fini(&state->paste.fm);
+
+	/* the jobs are done, but the loop still has to hear about it. */
+	uv_run(&env->rtb->event_loop, UV_RUN_NOWAIT);
+	state->paste.loaded = 0;
+}
+
+/**
+ * suite
+ */
+
+static char *
+make_paragraph(void)
+{
+	static const char line[] =
+		"The quick brown fox jumps over the lazy dog. 0123456789\n";
+
+	size_t i, len = sizeof(line) - 1;
+	char *paragraph;
+
+	if (!(paragraph = malloc(len * 20 + 1)))
+		return NULL;
+
+	for (i = 0; i < 20; i++)
+		memcpy(paragraph + (i * len), line, len);
+
+	paragraph[len * 20] = '\0';
+	return paragraph;
+}
+
+static size_t
+utf8_encode(char *buf, rtb_utf32_t c)
+{
+	if (c < 0x80) {
+		buf[0] = c;
+		return 1;
+	} else if (c < 0x800) {
+		buf[0] = 0xC0 | (c >> 6);
+		buf[1] = 0x80 | (c & 0x3F);
+		return 2;
+	}
+
+	buf[0] = 0xE0 | (c >> 12);
+	buf[1] = 0x80 | ((c >> 6) & 0x3F);
+	buf[2] = 0x80 | (c & 0x3F);
+	return 3;
+}
+
+/* LARGE_FONT_CHARS codepoints, cycling through [first, last). */
+static char *
+make_string(rtb_utf32_t first, rtb_utf32_t last)
+{
+	char *str, *p;
+	int i;
+
+	if (!(str = malloc(LARGE_FONT_CHARS * 3 + 1)))
+		return NULL;
+
+	for (p = str, i = 0; i < LARGE_FONT_CHARS; i++)
+		p += utf8_encode(p, first + (i % (last - first)));
+
+	*p = '\0';
+	return str;
+}
+
+/* printable codepoints from the start of the BMP, which covers latin-1,
+ * latin extended, greek and cyrillic. */
+static void
+bmp_codepoints(rtb_utf32_t *codepoints, int count)
+{
+	rtb_utf32_t c;
+	int i;
+
+	for (c = ' ', i = 0; i < count; c++)
+		if (c < 0x7F || c > 0x9F)
+			codepoints[i++] = c;
+}
+
+static int
+init_large_font(struct bench_env *env, struct text_state *state)
+{
+	rtb_utf32_t cache[LARGE_FONT_GLYPHS + 1];
+	texture_font_t *txfont;
+
+	txfont = state->label->font->txfont;
+	if (txfont->location != TEXTURE_FONT_MEMORY)
+		return -1;
+
+	bmp_codepoints(cache, LARGE_FONT_GLYPHS);
+	cache[LARGE_FONT_GLYPHS] = 0;
+
+	if (rtb_font_manager_init(&state->large.fm,
+				env->win->dpi.x, env->win->dpi.y))
+		return -1;
+
+	state->large.fm.cache_glyphs = cache;
+
+	if (rtb_font_manager_load_embedded_font(&state->large.fm,
+				&state->large.font, state->label->font->size,
+				txfont->memory.base, txfont->memory.size))
+		goto err_font;
+
+	state->large.fm.cache_glyphs = NULL;
+
+	state->large.tobj = rtb_text_object_new(&state->large.fm);
+	state->large.latin1 = make_string(' ', 0x100);
+	state->large.unicode = make_string(0x391, 0x450);
+
+	if (!state->large.tobj || !state->large.latin1 || !state->large.unicode)
+		goto err_alloc;
+
+	return 0;
+
+err_alloc:
+	if (state->large.tobj)
+		rtb_text_object_free(state->large.tobj);
+
+	free(state->large.latin1);
+	free(state->large.unicode);
+	state->large.tobj = NULL;
+err_font:
+	rtb_font_manager_fini(&state->large.fm);
+	return -1;
+}
+
+static void
+fini_large_font(struct text_state *state)
+{
+	if (!state->large.tobj)
+		return;
+
+	rtb_text_object_free(state->large.tobj);
+	free(state->large.latin1);
+	free(state->large.unicode);
+
+	rtb_font_manager_fini(&state->large.fm);
+}
+
+void
+bench_text_suite(struct bench_env *env)
+{
+	static const struct bench benches[] = {
+		{.name = "text/update/short",     .run = update_short},
+		{.name = "text/update/unicode",   .run = update_unicode},
+		{.name = "text/update/paragraph", .run = update_paragraph},
+
+		{.name = "text/update/large_font/latin1",
+			.run = update_large_font_latin1},
+		{.name = "text/update/large_font/unicode",
+			.run = update_large_font_unicode},
+
+		{.name = "text/label_set_text",   .run = label_set_text},
+
+		{.name = "text/type/set_text", .setup = field_setup,
+			.run = type_set_text},
+		{.name = "text/type/splice_end", .setup = field_setup,
+			.run = type_splice_end},
+		{.name = "text/type/splice_middle", .setup = field_setup,
+			.run = type_splice_middle},
+
+		{.name = "text/ports/private",
+			.teardown = ports_private_teardown, .run = ports_private},
+		{.name = "text/ports/shared", .setup = ports_shared_setup,
+			.teardown = ports_shared_teardown, .run = ports_shared},
+
+		{.name = "text/atlas/load_glyphs", .setup = atlas_setup,
+			.teardown = atlas_teardown, .run = atlas_load_glyphs},
+
+		{.name = "text/atlas/pack", .setup = pack_setup,
+			.teardown = pack_teardown, .run = pack},
+
+		{.name = "text/fonts/default/bitmap", .setup = sheet_0_bitmap_setup,
+			.teardown = sheet_teardown, .run = sheet_load},
+		{.name = "text/fonts/default/sdf", .setup = sheet_0_sdf_setup,
+			.teardown = sheet_teardown, .run = sheet_load},
+		{.name = "text/fonts/six_sizes/bitmap",
+			.setup = sheet_1_bitmap_setup,
+			.teardown = sheet_teardown, .run = sheet_load},
+		{.name = "text/fonts/six_sizes/sdf", .setup = sheet_1_sdf_setup,
+			.teardown = sheet_teardown, .run = sheet_load},
+
+		{.name = "text/fonts/default/cache/cold", .setup = sheet_0_cold_setup,
+			.teardown = sheet_teardown, .run = sheet_load},
+		{.name = "text/fonts/default/cache/warm", .setup = sheet_0_warm_setup,
+			.teardown = sheet_teardown, .run = sheet_load},
+		{.name = "text/fonts/six_sizes/cache/cold",
+			.setup = sheet_1_cold_setup,
+			.teardown = sheet_teardown, .run = sheet_load},
+		{.name = "text/fonts/six_sizes/cache/warm",
+			.setup = sheet_1_warm_setup,
+			.teardown = sheet_teardown, .run = sheet_load},
+
+		{.name = "text/assets/read", .run = asset_read},
+		{.name = "text/assets/map",  .run = asset_map},
+		{.name = "text/assets/xz",   .run = asset_xz},
+
+		{.name = "text/glyphs/paste/inline", .setup = paste_inline_setup,
+			.teardown = paste_teardown, .run = paste},
+		{.name = "text/glyphs/paste/wait", .setup = paste_wait_setup,
+			.teardown = paste_teardown, .run = paste},
+		{.name = "text/glyphs/paste/placeholder",
+			.setup = paste_placeholder_setup,
+			.teardown = paste_teardown, .run = paste}
+	};
+
+	struct text_state state = {NULL};
+	char name[64];
+	size_t i;
+
+	for (i = 0; i < ARRAY_LENGTH(benches); i++)
+		if (bench_enabled(env, benches[i].name))
+			break;
+
+	if (i == ARRAY_LENGTH(benches))
+		return;
+
+	/* the label is there to get a font from the stylesheet, the same
+	 * way any other widget would. */
+	state.label = rtb_label_new("0.00 dB");
+	state.tobj = rtb_text_object_new(&env->win->font_manager);
+	state.paragraph = make_paragraph();
+	state.field = rtb_label_new(NULL);
+	state.paste.text = make_string(0x391, 0x450);
+
+	if (!state.label || !state.tobj || !state.paragraph || !state.field
+			|| !state.paste.text)
+		goto out;
+
+	for (i = 0; i < FIELD_CHARS; i++)
+		state.field_text[i] = 'a' + (i % 26);
+
+	state.field_text[FIELD_CHARS] = '\0';
+	rtb_label_set_text(state.field, state.field_text);
+
+	for (i = 0; i < PORTS; i++)
+		snprintf(state.ports.names[i], sizeof(state.ports.names[i]),
+				"%s_%d", (i & 1) ? "playback" : "capture",
+				(int) ((i >> 1) % PORTS_PER_CLIENT) + 1);
+
+	bmp_codepoints(state.atlas.codepoints, ATLAS_GLYPHS);
+	make_pack_sizes(state.pack.sizes, PACK_RECTS);
+	make_sheets(env->win, state.sheets);
+
+	snprintf(state.glyph_cache_dir, sizeof(state.glyph_cache_dir),
+			"/tmp/rtb-bench-XXXXXX");
+	if (!mkdtemp(state.glyph_cache_dir))
+		state.glyph_cache_dir[0] = '\0';
+
+	rtb_elem_add_child(RTB_ELEMENT(env->win), RTB_ELEMENT(state.label),
+			RTB_ADD_TAIL);
+	rtb_elem_add_child(RTB_ELEMENT(env->win), RTB_ELEMENT(state.field),
+			RTB_ADD_TAIL);
+	bench_draw_frame(env, 1);
+	write_face(&state);
+
+	for (i = 0; i < ARRAY_LENGTH(benches); i++) {
+		if (!strstr(benches[i].name, "/large_font/")
+				|| !bench_enabled(env, benches[i].name))
+			continue;
+
+		if (init_large_font(env, &state))
+			fprintf(stderr, "rtb-bench: couldn't load the large font\n");
+
+		break;
+	}
+
+	for (i = 0; i < ARRAY_LENGTH(benches); i++) {
+		if (!bench_enabled(env, benches[i].name))
+			continue;
+
+		bench_run(env, &benches[i], &state);
+
+		if (benches[i].run == ports_shared) {
+			snprintf(name, sizeof(name), "%s/cache", benches[i].name);
+			report_text_cache(&state, name);
+		} else if (benches[i].run == atlas_load_glyphs) {
+			snprintf(name, sizeof(name), "%s/atlas", benches[i].name);
+			report_atlas(&state, name);
+		} else if (benches[i].teardown == pack_teardown) {
+			snprintf(name, sizeof(name), "%s/packing", benches[i].name);
+			report_pack(&state, name);
+		} else if (benches[i].setup == sheet_0_sdf_setup
+				|| benches[i].setup == sheet_1_sdf_setup) {
+			snprintf(name, sizeof(name), "text/fonts/%s/atlas",
+					state.sheet->name);
+			report_sheet(state.sheet, name);
+		}
+	}
+
+	fini_large_font(&state);
+	rtb_elem_remove_child(RTB_ELEMENT(env->win), RTB_ELEMENT(state.field));
+	rtb_elem_remove_child(RTB_ELEMENT(env->win), RTB_ELEMENT(state.label));
+
+out:
+	if (state.face_path[0])
+		unlink(state.face_path);
+
+	if (state.face_xz_path[0])
+		unlink(state.face_xz_path);
+
+	if (state.glyph_cache_dir[0]) {
+		clear_dir(state.glyph_cache_dir);
+		rmdir(state.glyph_cache_dir);
+	}
+
+	free(state.paragraph);
+	free(state.paste.text);
+
+	if (state.field)
+		rtb_label_free(state.field);
+
+	if (state.tobj)
+		rtb_text_object_free(state.tobj);
+
+	if (state.label)
+		rtb_label_free(state.label);
+}
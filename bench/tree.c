@@ -0,0 +1,206 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/element.h>
+#include <rutabaga/container.h>
+#include <rutabaga/window.h>
+
+#include <rutabaga/widgets/knob.h>
+
+#include "bench.h"
+
+#define ADD_CHILDREN  1000
+#define REFLOWS       10
+#define RESTYLES      10
+
+/**
+ * adding children
+ */
+
+struct add_child_state {
+	struct rtb_element *parent;
+	struct rtb_knob *knobs[ADD_CHILDREN];
+	int attached;
+};
+
+static void
+add_child_setup(struct bench_env *env, void *ctx)
+{
+	struct add_child_state *state = ctx;
+	int i;
+
+	state->parent = rtb_container_new();
+
+	if (state->attached)
+		rtb_elem_add_child(RTB_ELEMENT(env->win), state->parent,
+				RTB_ADD_TAIL);
+
+	for (i = 0; i < ADD_CHILDREN; i++)
+		state->knobs[i] = rtb_knob_new();
+}
+
+static unsigned long
+add_child_run(struct bench_env *env, void *ctx)
+{
+	struct add_child_state *state = ctx;
+	int i;
+
+	for (i = 0; i < ADD_CHILDREN; i++)
+		rtb_elem_add_child(state->parent, RTB_ELEMENT(state->knobs[i]),
+				RTB_ADD_TAIL);
+
+	return ADD_CHILDREN;
+}
+
+static void
+add_child_teardown(struct bench_env *env, void *ctx)
+{
+	struct add_child_state *state = ctx;
+	int i;
+
+	if (state->attached)
+		rtb_elem_remove_child(RTB_ELEMENT(env->win), state->parent);
+
+	for (i = 0; i < ADD_CHILDREN; i++)
+		rtb_knob_free(state->knobs[i]);
+
+	rtb_elem_fini(state->parent);
+	free(state->parent);
+}
+
+/**
+ * attaching whole trees
+ */
+
+static void
+attach_setup(struct bench_env *env, void *ctx)
+{
+	struct bench_tree *tree = ctx;
+	rtb_elem_remove_child(RTB_ELEMENT(env->win), tree->root);
+}
+
+static unsigned long
+attach_run(struct bench_env *env, void *ctx)
+{
+	struct bench_tree *tree = ctx;
+
+	/* everything in the tree gets restyled and laid out. */
+	rtb_elem_add_child(RTB_ELEMENT(env->win), tree->root, RTB_ADD_TAIL);
+	return 1;
+}
+
+/**
+ * reflow and restyle
+ */
+
+static unsigned long
+reflow_leafward(struct bench_env *env, void *ctx)
+{
+	struct bench_tree *tree = ctx;
+	int i;
+
+	for (i = 0; i < REFLOWS; i++)
+		rtb_elem_reflow_leafward(tree->root);
+
+	return REFLOWS;
+}
+
+static unsigned long
+reflow_rootward(struct bench_env *env, void *ctx)
+{
+	struct bench_tree *tree = ctx;
+	int i;
+
+	for (i = 0; i < REFLOWS; i++)
+		rtb_elem_reflow_rootward(tree->deepest);
+
+	return REFLOWS;
+}
+
+static unsigned long
+restyle(struct bench_env *env, void *ctx)
+{
+	struct bench_tree *tree = ctx;
+	int i;
+
+	for (i = 0; i < RESTYLES; i++)
+		tree->root->restyle(tree->root);
+
+	return RESTYLES;
+}
+
+/**
+ * suite
+ */
+
+void
+bench_tree_suite(struct bench_env *env)
+{
+	static const struct bench on_tree[] = {
+		{
+			.name  = "tree/attach",
+			.setup = attach_setup,
+			.run   = attach_run,
+			.once  = 1
+		},
+
+		{.name = "tree/reflow_leafward", .run = reflow_leafward},
+		{.name = "tree/reflow_rootward", .run = reflow_rootward},
+		{.name = "tree/restyle",         .run = restyle}
+	};
+
+	struct bench add_child = {
+		.setup    = add_child_setup,
+		.run      = add_child_run,
+		.teardown = add_child_teardown
+	};
+
+	struct add_child_state *add_state;
+	int kind;
+
+	if ((add_state = calloc(1, sizeof(*add_state)))) {
+		/* into a container that isn't in the window yet, which is
+		 * just list manipulation. */
+		add_child.name = "tree/add_child/detached";
+		add_state->attached = 0;
+		bench_run(env, &add_child, add_state);
+
+		/* into one that is, where every child gets restyled and
+		 * reflowed as it's added. */
+		add_child.name = "tree/add_child/attached";
+		add_state->attached = 1;
+		bench_run(env, &add_child, add_state);
+
+		free(add_state);
+	}
+
+	for (kind = 0; kind < BENCH_TREE_KIND_COUNT; kind++)
+		bench_run_on_tree(env, kind, on_tree, ARRAY_LENGTH(on_tree));
+}
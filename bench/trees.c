@@ -0,0 +1,443 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/element.h>
+#include <rutabaga/container.h>
+#include <rutabaga/window.h>
+#include <rutabaga/layout.h>
+
+#include <rutabaga/widgets/button.h>
+#include <rutabaga/widgets/knob.h>
+#include <rutabaga/widgets/patchbay.h>
+
+#include "bench.h"
+
+#define KNOBS           10000
+#define DEPTH           256
+#define ROWS            10
+#define ROW_WIDTH       100
+#define PATCHBAY_NODES  2000
+#define PATCHBAY_COLS   50
+
+struct bench_node {
+	RTB_INHERIT(rtb_patchbay_node);
+
+	struct rtb_patchbay_port in;
+	struct rtb_patchbay_port out;
+};
+
+/**
+ * freeing
+ */
+
+static void
+free_container(struct rtb_element *elem)
+{
+	rtb_elem_fini(elem);
+	free(elem);
+}
+
+static void
+free_knob(struct rtb_element *elem)
+{
+	rtb_knob_free(RTB_ELEMENT_AS(elem, rtb_knob));
+}
+
+static void
+free_button(struct rtb_element *elem)
+{
+	rtb_button_free(RTB_ELEMENT_AS(elem, rtb_button));
+}
+
+static void
+free_patchbay(struct rtb_element *elem)
+{
+	rtb_patchbay_free(RTB_ELEMENT_AS(elem, rtb_patchbay));
+}
+
+static void
+free_node(struct rtb_element *elem)
+{
+	struct bench_node *node = RTB_ELEMENT_AS(elem, bench_node);
+
+	rtb_patchbay_port_fini(&node->in);
+	rtb_patchbay_port_fini(&node->out);
+	rtb_patchbay_node_fini(RTB_PATCHBAY_NODE(node));
+	free(node);
+}
+
+/**
+ * building
+ */
+
+static struct rtb_element *
+track(struct bench_tree *tree, struct rtb_element *elem,
+		void (*free_elem)(struct rtb_element *))
+{
+	struct bench_tree_obj *objs;
+
+	if (!elem)
+		return NULL;
+
+	if (tree->nobjs == tree->objs_size) {
+		tree->objs_size = tree->objs_size ? tree->objs_size * 2 : 256;
+		objs = realloc(tree->objs, tree->objs_size * sizeof(*objs));
+
+		if (!objs) {
+			free_elem(elem);
+			return NULL;
+		}
+
+		tree->objs = objs;
+	}
+
+	tree->objs[tree->nobjs].elem = elem;
+	tree->objs[tree->nobjs].free = free_elem;
+	tree->nobjs++;
+
+	return elem;
+}
+
+static struct rtb_element *
+new_container(struct bench_tree *tree)
+{
+	return track(tree, rtb_container_new(), free_container);
+}
+
+static struct rtb_element *
+new_knob(struct bench_tree *tree)
+{
+	return track(tree, RTB_ELEMENT(rtb_knob_new()), free_knob);
+}
+
+static struct rtb_element *
+new_button(struct bench_tree *tree, const char *label)
+{
+	return track(tree, RTB_ELEMENT(rtb_button_new(label)), free_button);
+}
+
+static int
+build_knobs(struct bench_tree *tree)
+{
+	struct rtb_element *knob;
+	int i;
+
+	if (!(tree->root = new_container(tree)))
+		return -1;
+
+	for (i = 0; i < KNOBS; i++) {
+		if (!(knob = new_knob(tree)))
+			return -1;
+
+		rtb_elem_add_child(tree->root, knob, RTB_ADD_TAIL);
+		tree->leaves[tree->nleaves++] = knob;
+	}
+
+	tree->deepest = knob;
+	return 0;
+}
+
+static int
+build_deep(struct bench_tree *tree)
+{
+	struct rtb_element *parent, *child;
+	int i;
+
+	if (!(parent = tree->root = new_container(tree)))
+		return -1;
+
+	for (i = 1; i < DEPTH; i++) {
+		if (!(child = new_container(tree)))
+			return -1;
+
+		rtb_elem_set_size_cb(child, rtb_size_hfill);
+		rtb_elem_add_child(parent, child, RTB_ADD_TAIL);
+		parent = child;
+	}
+
+	if (!(child = new_knob(tree)))
+		return -1;
+
+	rtb_elem_add_child(parent, child, RTB_ADD_TAIL);
+	tree->leaves[tree->nleaves++] = child;
+	tree->deepest = child;
+	return 0;
+}
+
+static int
+build_wide(struct bench_tree *tree)
+{
+	struct rtb_element *row, *button = NULL;
+	int i, j;
+
+	if (!(tree->root = new_container(tree)))
+		return -1;
+
+	rtb_elem_set_layout(tree->root, rtb_layout_vpack_top);
+
+	for (i = 0; i < ROWS; i++) {
+		if (!(row = new_container(tree)))
+			return -1;
+
+		rtb_elem_set_size_cb(row, rtb_size_hfill);
+		rtb_elem_add_child(tree->root, row, RTB_ADD_TAIL);
+
+		for (j = 0; j < ROW_WIDTH; j++) {
+			if (!(button = new_button(tree, "button")))
+				return -1;
+
+			rtb_elem_add_child(row, button, RTB_ADD_TAIL);
+			tree->leaves[tree->nleaves++] = button;
+		}
+	}
+
+	tree->deepest = button;
+	return 0;
+}
+
+static int
+build_mixed(struct bench_tree *tree)
+{
+	struct rtb_element *row, *leaf = NULL;
+	int i, j;
+
+	if (!(tree->root = new_container(tree)))
+		return -1;
+
+	rtb_elem_set_layout(tree->root, rtb_layout_vpack_top);
+
+	for (i = 0; i < ROWS; i++) {
+		if (!(row = new_container(tree)))
+			return -1;
+
+		rtb_elem_set_size_cb(row, rtb_size_hfill);
+		rtb_elem_add_child(tree->root, row, RTB_ADD_TAIL);
+
+		for (j = 0; j < ROW_WIDTH; j++) {
+			leaf = (j % 2) ? new_button(tree, "button") : new_knob(tree);
+			if (!leaf)
+				return -1;
+
+			rtb_elem_add_child(row, leaf, RTB_ADD_TAIL);
+			tree->leaves[tree->nleaves++] = leaf;
+		}
+	}
+
+	tree->deepest = leaf;
+	return 0;
+}
+
+static int
+build_patchbay(struct bench_tree *tree)
+{
+	struct bench_node *node, *prev = NULL;
+	struct rtb_patchbay *patchbay;
+	char name[32];
+	int i;
+
+	if (!(patchbay = rtb_patchbay_new()))
+		return -1;
+
+	tree->root = track(tree, RTB_ELEMENT(patchbay), free_patchbay);
+	if (!tree->root)
+		return -1;
+
+	rtb_elem_set_size_cb(tree->root, rtb_size_fill);
+
+	for (i = 0; i < PATCHBAY_NODES; i++) {
+		if (!(node = calloc(1, sizeof(*node))))
+			return -1;
+
+		rtb_patchbay_node_init(RTB_PATCHBAY_NODE(node));
+		if (!track(tree, RTB_ELEMENT(node), free_node)) {
+			rtb_patchbay_node_fini(RTB_PATCHBAY_NODE(node));
+			free(node);
+			return -1;
+		}
+
+		snprintf(name, sizeof(name), "node %d", i);
+		rtb_patchbay_node_set_name(RTB_PATCHBAY_NODE(node), name);
+
+		/* this is normally set when the node is attached, but the
+		 * ports need it to be taken down, and the tree might not ever
+		 * have been. */
+		node->patchbay = patchbay;
+
+		rtb_patchbay_port_init(&node->in, RTB_PATCHBAY_NODE(node),
+				"in", PORT_TYPE_INPUT, RTB_ADD_TAIL);
+		rtb_patchbay_port_init(&node->out, RTB_PATCHBAY_NODE(node),
+				"out", PORT_TYPE_OUTPUT, RTB_ADD_TAIL);
+
+		node->x = (i % PATCHBAY_COLS) * 160.f;
+		node->y = (i / PATCHBAY_COLS) * 80.f;
+
+		rtb_elem_add_child(tree->root, RTB_ELEMENT(node), RTB_ADD_TAIL);
+		tree->leaves[tree->nleaves++] = RTB_ELEMENT(&node->in);
+
+		if (prev)
+			rtb_patchbay_connect_ports(patchbay, &prev->out, &node->in);
+
+		prev = node;
+	}
+
+	tree->deepest = RTB_ELEMENT(&prev->out);
+	return 0;
+}
+
+/**
+ * public API
+ */
+
+const char *
+bench_tree_name(bench_tree_kind_t kind)
+{
+	static const char *names[] = {
+		[BENCH_TREE_KNOBS]    = "knobs",
+		[BENCH_TREE_DEEP]     = "deep",
+		[BENCH_TREE_WIDE]     = "wide",
+		[BENCH_TREE_PATCHBAY] = "patchbay",
+		[BENCH_TREE_MIXED]    = "mixed"
+	};
+
+	return names[kind];
+}
+
+int
+bench_tree_build(struct bench_env *env, struct bench_tree *tree,
+		bench_tree_kind_t kind)
+{
+	static const size_t nleaves[] = {
+		[BENCH_TREE_KNOBS]    = KNOBS,
+		[BENCH_TREE_DEEP]     = 1,
+		[BENCH_TREE_WIDE]     = ROWS * ROW_WIDTH,
+		[BENCH_TREE_PATCHBAY] = PATCHBAY_NODES,
+		[BENCH_TREE_MIXED]    = ROWS * ROW_WIDTH
+	};
+
+	int ret;
+
+	tree->kind = kind;
+	tree->root = tree->deepest = NULL;
+	tree->objs = NULL;
+	tree->nobjs = tree->objs_size = 0;
+
+	tree->nleaves = 0;
+	if (!(tree->leaves = calloc(nleaves[kind], sizeof(*tree->leaves))))
+		return -1;
+
+	switch (kind) {
+	case BENCH_TREE_KNOBS:    ret = build_knobs(tree);    break;
+	case BENCH_TREE_DEEP:     ret = build_deep(tree);     break;
+	case BENCH_TREE_WIDE:     ret = build_wide(tree);     break;
+	case BENCH_TREE_PATCHBAY: ret = build_patchbay(tree); break;
+	case BENCH_TREE_MIXED:    ret = build_mixed(tree);    break;
+	default:                  ret = -1;
+	}
+
+	if (ret)
+		bench_tree_free(env, tree);
+
+	return ret;
+}
+
+void
+bench_tree_attach(struct bench_env *env, struct bench_tree *tree)
+{
+	rtb_elem_add_child(RTB_ELEMENT(env->win), tree->root, RTB_ADD_TAIL);
+	bench_draw_frame(env, 1);
+}
+
+void
+bench_tree_free(struct bench_env *env, struct bench_tree *tree)
+{
+	size_t i;
+
+	if (tree->root && tree->root->parent)
+		rtb_elem_remove_child(tree->root->parent, tree->root);
+
+	/* children first, while their parents are still around. */
+	for (i = tree->nobjs; i > 0; i--)
+		tree->objs[i - 1].free(tree->objs[i - 1].elem);
+
+	free(tree->objs);
+	free(tree->leaves);
+
+	tree->root = tree->deepest = NULL;
+	tree->objs = NULL;
+	tree->leaves = NULL;
+	tree->nobjs = tree->objs_size = tree->nleaves = 0;
+}
+
+struct bench_tree *
+bench_tree_get(struct bench_env *env, bench_tree_kind_t kind)
+{
+	struct bench_tree *tree;
+	bench_tree_kind_t i;
+
+	if (!(tree = env->trees[kind])) {
+		if (!(tree = calloc(1, sizeof(*tree))))
+			return NULL;
+
+		if (bench_tree_build(env, tree, kind)) {
+			fprintf(stderr, "rtb-bench: couldn't build the %s tree\n",
+					bench_tree_name(kind));
+			free(tree);
+			return NULL;
+		}
+
+		bench_tree_attach(env, tree);
+		env->trees[kind] = tree;
+	}
+
+	/* the trees all sit on top of each other in the window. only the
+	 * one being benchmarked is drawn or gets events. */
+	for (i = 0; i < BENCH_TREE_KIND_COUNT; i++)
+		if (env->trees[i])
+			env->trees[i]->root->visibility = (i == kind)
+				? RTB_UNOBSCURED : RTB_FULLY_OBSCURED;
+
+	return tree;
+}
+
+void
+bench_trees_free(struct bench_env *env)
+{
+	int kind;
+
+	for (kind = 0; kind < BENCH_TREE_KIND_COUNT; kind++) {
+		if (!env->trees[kind])
+			continue;
+
+		bench_tree_free(env, env->trees[kind]);
+		free(env->trees[kind]);
+		env->trees[kind] = NULL;
+	}
+}
@@ -0,0 +1,55 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <rutabaga/types.h>
+
+#include "freetype-gl/texture-font.h"
+
+/**
+ * rasterised glyphs, kept on disk between runs so that fonts can be
+ * loaded without rasterising anything. each file holds one batch, for one
+ * face at one size, DPI, atlas depth (which is whether it's subpixel
+ * rendered) and set of glyphs, and the files are written once and never
+ * changed, so they can be mapped while another process replaces them.
+ */
+
+/* where the platform keeps caches, or NULL if there's nowhere. to be
+ * freed with free(). */
+char *rtb_glyph_cache_default_dir(void);
+
+/* loads `charcodes` into `txfont` from the cache in `dir`. returns -1,
+ * having loaded nothing, if they haven't been cached. */
+int rtb_glyph_cache_load(const char *dir, texture_font_t *txfont,
+		const rtb_utf32_t *charcodes);
+
+/* caches `batch`, which has to be `charcodes` rendered for `txfont`. a
+ * batch which left any of them out (because the font already had them)
+ * isn't cached. */
+int rtb_glyph_cache_store(const char *dir, texture_font_t *txfont,
+		const rtb_utf32_t *charcodes, const texture_glyph_batch_t *batch);
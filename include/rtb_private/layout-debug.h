@@ -27,11 +27,8 @@
 #ifdef RTB_LAYOUT_DEBUG
 
 void rtb_debug_draw_bounding_box(struct rtb_element *);
-void rtb_debug_init(void);
 
 # define LAYOUT_DEBUG_DRAW_BOX(self) rtb_debug_draw_bounding_box(self)
-# define LAYOUT_DEBUG_INIT() rtb_debug_init()
 #else
 # define LAYOUT_DEBUG_DRAW_BOX(self) ((void) self)
-# define LAYOUT_DEBUG_INIT() ((void) 0)
 #endif
@@ -0,0 +1,71 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/types.h>
+
+/**
+ * index lists for the 16-vertex stylequad geometry. these are shared
+ * between the per-window IBOs and the batched renderer, which copies
+ * them into its own streaming index buffer.
+ */
+
+static const GLubyte stylequad_border_indices[] = {
+	/**
+	 * +---+---+---+
+	 * | 1 | 2 | 3 |
+	 * +---+---+---+
+	 * | 4 | 5 | 6 |
+	 * +---+---+---+
+	 * | 7 | 8 | 9 |
+	 * +---+---+---+
+	 *
+	 * the middle section is not drawn because it's conditionally drawn
+	 * based on whether the texture has defined RTB_TEXTURE_FILL.
+	 * if it is, we'll just draw with solid_indices.
+	 */
+
+	/* 1 */  0,  2,  1,  3,  2,  0,
+	/* 2 */  1,  7,  4,  2,  7,  1,
+	/* 3 */  4,  6,  5,  7,  6,  4,
+
+	/* 4 */  3,  9,  2,  8,  9,  3,
+	/* 5 */
+	/* 6 */  7, 13,  6, 12, 13,  7,
+
+	/* 7 */  8, 10,  9, 11, 10,  8,
+	/* 8 */  9, 15, 12, 10, 15,  9,
+	/* 9 */ 12, 14, 13, 15, 14, 12
+};
+
+static const GLubyte stylequad_solid_indices[] = {
+	2, 7, 9, 12
+};
+
+static const GLubyte stylequad_outline_indices[] = {
+	2, 7, 12, 9
+};
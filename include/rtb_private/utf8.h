@@ -140,3 +140,19 @@ u8chars(const rtb_utf8_t *string)
 
 	return ret;
 }
+
+/**
+ * returns the offset in bytes of character `idx` in `string`, or of the
+ * terminating NUL if `string` is shorter than that.
+ */
+inline static size_t
+u8offset(const rtb_utf8_t *string, size_t idx)
+{
+	const rtb_utf8_t *p;
+
+	for (p = string; *p; p++)
+		if ((*p & 0xC0) != 0x80 && !idx--)
+			break;
+
+	return p - string;
+}
@@ -32,3 +32,7 @@ struct rutabaga *window_impl_rtb_alloc(void);
 void window_impl_close(struct rtb_window *self);
 struct rtb_window *window_impl_open(struct rutabaga *r,
 		int width, int height, const char *title, intptr_t parent);
+
+/* arrange for rtb_window_draw() to be called at the next display
+ * refresh. platforms which draw on a fixed timer can ignore this. */
+void window_impl_schedule_frame(struct rtb_window *self);
@@ -34,6 +34,12 @@
 #define RTB_ASSET_SIZE(a) ((a)->buffer.size)
 #define RTB_ASSET_DATA(a) ((a)->buffer.data)
 
+/* an embedded, compressed asset isn't loaded until it's first used.
+ * see rtb_asset_data(). */
+#define RTB_ASSET_IS_DEFERRED(a)											\
+	(!(a)->loaded && (a)->location == RTB_ASSET_EMBEDDED					\
+	 && (a)->compression == RTB_ASSET_COMPRESSED_XZ)
+
 typedef enum {
 	RTB_ASSET_EXTERNAL = 0,
 	RTB_ASSET_EMBEDDED = 1
@@ -44,6 +50,17 @@ typedef enum {
 	RTB_ASSET_COMPRESSED_XZ = 1
 } rtb_asset_compression_t;
 
+/* where an embedded, compressed asset is decompressed to. it's kept
+ * apart from the asset (which is usually const), filled in the first
+ * time the asset is used, and shared by every window for the life of
+ * the process. */
+struct rtb_asset_cache {
+	/* private ********************************/
+	int state;
+	size_t size;
+	void *data;
+};
+
 struct rtb_asset {
 	/* public *********************************/
 	rtb_asset_location_t location;
@@ -54,6 +71,12 @@ struct rtb_asset {
 	 */
 	struct {
 		char *path;
+
+		/* map the file into memory, read-only, rather than reading it
+		 * into a buffer of our own. every window and process that maps
+		 * the same file shares its pages, and they're only read in as
+		 * they're touched. */
+		int map;
 	} external;
 
 	/**
@@ -61,7 +84,17 @@ struct rtb_asset {
 	 */
 	union {
 		struct {
+			/* the compressed bytes of an embedded asset. */
+			const void *data;
 			size_t deflated_size;
+
+			/* how big it is once it's decompressed, if that's
+			 * known. it's only a hint. */
+			size_t inflated_size;
+
+			/* if set, an embedded asset is decompressed into
+			 * here rather than into a buffer of its own. */
+			struct rtb_asset_cache *cache;
 		} xz;
 	} compressor;
 
@@ -70,10 +103,19 @@ struct rtb_asset {
 
 	struct {
 		int allocated;
+		int mapped;
 		size_t size;
 		const void *data;
 	} buffer;
 };
 
 int rtb_asset_load(struct rtb_asset *);
+
+/* the contents of an asset that's either loaded or deferred. a deferred
+ * one is decompressed into its cache the first time it's asked for
+ * (from any thread), so one that's never used is never decompressed.
+ * returns NULL if it can't be had. */
+const void *rtb_asset_data(const struct rtb_asset *, size_t *size);
+
+/* a font loaded from the asset has to be freed first. */
 void rtb_asset_free(struct rtb_asset *);
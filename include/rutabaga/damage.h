@@ -0,0 +1,78 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <rutabaga/geometry.h>
+
+/**
+ * a damage region is a short list of rectangles (in window coordinates)
+ * that need to be redrawn. once it holds more than
+ * RTB_DAMAGE_MAX_RECTS, it degrades to a single bounding box, and a
+ * region marked `full` covers everything.
+ */
+
+#define RTB_DAMAGE_MAX_RECTS 8
+
+/* number of previously presented frames remembered for buffer-age
+ * repair. a back buffer older than this gets redrawn completely. */
+#define RTB_DAMAGE_HISTORY   4
+
+struct rtb_damage {
+	int full;
+	unsigned int nrects;
+	struct rtb_rect rects[RTB_DAMAGE_MAX_RECTS];
+};
+
+struct rtb_damage_history {
+	struct rtb_damage frames[RTB_DAMAGE_HISTORY];
+
+	/* index of the most recently presented frame */
+	unsigned int head;
+	unsigned int nframes;
+};
+
+void rtb_damage_clear(struct rtb_damage *);
+void rtb_damage_add_all(struct rtb_damage *);
+void rtb_damage_add_rect(struct rtb_damage *, const struct rtb_rect *);
+void rtb_damage_merge(struct rtb_damage *dst, const struct rtb_damage *src);
+int rtb_damage_is_empty(const struct rtb_damage *);
+
+/* returns -1 if the region is empty or full, 0 if `bounds` was set. */
+int rtb_damage_get_bounds(const struct rtb_damage *,
+		struct rtb_rect *bounds);
+
+void rtb_damage_history_push(struct rtb_damage_history *,
+		const struct rtb_damage *frame);
+
+/* adds to `region` everything that changed since a back buffer of
+ * `buffer_age` frames was last presented. an unknown (0) or too-old
+ * age makes the region full. */
+void rtb_damage_history_repair(const struct rtb_damage_history *,
+		unsigned int buffer_age, struct rtb_damage *region);
+
+void rtb_damage_history_init(struct rtb_damage_history *);
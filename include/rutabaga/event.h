@@ -136,6 +136,8 @@ int rtb_register_handler(struct rtb_element *on_elem,
 		rtb_ev_type_t for_type, rtb_event_cb_t handler, void *context);
 void rtb_unregister_handler(struct rtb_element *on_elem,
 		rtb_ev_type_t for_type);
+const struct rtb_event_handler *rtb_find_handler(struct rtb_element *elem,
+		rtb_ev_type_t type);
 
 void rtb_event_loop_init(struct rutabaga *);
 void rtb_event_loop_run(struct rutabaga *);
@@ -27,19 +27,75 @@
 #pragma once
 
 #include <bsd/queue.h>
+#include <uv.h>
 
 #include <rutabaga/shader.h>
 
 #include "freetype-gl/freetype-gl.h"
 #include "freetype-gl/vertex-buffer.h"
 
+struct rtb_text_cache;
+struct rtb_glyph_job;
+struct rtb_window;
+
 #define RTB_FONT(x) RTB_UPCAST(x, rtb_font)
 #define RTB_FONT_AS(x, type) RTB_DOWNCAST(x, type, rtb_font)
 
+/* the size (in points) that distance-field glyphs are rasterised at. */
+#define RTB_FONT_SDF_SIZE 32
+
+typedef enum {
+	/* every size of a face gets its own rasterised copy of each glyph,
+	 * hinted and (with an RGB atlas) subpixel-rendered. */
+	RTB_FONT_RASTER_BITMAP = 0,
+
+	/* each glyph is rasterised once, as a signed distance field, and
+	 * every size of the face scales that. */
+	RTB_FONT_RASTER_SDF
+} rtb_font_raster_t;
+
+/* how long layout waits for glyphs under RTB_GLYPHS_WAIT, by default. */
+#define RTB_FONT_GLYPH_WAIT_MS 8
+
+/**
+ * glyphs which a font hasn't loaded yet are rasterised on the event
+ * loop's threadpool, each batch with a FreeType face of its own. layout
+ * doesn't block on them: they're laid out as blank placeholders, and
+ * once the glyphs have been rasterised they're put in the atlas at the
+ * start of the next frame, and whatever was waiting on them is laid out
+ * again.
+ */
+
+typedef enum {
+	/* lay out placeholders straight away, and swap the glyphs in when
+	 * they land. */
+	RTB_GLYPHS_PLACEHOLDER = 0,
+
+	/* wait up to `glyph_wait_ms` for the glyphs to land, and only fall
+	 * back to placeholders for the ones which take longer than that. */
+	RTB_GLYPHS_WAIT
+} rtb_glyph_policy_t;
+
+/* something laid out with placeholders, which wants to know when glyphs
+ * land. see rtb_font_manager_wait_for_glyphs(). */
+struct rtb_glyph_waiter {
+	void (*glyphs_landed)(struct rtb_glyph_waiter *);
+
+	/* private ********************************/
+	int waiting;
+	unsigned int serial;
+
+	TAILQ_ENTRY(rtb_glyph_waiter) entry;
+};
+
 struct rtb_font {
 	int size;
 	float lcd_gamma;
 
+	/* the font's size over its txfont's. 1 unless the txfont is a
+	 * distance field shared between sizes. */
+	float scale;
+
 	texture_font_t *txfont;
 	struct rtb_font_manager *fm;
 
@@ -51,21 +107,71 @@ struct rtb_external_font {
 	char *path;
 };
 
+/* a distance-field txfont, and how many fonts are using it. */
+struct rtb_sdf_face {
+	texture_font_t *txfont;
+	unsigned int refcount;
+
+	LIST_ENTRY(rtb_sdf_face) entry;
+};
+
 struct rtb_font_manager {
 	struct rtb_font_shader {
 		RTB_INHERIT(rtb_shader);
 
 		GLint atlas_pixel;
 		GLint gamma;
-	} shader;
+	} shader, sdf_shader;
 
 	texture_atlas_t *atlas;
 
+	/* single-channel, and only created (along with `sdf_shader`) once
+	 * the first distance-field font is loaded. */
+	texture_atlas_t *sdf_atlas;
+
 	const rtb_utf32_t *cache_glyphs;
 
+	/* how fonts loaded from here on are rasterised. for the style's
+	 * fonts, set it after opening the window and before any text is
+	 * laid out in it. */
+	rtb_font_raster_t raster;
+
+	/* the window whose event loop's threadpool rasterises glyphs, and
+	 * which gets a frame once they land. a manager without one
+	 * rasterises glyphs right away. */
+	struct rtb_window *window;
+
+	/* what layout does about glyphs which haven't been rasterised
+	 * yet. */
+	rtb_glyph_policy_t glyph_policy;
+	unsigned int glyph_wait_ms;
+
+	/* laid-out text shared between labels. see text-cache.h. */
+	struct rtb_text_cache *text_cache;
+
 	TAILQ_HEAD(managed_fonts, rtb_font) managed_fonts;
+
+	/* private ********************************/
+	LIST_HEAD(sdf_faces, rtb_sdf_face) sdf_faces;
+
+	/* see rtb_font_manager_set_glyph_cache_dir(). */
+	char *glyph_cache_dir;
+
+	/* batches of glyphs being rasterised, or rasterised and waiting for
+	 * libuv to hand them back. workers only touch their own job, and
+	 * only under `glyph_lock`. */
+	TAILQ_HEAD(glyph_jobs, rtb_glyph_job) glyph_jobs;
+	uv_mutex_t glyph_lock;
+	uv_cond_t glyph_rendered;
+
+	TAILQ_HEAD(glyph_waiters, rtb_glyph_waiter) glyph_waiters;
+	unsigned int glyph_serial;
+	int glyphs_landed;
 };
 
+/* `base` has to stay put until every font loaded from it is freed.
+ * nothing reads it after that, so it can be freed (or its asset
+ * unmapped) straight away. */
 int rtb_font_manager_load_embedded_font(struct rtb_font_manager *fm,
 		struct rtb_font *font, int pt_size, const void *base, size_t size);
 void rtb_font_manager_free_embedded_font(struct rtb_font *font);
@@ -74,5 +180,38 @@ int rtb_font_manager_load_external_font(struct rtb_font_manager *fm,
 		struct rtb_external_font *font, int pt_size, const char *path);
 void rtb_font_manager_free_external_font(struct rtb_external_font *font);
 
+/**
+ * sends the glyphs `font` has queued off to be rasterised. under
+ * RTB_GLYPHS_WAIT, it then waits for them. whichever have been
+ * rasterised are put in the atlas. returns 0 if the font has no
+ * placeholders left, so that laying text out again would get every
+ * glyph, and -1 otherwise.
+ */
+int rtb_font_rasterize_queued(const struct rtb_font *font);
+
+/**
+ * has `waiter`'s callback called once, at the start of the frame after
+ * the next glyphs land. waiting again while already waiting does
+ * nothing.
+ */
+void rtb_font_manager_wait_for_glyphs(struct rtb_font_manager *,
+		struct rtb_glyph_waiter *waiter);
+void rtb_font_manager_stop_waiting(struct rtb_font_manager *,
+		struct rtb_glyph_waiter *waiter);
+
+/* puts the glyphs rasterised since the last frame in the atlas, and lets
+ * the waiters know. the window calls this at the start of every frame. */
+void rtb_font_manager_land_glyphs(struct rtb_font_manager *);
+
+/**
+ * the glyphs each font is loaded with (`cache_glyphs`, or the printable
+ * ascii characters) are rasterised once, and kept on disk in `dir` for
+ * the next time that font is loaded, by any process. it starts out as
+ * the platform's cache directory, and NULL turns it off. returns -1 if
+ * there's no memory to copy `dir`, and leaves it as it was.
+ */
+int rtb_font_manager_set_glyph_cache_dir(struct rtb_font_manager *,
+		const char *dir);
+
 int rtb_font_manager_init(struct rtb_font_manager *, int dpi_x, int dpi_y);
 void rtb_font_manager_fini(struct rtb_font_manager *);
@@ -0,0 +1,159 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+
+#include <rutabaga/types.h>
+#include <rutabaga/geometry.h>
+
+/**
+ * per-frame timing. the window wraps every frame it draws, and every
+ * offscreen surface pass within it, in CPU timestamps (uv_hrtime()) and
+ * GL_TIME_ELAPSED queries. the queries are read back a few frames later
+ * so that collecting them never stalls the pipeline.
+ *
+ * the last RTB_FRAME_TIMING_SAMPLES samples of every metric are kept
+ * around, and percentiles are computed from those on request.
+ *
+ * timing is off unless enabled with rtb_frame_timing_enable() (or the
+ * library was configured with --debug-frame).
+ */
+
+struct rtb_window;
+
+#define RTB_FRAME_TIMING_SAMPLES  240
+
+/* how many frames a GPU query gets to complete before we read it back. */
+#define RTB_FRAME_TIMING_LATENCY  4
+
+/* timer queries can't nest, so a frame's GPU time is measured as a
+ * sequence of segments split at the surface pass boundaries. */
+#define RTB_FRAME_TIMING_SEGMENTS 16
+
+typedef enum {
+	/* all of rtb_window_draw(), from RTB_FRAME_START onwards. */
+	RTB_FRAME_CPU_TOTAL = 0,
+
+	/* RTB_FRAME_START handlers. */
+	RTB_FRAME_CPU_UPDATE,
+
+	/* submitting the element tree. includes CPU_SURFACES. */
+	RTB_FRAME_CPU_DRAW,
+
+	/* redrawing offscreen surfaces. */
+	RTB_FRAME_CPU_SURFACES,
+
+	RTB_FRAME_GPU_TOTAL,
+	RTB_FRAME_GPU_SURFACES,
+
+	RTB_FRAME_METRIC_COUNT
+} rtb_frame_metric_t;
+
+typedef enum {
+	RTB_FRAME_STAGE_FRAME,
+	RTB_FRAME_STAGE_UPDATE,
+	RTB_FRAME_STAGE_DRAW,
+	RTB_FRAME_STAGE_SURFACE
+} rtb_frame_stage_t;
+
+/* all in milliseconds. */
+struct rtb_frame_percentiles {
+	float p50;
+	float p95;
+	float p99;
+	float max;
+
+	unsigned int samples;
+};
+
+struct rtb_frame_histogram {
+	float samples[RTB_FRAME_TIMING_SAMPLES];
+	unsigned int head;
+	unsigned int count;
+};
+
+struct rtb_frame_timing {
+	int enabled;
+	int overlay;
+
+	struct rtb_frame_histogram metrics[RTB_FRAME_METRIC_COUNT];
+
+	/* private ********************************/
+	uint64_t frame_start;
+	uint64_t stage_start[RTB_FRAME_STAGE_SURFACE + 1];
+	uint64_t elapsed[RTB_FRAME_METRIC_COUNT];
+	int surface_depth;
+
+	int recording;
+	int gpu_recording;
+	int have_timer_query;
+
+	struct {
+		GLuint queries[RTB_FRAME_TIMING_SEGMENTS];
+		unsigned char is_surface[RTB_FRAME_TIMING_SEGMENTS];
+		unsigned int nsegments;
+		int pending;
+	} gpu[RTB_FRAME_TIMING_LATENCY];
+	unsigned int gpu_frame;
+
+	struct {
+		GLuint vao;
+		GLuint vbo;
+	} overlay_gl;
+};
+
+void rtb_frame_timing_enable(struct rtb_frame_timing *, int enable);
+void rtb_frame_timing_show_overlay(struct rtb_frame_timing *, int show);
+
+/**
+ * returns -1 if no samples of `metric` have been collected yet (timing
+ * is disabled, or the driver doesn't support timer queries).
+ */
+int rtb_frame_timing_get(const struct rtb_frame_timing *,
+		rtb_frame_metric_t metric, struct rtb_frame_percentiles *);
+
+/**
+ * called by the window. stages have to be properly nested, and surface
+ * passes can only happen within RTB_FRAME_STAGE_DRAW.
+ */
+void rtb_frame_timing_begin(struct rtb_frame_timing *, rtb_frame_stage_t);
+void rtb_frame_timing_end(struct rtb_frame_timing *, rtb_frame_stage_t);
+
+/* throws away the frame begun with RTB_FRAME_STAGE_FRAME without
+ * recording anything, for frames which turn out not to draw. */
+void rtb_frame_timing_cancel(struct rtb_frame_timing *);
+
+/* the screen area the overlay covers, in window coordinates. */
+void rtb_frame_timing_overlay_rect(const struct rtb_frame_timing *,
+		struct rtb_rect *);
+void rtb_frame_timing_draw_overlay(struct rtb_frame_timing *,
+		struct rtb_window *);
+
+int rtb_frame_timing_init(struct rtb_frame_timing *);
+void rtb_frame_timing_fini(struct rtb_frame_timing *);
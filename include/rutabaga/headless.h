@@ -0,0 +1,69 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <rutabaga/types.h>
+#include <rutabaga/window.h>
+#include <rutabaga/keyboard.h>
+
+/**
+ * extras for the headless platform (configure with --platform=headless),
+ * which renders into an offscreen EGL pbuffer instead of a window.
+ *
+ * input is injected through the rtb__platform_mouse_*() functions in
+ * rutabaga/platform.h, the same way the other platforms deliver real
+ * input.
+ */
+
+/**
+ * lays out the window if it hasn't been yet, then draws a frame if
+ * anything is dirty. passing 1 for `force` redraws everything.
+ * returns whether anything was drawn.
+ *
+ * this doesn't need the event loop. with rtb_event_loop_run(), frames
+ * are drawn as they're requested.
+ */
+int rtb_headless_draw_frame(struct rtb_window *, int force);
+
+/**
+ * copies the last frame into `pixels`, which has to hold w * h * 4
+ * bytes: RGBA, 8 bits per channel, top row first.
+ *
+ * returns -1 if no frame has been drawn yet.
+ */
+int rtb_headless_read_pixels(struct rtb_window *, void *pixels);
+
+/**
+ * runs whatever the event loop has pending (requested frames, timers)
+ * without blocking. the loop has to have been set up with
+ * rtb_event_loop_init().
+ */
+void rtb_headless_run_pending(struct rutabaga *);
+
+/* what rtb_get_modkeys() will report from now on. */
+void rtb_headless_set_modkeys(struct rtb_window *, rtb_modkey_t);
@@ -27,6 +27,7 @@
 #pragma once
 
 #include <rutabaga/geometry.h>
+#include <rutabaga/render-state.h>
 
 #define RTB_QUAD(x) RTB_UPCAST(x, rtb_quad)
 #define RTB_QUAD_AS(x, type) RTB_DOWNCAST(x, type, rtb_quad)
@@ -34,10 +35,20 @@
 struct rtb_quad {
 	GLuint tex_coords;
 	GLuint vertices;
+
+	/* attribute setup for the above, done once when a buffer is first
+	 * filled. the vertices are in outline order, so a solid quad is
+	 * drawn as a triangle fan. */
+	GLuint vao;
 };
 
-void rtb_quad_set_tex_coords(struct rtb_quad *, struct rtb_rect *from);
-void rtb_quad_set_vertices(struct rtb_quad *, struct rtb_rect *from);
+/* the GL objects are created the first time the vertices are set, with
+ * binds going through `state`. texture coordinates can only be set
+ * once there are vertices. */
+void rtb_quad_set_tex_coords(struct rtb_quad *,
+		struct rtb_render_state *state, struct rtb_rect *from);
+void rtb_quad_set_vertices(struct rtb_quad *,
+		struct rtb_render_state *state, struct rtb_rect *from);
 
 void rtb_quad_init(struct rtb_quad *);
 void rtb_quad_fini(struct rtb_quad *);
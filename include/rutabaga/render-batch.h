@@ -0,0 +1,142 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/types.h>
+#include <rutabaga/shader.h>
+
+#include "wwrl/vector.h"
+
+struct rtb_render_context;
+
+/**
+ * the render batch collects stylequad geometry for every element drawn
+ * into a surface and submits it in as few draw calls as possible.
+ *
+ * vertices are transformed on the CPU, and each one carries the colour,
+ * texture mode and scissor rectangle of the element it belongs to, so
+ * elements with different clip regions can still share a draw call.
+ * consecutive primitives are merged into a single run as long as their
+ * primitive type and texture are compatible.
+ *
+ * text goes into the same batch as the stylequads, so that the two stay
+ * in drawing order, and a run of labels sampling the same glyph atlas
+ * comes out as one draw call.
+ */
+
+typedef enum {
+	RTB_BATCH_UNTEXTURED = 0,
+	RTB_BATCH_TEXTURED   = 1,
+
+	/* glyphs from a single-channel atlas, tinted with the vertex
+	 * colour. */
+	RTB_BATCH_TEXT       = 2,
+
+	/* glyphs from an RGB atlas, filtered for subpixel positioning. */
+	RTB_BATCH_TEXT_LCD   = 3,
+
+	/* glyphs from a signed distance field, at any scale. */
+	RTB_BATCH_TEXT_SDF   = 4
+} rtb_batch_texture_mode_t;
+
+struct rtb_batch_shader {
+	RTB_INHERIT(rtb_shader);
+
+	GLint vertex_color;
+	GLint clip_rect;
+	GLint textured;
+	GLint text_params;
+};
+
+struct rtb_batch_vertex {
+	GLfloat x, y;
+	GLfloat s, t;
+
+	/* framebuffer coordinates: x, y, x2, y2 */
+	GLfloat clip[4];
+
+	GLubyte color[4];
+
+	/* an rtb_batch_texture_mode_t. */
+	GLfloat textured;
+
+	/* for text: the glyph's subpixel shift and the font's gamma. */
+	GLfloat text[2];
+};
+
+struct rtb_batch_run {
+	GLenum mode;
+	GLuint texture;
+
+	GLsizei first;
+	GLsizei count;
+};
+
+struct rtb_render_batch {
+	VECTOR(rtb_batch_vertices, struct rtb_batch_vertex) vertices;
+	VECTOR(rtb_batch_indices, GLuint) indices;
+	VECTOR(rtb_batch_runs, struct rtb_batch_run) runs;
+
+	GLuint vbo;
+	GLuint ibo;
+	GLuint vao;
+
+	/* running totals, never reset by the batch itself. `submitted` is
+	 * the number of draw calls the unbatched path would have made. */
+	struct {
+		unsigned long submitted;
+		unsigned long draw_calls;
+		unsigned long flushes;
+	} stats;
+};
+
+/**
+ * `mode` is one of GL_TRIANGLES, GL_TRIANGLE_STRIP, GL_LINES or
+ * GL_LINE_LOOP. strips and loops are converted into lists so that they
+ * can be merged with neighbouring primitives.
+ *
+ * `texture` is 0 for untextured geometry. `indices` refer into
+ * `vertices`, and only the vertices which are referenced get copied.
+ * returns -1, and adds nothing, if the batch can't grow.
+ */
+int rtb_render_batch_add(struct rtb_render_batch *, GLenum mode,
+		GLuint texture, const struct rtb_batch_vertex *vertices,
+		const GLubyte *indices, GLsizei count);
+/**
+ * reserves room for `nquads` quads textured with `texture`, which is
+ * drawn as a triangle list of {0, 1, 2} and {0, 2, 3} for each quad's
+ * four vertices. returns the vertices for the caller to fill in; they
+ * stay valid until the next addition to the batch. returns NULL if the
+ * batch can't grow.
+ */
+struct rtb_batch_vertex *rtb_render_batch_add_quads(struct rtb_render_batch *,
+		GLuint texture, GLsizei nquads);
+void rtb_render_batch_flush(struct rtb_render_batch *,
+		struct rtb_render_context *);
+
+int rtb_render_batch_init(struct rtb_render_batch *);
+void rtb_render_batch_fini(struct rtb_render_batch *);
@@ -0,0 +1,120 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <rutabaga/types.h>
+
+/**
+ * shadow copy of the GL state that the renderer touches on every frame.
+ * calls which wouldn't change anything are dropped instead of being
+ * passed through to the driver.
+ *
+ * GL state belongs to the GL context, not to any one surface, so there
+ * is one of these per window and every surface's render context points
+ * at it.
+ *
+ * anything that changes GL state behind the tracker's back (texture
+ * uploads, third-party code) has to invalidate the affected bits. the
+ * whole thing is invalidated at the start of every frame.
+ *
+ * the element array buffer binding is part of the vertex array object,
+ * so binding a different VAO forgets it.
+ */
+
+typedef enum {
+	RTB_RENDER_STATE_PROGRAM              = 1 << 0,
+	RTB_RENDER_STATE_ARRAY_BUFFER         = 1 << 1,
+	RTB_RENDER_STATE_ELEMENT_ARRAY_BUFFER = 1 << 2,
+	RTB_RENDER_STATE_TEXTURE              = 1 << 3,
+	RTB_RENDER_STATE_FRAMEBUFFER          = 1 << 4,
+	RTB_RENDER_STATE_BLEND                = 1 << 5,
+	RTB_RENDER_STATE_SCISSOR              = 1 << 6,
+	RTB_RENDER_STATE_SCISSOR_TEST         = 1 << 7,
+	RTB_RENDER_STATE_VIEWPORT             = 1 << 8,
+
+	/* buffer bound to RTB_UNIFORM_BLOCK_MATRICES */
+	RTB_RENDER_STATE_UNIFORM_BUFFER       = 1 << 9,
+	RTB_RENDER_STATE_VERTEX_ARRAY         = 1 << 10,
+
+	RTB_RENDER_STATE_BUFFERS =
+		RTB_RENDER_STATE_ARRAY_BUFFER
+		| RTB_RENDER_STATE_ELEMENT_ARRAY_BUFFER,
+
+	RTB_RENDER_STATE_ALL = (1 << 11) - 1
+} rtb_render_state_bits_t;
+
+struct rtb_render_state {
+	/* bitmask of rtb_render_state_bits_t which are known to match
+	 * what's actually bound. */
+	unsigned int known;
+
+	GLuint program;
+	GLuint array_buffer;
+	GLuint element_array_buffer;
+	GLuint texture;
+	GLuint framebuffer;
+	GLuint uniform_buffer;
+	GLuint vertex_array;
+
+	struct {
+		GLenum src;
+		GLenum dst;
+	} blend;
+
+	int scissor_test;
+	GLint scissor[4];
+	GLint viewport[4];
+
+	struct {
+		unsigned long issued;
+		unsigned long elided;
+	} stats;
+};
+
+void rtb_render_state_invalidate(struct rtb_render_state *,
+		unsigned int bits);
+
+void rtb_render_state_use_program(struct rtb_render_state *, GLuint program);
+void rtb_render_state_bind_buffer(struct rtb_render_state *,
+		GLenum target, GLuint buffer);
+void rtb_render_state_bind_texture(struct rtb_render_state *, GLuint texture);
+void rtb_render_state_bind_framebuffer(struct rtb_render_state *,
+		GLuint framebuffer);
+void rtb_render_state_bind_uniform_buffer(struct rtb_render_state *,
+		GLuint buffer);
+void rtb_render_state_bind_vertex_array(struct rtb_render_state *,
+		GLuint vertex_array);
+
+void rtb_render_state_blend_func(struct rtb_render_state *,
+		GLenum src, GLenum dst);
+void rtb_render_state_scissor(struct rtb_render_state *,
+		GLint x, GLint y, GLsizei w, GLsizei h);
+void rtb_render_state_scissor_test(struct rtb_render_state *, int enabled);
+void rtb_render_state_viewport(struct rtb_render_state *,
+		GLint x, GLint y, GLsizei w, GLsizei h);
+
+void rtb_render_state_init(struct rtb_render_state *);
@@ -33,14 +33,45 @@ struct rtb_render_context;
 #include <rutabaga/shader.h>
 #include <rutabaga/quad.h>
 #include <rutabaga/mat4.h>
+#include <rutabaga/render-batch.h>
+#include <rutabaga/render-state.h>
 
 #include "bsd/queue.h"
 
+/**
+ * std140 layout of the `matrices` uniform block shared by all shaders.
+ * each render context has its own copy in a uniform buffer, bound to
+ * RTB_UNIFORM_BLOCK_MATRICES while drawing into that context.
+ */
+struct rtb_render_uniforms {
+	mat4 projection;
+	mat4 modelview;
+};
+
 struct rtb_render_context {
 	struct rtb_window *window;
+	struct rtb_render_state *state;
 	const struct rtb_shader *shader;
 
 	mat4 projection;
+
+	/* private ********************************/
+	GLuint uniform_buffer;
+	int modelview_is_identity;
+
+	/* element whose scissor and blend state still has to be applied
+	 * before the next unbatched draw. see rtb_render_push(). */
+	struct rtb_element *pending_element;
+
+	/* if active, every scissor box handed out for this context is also
+	 * clipped to `box`. the window uses this to confine a frame to its
+	 * damaged region. see rtb_render_set_clip(). */
+	struct {
+		int active;
+		GLint box[4];
+	} clip;
+
+	struct rtb_render_batch batch;
 };
 
 struct rtb_style_property_definition;
@@ -55,6 +86,7 @@ void rtb_render_set_color(struct rtb_render_context *,
 		GLfloat r, GLfloat g, GLfloat b, GLfloat a);
 
 void rtb_render_set_position(struct rtb_render_context *, float x, float y);
+void rtb_render_set_projection(struct rtb_render_context *, const mat4 *);
 void rtb_render_set_modelview(struct rtb_render_context *,
 		const GLfloat *matrix);
 
@@ -62,8 +94,15 @@ void rtb_render_quad_outline(struct rtb_render_context *, struct rtb_quad *);
 void rtb_render_quad(struct rtb_render_context *, struct rtb_quad *);
 void rtb_render_clear(struct rtb_element *);
 
+void rtb_render_get_scissor(struct rtb_element *, GLint scissor[4]);
+void rtb_render_set_clip(struct rtb_render_context *, const GLint box[4]);
+void rtb_render_flush(struct rtb_render_context *);
+
 void rtb_render_use_shader(struct rtb_render_context *, const struct rtb_shader *);
 void rtb_render_reset(struct rtb_element *);
 void rtb_render_push(struct rtb_element *);
 void rtb_render_pop(struct rtb_element *);
 struct rtb_render_context *rtb_render_get_context(struct rtb_element *);
+
+int rtb_render_context_init(struct rtb_render_context *);
+void rtb_render_context_fini(struct rtb_render_context *);
@@ -30,9 +30,19 @@
 
 #define RTB_SHADER(x) RTB_UPCAST(x, rtb_shader)
 
+/* binding point of the `matrices` uniform block. every shader created
+ * through rtb_shader_create() has its block bound here, so switching
+ * programs doesn't mean re-uploading any matrices. */
+#define RTB_UNIFORM_BLOCK_MATRICES 0
+
+/* the `vertex` and `tex_coord` attributes are bound to these locations
+ * before linking, so that a vertex array object can be set up once
+ * without knowing which shader it's going to be drawn with. */
+#define RTB_ATTRIB_VERTEX    0
+#define RTB_ATTRIB_TEX_COORD 1
+
 struct rtb_shader_locations {
-	const char *modelview;
-	const char *projection;
+	const char *matrices;
 
 	const char *offset;
 	const char *color;
@@ -51,10 +61,7 @@ struct rtb_shader {
 	GLuint fragment_shader;
 
 	/*************** cached uniform and attrib locations */
-	struct {
-		GLuint modelview;
-		GLuint projection;
-	} matrices;
+	GLuint matrices;
 
 	/* uniforms */
 	GLint offset;
@@ -82,6 +82,24 @@ struct rtb_style_texture_definition {
 	struct {
 		unsigned int top, right, bottom, left;
 	} border;
+
+	/* set (`w` isn't 0) if the image was packed into an atlas when the
+	 * style was built. the asset is then the whole atlas, `w` by `h`,
+	 * and the image is the rectangle at `x`, `y` in it. every image in
+	 * an atlas shares its slot, and so its texture. */
+	struct {
+		unsigned int x, y, w, h;
+	} atlas;
+
+	/* private ********************************/
+	size_t slot;
+};
+
+/* one per texture slot, shared by every element in the window that
+ * references the same image. */
+struct rtb_style_texture {
+	GLuint gl_handle;
+	unsigned int refcount;
 };
 
 struct rtb_rgb_color {
@@ -119,6 +137,7 @@ struct rtb_style {
 struct rtb_style_data {
 	struct rtb_style *style;
 	size_t nfonts;
+	size_t ntextures;
 };
 
 /**
@@ -141,7 +160,26 @@ struct rtb_style *rtb_style_for_element(struct rtb_element *elem,
 
 int rtb_style_resolve_list(struct rtb_window *,
 		struct rtb_style *style_list);
+/* drops the type references taken by rtb_style_resolve_list(). */
+void rtb_style_unresolve_list(struct rtb_window *,
+		struct rtb_style *style_list);
 
+/* called by rtb_type_ref() when a type is first registered, which is
+ * when the first widget of that type is attached. widgets can be
+ * attached long after the window resolved its style list. */
+void rtb_style_type_registered(struct rtb_window *,
+		struct rtb_type_atom_descriptor *type);
+
+GLuint rtb_style_texture_ref(struct rtb_window *,
+		const struct rtb_style_texture_definition *);
+void rtb_style_texture_unref(struct rtb_window *,
+		const struct rtb_style_texture_definition *);
+void rtb_style_textures_fini(struct rtb_window *);
+
+/* a style font is only loaded (its face decompressed, and its glyphs
+ * rasterised) the first time it's asked for, so a window only pays for
+ * the fonts its widgets lay text out with. returns NULL if it can't be
+ * loaded, which is only tried (and reported) once. */
 struct rtb_font *rtb_style_get_font_for_def(struct rtb_window *,
 		const struct rtb_style_font_definition *);
 
@@ -48,7 +48,15 @@ typedef enum {
 struct rtb_stylequad {
 	struct rtb_point offset;
 
+	/* owner of the texture cache `border_image` and `background_image`
+	 * hold references into. */
+	struct rtb_window *window;
+
 	GLuint vertices;
+	GLuint vao;
+
+	/* client-side copy of `vertices` for the render batch */
+	GLfloat geometry[16][2];
 
 	struct {
 		const struct rtb_rgb_color *bg_color;
@@ -57,8 +65,10 @@ struct rtb_stylequad {
 
 	struct rtb_stylequad_texture {
 		const struct rtb_style_texture_definition *definition;
-		GLuint gl_handle;
+		GLuint gl_handle; /* borrowed from the window's texture cache */
 		GLuint coords;
+		GLuint vao;
+		GLfloat coord_data[16][2];
 	} border_image, background_image;
 };
 
@@ -67,16 +77,18 @@ void rtb_stylequad_draw(const struct rtb_stylequad *,
 		rtb_stylequad_draw_mode_t);
 void rtb_stylequad_draw_solid(const struct rtb_stylequad *self,
 		struct rtb_render_context *ctx, const struct rtb_point *center);
-void rtb_stylequad_draw_on_element(struct rtb_stylequad *,
+/* these add the quad to the batch of the surface `on` is drawn into, and
+ * return -1 if the batch can't grow. */
+int rtb_stylequad_draw_on_element(struct rtb_stylequad *,
 		struct rtb_element *, rtb_stylequad_draw_mode_t);
-void rtb_stylequad_draw_with_modelview(struct rtb_stylequad *,
+int rtb_stylequad_draw_with_modelview(struct rtb_stylequad *,
 		struct rtb_element *, const mat4 *modelview,
 		rtb_stylequad_draw_mode_t);
 
 int rtb_stylequad_set_border_image(struct rtb_stylequad *,
-		const struct rtb_style_texture_definition *);
+		struct rtb_window *, const struct rtb_style_texture_definition *);
 int rtb_stylequad_set_background_image(struct rtb_stylequad *,
-		const struct rtb_style_texture_definition *);
+		struct rtb_window *, const struct rtb_style_texture_definition *);
 int rtb_stylequad_set_background_color(struct rtb_stylequad *,
 		const struct rtb_rgb_color *);
 int rtb_stylequad_set_border_color(struct rtb_stylequad *,
@@ -30,6 +30,7 @@
 #include <rutabaga/types.h>
 #include <rutabaga/element.h>
 #include <rutabaga/render.h>
+#include <rutabaga/damage.h>
 #include <rutabaga/mat4.h>
 
 #define RTB_SURFACE(x) RTB_UPCAST(x, rtb_surface)
@@ -51,6 +52,11 @@ struct rtb_surface {
 
 	rtb_surface_state_t surface_state;
 
+	/* what the next rtb_surface_draw_children() is going to touch:
+	 * the rect of everything in the render queue, or all of it if the
+	 * surface is invalid. */
+	struct rtb_damage damage;
+
 	struct rtb_render_tailq render_queue;
 	struct rtb_render_context render_ctx;
 };
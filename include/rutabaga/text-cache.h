@@ -0,0 +1,137 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <bsd/queue.h>
+
+#include <rutabaga/types.h>
+#include <rutabaga/text-object.h>
+
+#define RTB_TEXT_RUN(x) RTB_UPCAST(x, rtb_text_run)
+
+/**
+ * shared glyph runs. labels with the same text in the same font all
+ * draw the same laid-out text object instead of each building their
+ * own. runs are refcounted and must not be modified; once nothing
+ * refers to a run any more it's kept around on an LRU list, in case the
+ * same text shows up again, until there are more than `max_unused` of
+ * them or they take up more than `max_unused_bytes`.
+ */
+
+#define RTB_TEXT_CACHE_MAX_UNUSED       256
+#define RTB_TEXT_CACHE_MAX_UNUSED_BYTES (4 << 20)
+
+struct rtb_text_run {
+	RTB_INHERIT(rtb_text_object);
+
+	/* private ********************************/
+	struct rtb_text_cache *cache;
+	unsigned int refcount;
+
+	rtb_utf8_t *text;
+	float line_height_multiplier;
+	uint32_t hash;
+
+	/* bytes of vertex, index and glyph data, counted on both the CPU
+	 * and the GPU side. */
+	size_t bytes;
+
+	LIST_ENTRY(rtb_text_run) bucket_entry;
+	TAILQ_ENTRY(rtb_text_run) unused_entry;
+};
+
+struct rtb_text_cache_stats {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long evictions;
+
+	/* runs currently in the cache, used or not, and the bytes they
+	 * take up. */
+	unsigned int runs;
+	size_t bytes;
+
+	/* what the runs that are shared right now would take up if every
+	 * user had its own copy, minus what they do take up. */
+	size_t bytes_saved;
+};
+
+struct rtb_text_cache {
+	unsigned int max_unused;
+	size_t max_unused_bytes;
+
+	struct rtb_text_cache_stats stats;
+
+	/* private ********************************/
+	struct rtb_font_manager *fm;
+
+	LIST_HEAD(rtb_text_run_bucket, rtb_text_run) *buckets;
+	unsigned int nbuckets;
+
+	TAILQ_HEAD(, rtb_text_run) unused;
+	unsigned int nunused;
+	size_t unused_bytes;
+};
+
+/**
+ * returns a reference to the run for `text` laid out in `font`, laying
+ * it out if it isn't in the cache. NULL if there's no text or it
+ * couldn't be laid out.
+ */
+struct rtb_text_run *rtb_text_cache_get(struct rtb_text_cache *,
+		struct rtb_font *font, const rtb_utf8_t *text,
+		float line_height_multiplier);
+void rtb_text_run_release(struct rtb_text_run *);
+
+/**
+ * lays a run which has placeholders in it (see font-manager.h) out
+ * again, for when its glyphs have landed. this is the one change runs
+ * can go through while they're shared, since it leaves them how they
+ * would have been laid out in the first place.
+ */
+void rtb_text_run_refresh(struct rtb_text_run *);
+
+/**
+ * drops the unused runs laid out in `font`, so that a font allocated at
+ * the same address later on can't be mistaken for it.
+ */
+void rtb_text_cache_forget_font(struct rtb_text_cache *,
+		const struct rtb_font *font);
+
+/* hits over lookups, 0 before the first one. */
+float rtb_text_cache_hit_rate(const struct rtb_text_cache *);
+
+struct rtb_text_cache *rtb_text_cache_new(struct rtb_font_manager *);
+
+/**
+ * runs which are still in use when the cache is freed are cut loose,
+ * and freed by their last release.
+ */
+void rtb_text_cache_free(struct rtb_text_cache *);
@@ -40,18 +40,52 @@ struct rtb_text_object {
 	vertex_buffer_t *vertices;
 	struct rtb_font_manager *fm;
 	const struct rtb_font *font;
+
+	/* private ********************************/
+	vector_t *glyphs;
+	GLfloat baseline;
+
+	/* set if the text is a single line with a glyph for every
+	 * character, which is what rtb_text_object_splice() can handle. */
+	int spliceable;
+
+	/* how many of the glyphs are placeholders, waiting to be
+	 * rasterised. see font-manager.h. */
+	unsigned int pending;
 };
 
 int rtb_text_object_get_glyph_rect(struct rtb_text_object *, int idx,
 		struct rtb_rect *rect);
 int rtb_text_object_count_glyphs(struct rtb_text_object *);
 
+/* glyphs which the font doesn't have yet are laid out as placeholders
+ * (see font-manager.h). if `pending` is set afterwards, the text has to
+ * be laid out again once they land. */
 int rtb_text_object_update(struct rtb_text_object *,
-		struct rtb_font *rfont, const rtb_utf8_t *text,
+		const struct rtb_font *rfont, const rtb_utf8_t *text,
 		float line_height_multiplier);
+
+/* replaces `ndelete` glyphs starting at `idx` with the glyphs for `text`,
+ * laying out only what comes after them. returns -1 (and changes
+ * nothing) if it can't, in which case the caller should fall back to
+ * rtb_text_object_update() with the whole text. */
+int rtb_text_object_splice(struct rtb_text_object *, int idx, int ndelete,
+		const rtb_utf8_t *text);
+/* adds the text to the batch of the surface `on` is drawn into, clipped
+ * to `on`, in order with everything else drawn there. returns -1 if the
+ * batch can't grow. */
+int rtb_text_object_draw_on_element(struct rtb_text_object *,
+		struct rtb_element *on, float x, float y,
+		const struct rtb_rgb_color *color);
+
+/* draws the text right away, with the text shader. */
 void rtb_text_object_render(struct rtb_text_object *,
 		struct rtb_render_context *ctx, float x, float y,
 		const struct rtb_rgb_color *color);
 
+int rtb_text_object_init(struct rtb_text_object *,
+		struct rtb_font_manager *fm);
+void rtb_text_object_fini(struct rtb_text_object *);
+
 struct rtb_text_object *rtb_text_object_new(struct rtb_font_manager *fm);
 void rtb_text_object_free(struct rtb_text_object *self);
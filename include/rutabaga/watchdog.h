@@ -0,0 +1,147 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdint.h>
+
+struct rtb_window;
+struct rtb_element;
+
+/**
+ * frame budget watchdog. while enabled, every element's draw, reflow,
+ * restyle and layout calls are timed, and whenever a frame takes longer
+ * than the budget, the elements which used the time are reported.
+ *
+ * a frame's cost is the time spent in rtb_window_draw() plus whatever
+ * the timed calls took in between frames (restyles and reflows in
+ * event handlers, for example), since that's what held the frame up.
+ *
+ * times are exclusive: a container is only charged for what it did
+ * itself, not for the calls it made on its children.
+ */
+
+#define RTB_WATCHDOG_REPORT_ENTRIES 8
+#define RTB_WATCHDOG_TYPE_MAX 64
+#define RTB_WATCHDOG_PATH_MAX 64
+
+typedef enum {
+	RTB_WATCHDOG_DRAW = 0,
+	RTB_WATCHDOG_REFLOW,
+	RTB_WATCHDOG_RESTYLE,
+	RTB_WATCHDOG_LAYOUT,
+
+	RTB_WATCHDOG_CALL_KINDS
+} rtb_watchdog_call_t;
+
+struct rtb_watchdog_entry {
+	const struct rtb_element *elem;
+	rtb_watchdog_call_t kind;
+
+	uint64_t self_ns;
+	unsigned int calls;
+
+	/* captured when the element was first seen this frame, so they
+	 * stay valid even if the element has gone away since. the path is
+	 * the list of child indices leading down from the window, like
+	 * "/0/3/1". */
+	char type[RTB_WATCHDOG_TYPE_MAX];
+	char path[RTB_WATCHDOG_PATH_MAX];
+};
+
+struct rtb_watchdog_report {
+	float frame_ms;
+	float budget_ms;
+
+	/* slowest first. */
+	struct rtb_watchdog_entry entries[RTB_WATCHDOG_REPORT_ENTRIES];
+	unsigned int nentries;
+
+	/* calls which didn't fit into the table and went unattributed. */
+	unsigned int dropped;
+};
+
+typedef void (*rtb_watchdog_cb_t)(struct rtb_window *,
+		const struct rtb_watchdog_report *, void *ctx);
+
+struct rtb_frame_watchdog {
+	/* 0 when disabled. checked before anything else in the element
+	 * hooks, so a disabled watchdog costs a load and a branch. */
+	int enabled;
+	float budget_ms;
+
+	rtb_watchdog_cb_t cb;
+	void *cb_ctx;
+
+	/* private ********************************/
+	struct rtb_watchdog_entry *table;
+	unsigned int nused;
+	unsigned int dropped;
+
+	struct {
+		uint64_t start;
+		uint64_t child_ns;
+	} *stack;
+	unsigned int depth;
+
+	int in_frame;
+	uint64_t frame_start;
+	uint64_t between_ns;
+};
+
+/**
+ * a budget of 0 disables the watchdog.
+ */
+int rtb_frame_watchdog_set_budget(struct rtb_frame_watchdog *,
+		float budget_ms);
+
+/**
+ * reports go to `cb` if one is set, otherwise they're written to
+ * stderr.
+ */
+void rtb_frame_watchdog_set_callback(struct rtb_frame_watchdog *,
+		rtb_watchdog_cb_t cb, void *ctx);
+
+const char *rtb_watchdog_call_name(rtb_watchdog_call_t);
+
+/**
+ * called by the window.
+ */
+void rtb_frame_watchdog_frame_begin(struct rtb_frame_watchdog *);
+void rtb_frame_watchdog_frame_cancel(struct rtb_frame_watchdog *);
+void rtb_frame_watchdog_frame_end(struct rtb_frame_watchdog *,
+		struct rtb_window *);
+
+/**
+ * called by the element hooks. see rtb_private/watchdog.h.
+ */
+void rtb_frame_watchdog_enter(struct rtb_frame_watchdog *);
+void rtb_frame_watchdog_leave(struct rtb_frame_watchdog *,
+		const struct rtb_element *, rtb_watchdog_call_t);
+
+void rtb_frame_watchdog_init(struct rtb_frame_watchdog *);
+void rtb_frame_watchdog_fini(struct rtb_frame_watchdog *);
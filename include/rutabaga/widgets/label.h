@@ -30,6 +30,8 @@
 #include <rutabaga/element.h>
 #include <rutabaga/text-object.h>
 
+struct rtb_text_run;
+
 #define RTB_LABEL(x) RTB_UPCAST(x, rtb_label)
 
 struct rtb_label {
@@ -41,10 +43,25 @@ struct rtb_label {
 	struct rtb_font *font;
 	struct rtb_text_object *tobj;
 	const struct rtb_rgb_color *color;
+
+	/* set while `tobj` is a run shared through the font manager's text
+	 * cache, which nothing may modify. a label only gets a text object
+	 * of its own once its text changes while it's attached. */
+	struct rtb_text_run *run;
+
+	/* on the font manager's list while the text has placeholders in
+	 * it. */
+	struct rtb_glyph_waiter glyph_waiter;
 };
 
 void rtb_label_set_text(struct rtb_label *, const rtb_utf8_t *text);
 
+/* replaces `ndelete` characters starting at character `idx` with `text`.
+ * cheaper than setting the whole text again for small edits to a single
+ * line. */
+void rtb_label_splice_text(struct rtb_label *, int idx, int ndelete,
+		const rtb_utf8_t *text);
+
 int rtb_label_init(struct rtb_label *);
 void rtb_label_fini(struct rtb_label *);
 
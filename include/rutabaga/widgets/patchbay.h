@@ -87,6 +87,7 @@ struct rtb_patchbay {
 
 	/* private ********************************/
 	GLuint bg_vbo[2];
+	GLuint bg_vao[2];
 	GLuint bg_texture;
 	struct rtb_point texture_offset;
 
@@ -50,6 +50,7 @@ struct rtb_text_input {
 
 	struct rtb_quad bg_quad;
 	GLuint cursor_vbo;
+	GLuint cursor_vao;
 };
 
 int rtb_text_input_set_text(struct rtb_text_input *,
@@ -32,9 +32,13 @@
 #include <rutabaga/element.h>
 #include <rutabaga/shader.h>
 #include <rutabaga/surface.h>
+#include <rutabaga/quad.h>
+#include <rutabaga/render-batch.h>
 #include <rutabaga/mouse.h>
 #include <rutabaga/event.h>
 #include <rutabaga/font-manager.h>
+#include <rutabaga/frame-timing.h>
+#include <rutabaga/watchdog.h>
 
 #define RTB_WINDOW(x) RTB_UPCAST(x, rtb_window)
 #define RTB_WINDOW_AS(x, type) RTB_DOWNCAST(x, type, rtb_window)
@@ -51,6 +55,7 @@ struct rtb_window_local_storage {
 		struct rtb_shader dfault;
 		struct rtb_shader surface;
 		struct rtb_shader stylequad;
+		struct rtb_batch_shader batch;
 	} shader;
 
 	struct {
@@ -76,6 +81,14 @@ struct rtb_window {
 
 	struct rtb_style *style_list;
 	struct rtb_font *style_fonts;
+	/* set for style fonts that couldn't be loaded, which aren't tried
+	 * (or reported) again. */
+	unsigned char *style_fonts_failed;
+	struct rtb_style_texture *style_textures;
+	size_t nstyle_textures;
+
+	struct rtb_frame_timing frame_timing;
+	struct rtb_frame_watchdog watchdog;
 
 	/* private ********************************/
 	int finished_initialising;
@@ -88,11 +101,22 @@ struct rtb_window {
 	struct rutabaga *rtb;
 
 	GLuint vao;
+	struct rtb_render_state render_state;
 
 	int need_reconfigure;
 	int dirty;
+
+	/* age of the back buffer the next frame will be drawn into, as
+	 * reported by the platform. 0 means unknown, which always gets a
+	 * full redraw. */
+	unsigned int buffer_age;
+	struct rtb_damage_history damage_history;
+	int frame_timing_overlay_drawn;
 	uv_mutex_t lock;
 
+	/* only drawn into when the library is built with layout debugging. */
+	struct rtb_quad layout_debug_quad;
+
 	struct rtb_mouse mouse;
 	struct rtb_element *focus;
 };
@@ -106,6 +130,17 @@ struct rtb_window {
  */
 int rtb_window_draw(struct rtb_window *, int force_redraw);
 
+/**
+ * frames are only drawn on demand: when something has been marked dirty,
+ * or when a frame has been requested. a request is good for exactly one
+ * frame (with its RTB_FRAME_START and RTB_FRAME_END events).
+ *
+ * a window with an RTB_FRAME_START handler registered keeps requesting
+ * frames for itself until the handler is unregistered. registering one
+ * doesn't wake an idle window, though, so request the first frame.
+ */
+void rtb_window_request_frame(struct rtb_window *);
+
 void rtb_window_focus_element(struct rtb_window *,
 		struct rtb_element *focused);
 
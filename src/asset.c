@@ -27,9 +27,15 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <uv.h>
+
+#ifdef RTB_ASSET_XZ
+#include <lzma.h>
+#endif
 
 #include <rutabaga/asset.h>
 #include "rtb_private/util.h"
+#include "rtb_private/mapped-file.h"
 
 /**
  * loaders
@@ -41,6 +47,26 @@ typedef int (*loader_func)(struct rtb_asset *asset);
  * uncompressed
  */
 
+static int
+map_ext(struct rtb_asset *asset)
+{
+	struct rtb_mapped_file file;
+
+	if (rtb_mapped_file_open(&file, asset->external.path)) {
+		fprintf(stderr, "rtb_asset: couldn't map \"%s\"\n",
+				asset->external.path);
+		return -1;
+	}
+
+	/* if it couldn't be mapped, it was read into a buffer instead. */
+	asset->buffer.size = file.size;
+	asset->buffer.data = file.data;
+	asset->buffer.mapped = file.mapped;
+	asset->buffer.allocated = !file.mapped;
+
+	return 0;
+}
+
 static int
 load_ext(struct rtb_asset *asset)
 {
@@ -48,6 +74,9 @@ load_ext(struct rtb_asset *asset)
 	int size;
 	void *data;
 
+	if (asset->external.map)
+		return map_ext(asset);
+
 	if (!(f = fopen(asset->external.path, "rb"))) {
 		perror("rtb_asset: load_ext(): ");
 		goto err_fopen;
@@ -80,18 +109,178 @@ load_emb(struct rtb_asset *asset)
  * xz
  */
 
+#ifdef RTB_ASSET_XZ
+
+/* decompresses in one go if `size_hint` is right, and grows the buffer
+ * as it goes if it isn't (or is 0). */
 static int
-load_emb_xz(struct rtb_asset *asset)
+inflate_xz(const void *in, size_t in_size, size_t size_hint,
+		void **out, size_t *out_size)
 {
+	lzma_stream strm = LZMA_STREAM_INIT;
+	lzma_ret ret;
+	size_t size;
+	uint8_t *buf, *grown;
+
+	if (lzma_stream_decoder(&strm, UINT64_MAX, 0) != LZMA_OK)
+		goto err_decoder;
+
+	size = size_hint ? size_hint : in_size * 4;
+	if (!(buf = malloc(size)))
+		goto err_malloc;
+
+	strm.next_in   = in;
+	strm.avail_in  = in_size;
+	strm.next_out  = buf;
+	strm.avail_out = size;
+
+	while ((ret = lzma_code(&strm, LZMA_FINISH)) == LZMA_OK) {
+		if (strm.avail_out)
+			continue;
+
+		if (!(grown = realloc(buf, size * 2)))
+			goto err_code;
+
+		buf = grown;
+		strm.next_out  = buf + size;
+		strm.avail_out = size;
+		size *= 2;
+	}
+
+	if (ret != LZMA_STREAM_END)
+		goto err_code;
+
+	*out = buf;
+	*out_size = strm.total_out;
+
+	lzma_end(&strm);
+	return 0;
+
+err_code:
+	free(buf);
+err_malloc:
+	lzma_end(&strm);
+err_decoder:
 	return -1;
 }
 
+#else
+
 static int
-load_ext_xz(struct rtb_asset *asset)
+inflate_xz(const void *in, size_t in_size, size_t size_hint,
+		void **out, size_t *out_size)
 {
+	fprintf(stderr, "rtb_asset: built without xz support "
+			"(configure with --compress-assets)\n");
 	return -1;
 }
 
+#endif
+
+/**
+ * deferred
+ */
+
+static uv_once_t cache_once = UV_ONCE_INIT;
+static uv_mutex_t cache_lock;
+
+static void
+init_cache_lock(void)
+{
+	uv_mutex_init(&cache_lock);
+}
+
+/* decompresses a deferred asset into its cache, once. a failure is
+ * remembered, so it isn't retried (and reported) on every use. */
+static const void *
+fill_cache(const struct rtb_asset *asset, size_t *size)
+{
+	struct rtb_asset_cache *cache = asset->compressor.xz.cache;
+	void *data;
+
+	uv_once(&cache_once, init_cache_lock);
+	uv_mutex_lock(&cache_lock);
+
+	if (!cache->state) {
+		if (inflate_xz(asset->compressor.xz.data,
+					asset->compressor.xz.deflated_size,
+					asset->compressor.xz.inflated_size,
+					&data, &cache->size)) {
+			fprintf(stderr, "rtb_asset: couldn't decompress "
+					"an embedded asset\n");
+			cache->state = -1;
+		} else {
+			cache->data = data;
+			cache->state = 1;
+		}
+	}
+
+	uv_mutex_unlock(&cache_lock);
+
+	if (cache->state < 0)
+		return NULL;
+
+	*size = cache->size;
+	return cache->data;
+}
+
+static int
+load_emb_xz(struct rtb_asset *asset)
+{
+	const void *cached;
+	void *data;
+	size_t size;
+
+	if (asset->compressor.xz.cache) {
+		if (!(cached = fill_cache(asset, &size)))
+			return -1;
+
+		asset->buffer.size = size;
+		asset->buffer.data = cached;
+		return 0;
+	}
+
+	if (inflate_xz(asset->compressor.xz.data,
+				asset->compressor.xz.deflated_size,
+				asset->compressor.xz.inflated_size, &data, &size))
+		return -1;
+
+	asset->buffer.size = size;
+	asset->buffer.data = data;
+	asset->buffer.allocated = 1;
+	return 0;
+}
+
+static int
+load_ext_xz(struct rtb_asset *asset)
+{
+	struct rtb_mapped_file file;
+	void *data;
+	size_t size;
+	int ret;
+
+	if (rtb_mapped_file_open(&file, asset->external.path)) {
+		fprintf(stderr, "rtb_asset: couldn't open \"%s\"\n",
+				asset->external.path);
+		return -1;
+	}
+
+	ret = inflate_xz(file.data, file.size,
+			asset->compressor.xz.inflated_size, &data, &size);
+	rtb_mapped_file_close(&file);
+
+	if (ret) {
+		fprintf(stderr, "rtb_asset: couldn't decompress \"%s\"\n",
+				asset->external.path);
+		return -1;
+	}
+
+	asset->buffer.size = size;
+	asset->buffer.data = data;
+	asset->buffer.allocated = 1;
+	return 0;
+}
+
 static loader_func loaders[] = {
 	[RTB_ASSET_EXTERNAL | RTB_ASSET_UNCOMPRESSED] = load_ext,
 	[RTB_ASSET_EMBEDDED | RTB_ASSET_UNCOMPRESSED] = load_emb,
@@ -116,6 +305,7 @@ rtb_asset_load(struct rtb_asset *asset)
 	asset->buffer.size      = 0;
 	asset->buffer.data      = NULL;
 	asset->buffer.allocated = 0;
+	asset->buffer.mapped    = 0;
 	asset->loaded = 0;
 
 	if (loaders[loader](asset))
@@ -125,16 +315,39 @@ rtb_asset_load(struct rtb_asset *asset)
 	return 0;
 }
 
+const void *
+rtb_asset_data(const struct rtb_asset *asset, size_t *size)
+{
+	if (RTB_ASSET_IS_LOADED(asset)) {
+		*size = asset->buffer.size;
+		return asset->buffer.data;
+	}
+
+	if (!RTB_ASSET_IS_DEFERRED(asset) || !asset->compressor.xz.cache)
+		return NULL;
+
+	return fill_cache(asset, size);
+}
+
 void
 rtb_asset_free(struct rtb_asset *asset)
 {
+	struct rtb_mapped_file file;
+
 	assert(asset->loaded && asset->buffer.data);
 
-	if (asset->buffer.allocated)
+	if (asset->buffer.mapped) {
+		file.data   = asset->buffer.data;
+		file.size   = asset->buffer.size;
+		file.mapped = 1;
+
+		rtb_mapped_file_close(&file);
+	} else if (asset->buffer.allocated)
 		free((void *) asset->buffer.data);
 
 	asset->buffer.size      = 0;
 	asset->buffer.data      = NULL;
 	asset->buffer.allocated = 0;
+	asset->buffer.mapped    = 0;
 	asset->loaded = 0;
 }
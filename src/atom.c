@@ -32,6 +32,7 @@
 #include <rutabaga/window.h>
 #include <rutabaga/dict.h>
 #include <rutabaga/atom.h>
+#include <rutabaga/style.h>
 
 typedef unsigned int uint_t;
 
@@ -211,6 +212,8 @@ rtb_type_ref(struct rtb_window *win, struct rtb_type_atom_descriptor *super,
 
 		type->dict = dict;
 		NEDTRIE_INSERT(rtb_atom_dict, dict, RTB_ATOM_DESCRIPTOR(type));
+
+		rtb_style_type_registered(win, type);
 	}
 
 	type->ref_count++;
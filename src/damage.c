@@ -0,0 +1,184 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <string.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/damage.h>
+
+#include "rtb_private/util.h"
+
+/**
+ * rect helpers
+ */
+
+static int
+contains(const struct rtb_rect *outer, const struct rtb_rect *inner)
+{
+	return inner->x  >= outer->x  && inner->y  >= outer->y
+		&& inner->x2 <= outer->x2 && inner->y2 <= outer->y2;
+}
+
+static void
+rect_union(struct rtb_rect *dst, const struct rtb_rect *src)
+{
+	dst->x  = MIN(dst->x,  src->x);
+	dst->y  = MIN(dst->y,  src->y);
+	dst->x2 = MAX(dst->x2, src->x2);
+	dst->y2 = MAX(dst->y2, src->y2);
+
+	rtb_rect_update_size_from_points(dst);
+}
+
+static void
+collapse(struct rtb_damage *self)
+{
+	unsigned int i;
+
+	for (i = 1; i < self->nrects; i++)
+		rect_union(&self->rects[0], &self->rects[i]);
+
+	self->nrects = 1;
+}
+
+/**
+ * public API
+ */
+
+void
+rtb_damage_clear(struct rtb_damage *self)
+{
+	self->full = 0;
+	self->nrects = 0;
+}
+
+void
+rtb_damage_add_all(struct rtb_damage *self)
+{
+	self->full = 1;
+	self->nrects = 0;
+}
+
+void
+rtb_damage_add_rect(struct rtb_damage *self, const struct rtb_rect *rect)
+{
+	unsigned int i;
+
+	if (self->full || rect->x2 <= rect->x || rect->y2 <= rect->y)
+		return;
+
+	for (i = 0; i < self->nrects; i++) {
+		if (contains(&self->rects[i], rect))
+			return;
+
+		if (contains(rect, &self->rects[i])) {
+			self->rects[i] = *rect;
+			return;
+		}
+	}
+
+	if (self->nrects == RTB_DAMAGE_MAX_RECTS)
+		collapse(self);
+
+	self->rects[self->nrects++] = *rect;
+}
+
+void
+rtb_damage_merge(struct rtb_damage *dst, const struct rtb_damage *src)
+{
+	unsigned int i;
+
+	if (src->full) {
+		rtb_damage_add_all(dst);
+		return;
+	}
+
+	for (i = 0; i < src->nrects; i++)
+		rtb_damage_add_rect(dst, &src->rects[i]);
+}
+
+int
+rtb_damage_is_empty(const struct rtb_damage *self)
+{
+	return !self->full && !self->nrects;
+}
+
+int
+rtb_damage_get_bounds(const struct rtb_damage *self, struct rtb_rect *bounds)
+{
+	unsigned int i;
+
+	if (self->full || !self->nrects)
+		return -1;
+
+	*bounds = self->rects[0];
+	for (i = 1; i < self->nrects; i++)
+		rect_union(bounds, &self->rects[i]);
+
+	return 0;
+}
+
+/**
+ * history
+ */
+
+void
+rtb_damage_history_push(struct rtb_damage_history *self,
+		const struct rtb_damage *frame)
+{
+	self->head = (self->head + 1) % RTB_DAMAGE_HISTORY;
+	self->frames[self->head] = *frame;
+
+	if (self->nframes < RTB_DAMAGE_HISTORY)
+		self->nframes++;
+}
+
+void
+rtb_damage_history_repair(const struct rtb_damage_history *self,
+		unsigned int buffer_age, struct rtb_damage *region)
+{
+	unsigned int i, idx;
+
+	/* a back buffer of age 1 holds the last frame we presented, so it
+	 * only needs this frame's damage. every frame older than that adds
+	 * the damage of the frame presented after it. */
+	if (!buffer_age || buffer_age - 1 > self->nframes) {
+		rtb_damage_add_all(region);
+		return;
+	}
+
+	for (i = 0; i < buffer_age - 1; i++) {
+		idx = (self->head + RTB_DAMAGE_HISTORY - i) % RTB_DAMAGE_HISTORY;
+		rtb_damage_merge(region, &self->frames[idx]);
+	}
+}
+
+void
+rtb_damage_history_init(struct rtb_damage_history *self)
+{
+	memset(self, 0, sizeof(*self));
+}
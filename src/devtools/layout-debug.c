@@ -25,17 +25,17 @@
  */
 
 #include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
 #include <rutabaga/render.h>
 #include <rutabaga/quad.h>
 
 #include "rtb_private/layout-debug.h"
 #include "rtb_private/util.h"
 
-static struct rtb_quad quad;
-
 void
 rtb_debug_draw_bounding_box(struct rtb_element *self)
 {
+	struct rtb_quad *quad = &self->window->layout_debug_quad;
 	struct rtb_render_context *ctx;
 	struct rtb_rect rect = {
 		.x  = self->rect.x,
@@ -44,20 +44,14 @@ rtb_debug_draw_bounding_box(struct rtb_element *self)
 		.y2 = self->rect.y2 - 1
 	};
 
-	rtb_quad_set_vertices(&quad, &rect);
-
 	rtb_render_reset(self);
 	ctx = rtb_render_get_context(self);
 
+	rtb_quad_set_vertices(quad, ctx->state, &rect);
+
 	rtb_render_set_position(ctx, 0.f, 0.f);
 
 	rtb_render_set_color(ctx, 1.f, 0.f, 0.f, .4f);
 	glLineWidth(1.f);
-	rtb_render_quad_outline(ctx, &quad);
-}
-
-void
-rtb_debug_init(void)
-{
-	rtb_quad_init(&quad);
+	rtb_render_quad_outline(ctx, quad);
 }
@@ -46,6 +46,7 @@
 
 #include "rtb_private/stdlib-allocator.h"
 #include "rtb_private/layout-debug.h"
+#include "rtb_private/watchdog.h"
 
 #include "wwrl/vector.h"
 
@@ -67,7 +68,7 @@ change_state(struct rtb_element *self, rtb_elem_state_t state)
 		return 0;
 
 	self->state = state;
-	self->restyle(self);
+	WATCHDOG_CALL(self, RTB_WATCHDOG_RESTYLE, self->restyle(self));
 
 	return 0;
 }
@@ -174,7 +175,7 @@ reflow_rootward(struct rtb_element *self,
 		instigator->h
 	};
 
-	self->layout_cb(self);
+	WATCHDOG_CALL(self, RTB_WATCHDOG_LAYOUT, self->layout_cb(self));
 
 	/* don't pass the reflow any further rootward if the element's
 	 * size hasn't changed as a result of it. */
@@ -183,10 +184,12 @@ reflow_rootward(struct rtb_element *self,
 		return 0;
 
 	TAILQ_FOREACH(iter, &self->children, child)
-		iter->reflow(iter, self, RTB_DIRECTION_LEAFWARD);
+		WATCHDOG_CALL(iter, RTB_WATCHDOG_REFLOW,
+				iter->reflow(iter, self, RTB_DIRECTION_LEAFWARD));
 
 	if (self->parent)
-		self->parent->reflow(self->parent, self, direction);
+		WATCHDOG_CALL(self->parent, RTB_WATCHDOG_REFLOW,
+				self->parent->reflow(self->parent, self, direction));
 
 	rtb_elem_mark_dirty(self);
 	return 1;
@@ -198,10 +201,11 @@ reflow_leafward(struct rtb_element *self,
 {
 	struct rtb_element *iter;
 
-	self->layout_cb(self);
+	WATCHDOG_CALL(self, RTB_WATCHDOG_LAYOUT, self->layout_cb(self));
 
 	TAILQ_FOREACH(iter, &self->children, child)
-		iter->reflow(iter, self, direction);
+		WATCHDOG_CALL(iter, RTB_WATCHDOG_REFLOW,
+				iter->reflow(iter, self, direction));
 }
 
 static int
@@ -276,9 +280,12 @@ reload_style(struct rtb_element *self)
 		}
 
 #define LOAD_TEXTURE(name, load_func)                                 \
-		LOAD_PROP(name, RTB_STYLE_PROP_TEXTURE, texture, load_func) { \
-			rtb_elem_mark_dirty(self);                                \
-		}
+	if ((prop = rtb_style_query_prop(self,                            \
+					name, RTB_STYLE_PROP_TEXTURE, 0))                 \
+			&& !load_func(&self->stylequad, self->window,             \
+				&prop->texture)) {                                    \
+		rtb_elem_mark_dirty(self);                                    \
+	}
 
 	LOAD_COLOR("background-color", rtb_stylequad_set_background_color);
 	LOAD_COLOR("border-color", rtb_stylequad_set_border_color);
@@ -307,7 +314,7 @@ restyle(struct rtb_element *self)
 	reload_style(self);
 
 	TAILQ_FOREACH(iter, &self->children, child)
-		iter->restyle(iter);
+		WATCHDOG_CALL(iter, RTB_WATCHDOG_RESTYLE, iter->restyle(iter));
 }
 
 /**
@@ -349,7 +356,7 @@ attached(struct rtb_element *self,
 
 	self->type = rtb_type_ref(window, NULL, "net.illest.rutabaga.element");
 
-	self->layout_cb(self);
+	WATCHDOG_CALL(self, RTB_WATCHDOG_LAYOUT, self->layout_cb(self));
 
 	TAILQ_FOREACH(iter, &self->children, child)
 		self->child_attached(self, iter);
@@ -363,6 +370,14 @@ detached(struct rtb_element *self,
 {
 	struct rtb_element *iter;
 
+	/* elements that were waiting to be redrawn can't be left in the
+	 * queue, since they could be freed before the next frame. */
+	if (self->render_entry.tqe_next || self->render_entry.tqe_prev) {
+		TAILQ_REMOVE(&self->surface->render_queue, self, render_entry);
+		self->render_entry.tqe_next = NULL;
+		self->render_entry.tqe_prev = NULL;
+	}
+
 	self->parent = NULL;
 	self->window = NULL;
 
@@ -393,6 +408,10 @@ mark_dirty(struct rtb_element *self)
 {
 	struct rtb_surface *surface = self->surface;
 
+	/* there's nothing to redraw until it's in a window. */
+	if (self->state == RTB_STATE_UNATTACHED)
+		return;
+
 	for (; self != RTB_ELEMENT(surface); self = self->parent) {
 		if (self->visibility == RTB_FULLY_OBSCURED)
 			return;
@@ -407,6 +426,7 @@ mark_dirty(struct rtb_element *self)
 		return;
 
 	TAILQ_INSERT_TAIL(&surface->render_queue, self, render_entry);
+	rtb_damage_add_rect(&surface->damage, &self->rect);
 	rtb_elem_mark_dirty(RTB_ELEMENT(surface));
 }
 
@@ -476,7 +496,7 @@ rtb_elem_draw(struct rtb_element *self, int clear_first)
 	if (clear_first)
 		rtb_render_clear(self);
 
-	self->draw(self);
+	WATCHDOG_CALL(self, RTB_WATCHDOG_DRAW, self->draw(self));
 	LAYOUT_DEBUG_DRAW_BOX(self);
 
 	rtb_render_pop(self);
@@ -525,7 +545,8 @@ void
 rtb_elem_trigger_reflow(struct rtb_element *self, struct rtb_element *instigator,
 		rtb_ev_direction_t direction)
 {
-	self->reflow(self, instigator, direction);
+	WATCHDOG_CALL(self, RTB_WATCHDOG_REFLOW,
+			self->reflow(self, instigator, direction));
 }
 
 void
@@ -622,9 +643,11 @@ rtb_elem_add_child(struct rtb_element *self, struct rtb_element *child,
 		self->child_attached(self, child);
 
 		if (self->window->state != RTB_STATE_UNATTACHED)
-			self->restyle(self);
+			WATCHDOG_CALL(self, RTB_WATCHDOG_RESTYLE,
+					self->restyle(self));
 
-		self->reflow(self, child, RTB_DIRECTION_ROOTWARD);
+		WATCHDOG_CALL(self, RTB_WATCHDOG_REFLOW,
+				self->reflow(self, child, RTB_DIRECTION_ROOTWARD));
 	}
 }
 
@@ -636,9 +659,6 @@ rtb_elem_remove_child(struct rtb_element *self, struct rtb_element *child)
 	if (self->state == RTB_STATE_UNATTACHED)
 		return;
 
-	if (self->render_entry.tqe_next && self->render_entry.tqe_prev)
-		TAILQ_REMOVE(&self->surface->render_queue, self, render_entry);
-
 	if (child->mouse_in) {
 		if (self->window->mouse.buttons_down) {
 			struct rtb_mouse_button *b;
@@ -660,7 +680,8 @@ rtb_elem_remove_child(struct rtb_element *self, struct rtb_element *child)
 	child->style  = NULL;
 	child->state  = RTB_STATE_UNATTACHED;
 
-	self->reflow(self, NULL, RTB_DIRECTION_LEAFWARD);
+	WATCHDOG_CALL(self, RTB_WATCHDOG_REFLOW,
+			self->reflow(self, NULL, RTB_DIRECTION_LEAFWARD));
 }
 
 static struct rtb_element_implementation base_impl = {
@@ -710,8 +731,6 @@ rtb_elem_init(struct rtb_element *self)
 
 	rtb_stylequad_init(&self->stylequad);
 
-	LAYOUT_DEBUG_INIT();
-
 	return 0;
 }
 
@@ -32,8 +32,8 @@
 #include <rutabaga/event.h>
 #include <rutabaga/element.h>
 
-static const struct rtb_event_handler *
-find_handler_for(struct rtb_element *elem, rtb_ev_type_t type)
+const struct rtb_event_handler *
+rtb_find_handler(struct rtb_element *elem, rtb_ev_type_t type)
 {
 	struct rtb_event_handler *handlers;
 	int i, size;
@@ -78,7 +78,7 @@ rtb_handle(struct rtb_element *target, const struct rtb_event *event)
 {
 	const struct rtb_event_handler *h;
 
-	if (!(h = find_handler_for(target, event->type)))
+	if (!(h = rtb_find_handler(target, event->type)))
 		return 0;
 
 	h->callback.cb(target, event, h->callback.ctx);
@@ -0,0 +1,468 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <uv.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
+#include <rutabaga/render.h>
+#include <rutabaga/shader.h>
+#include <rutabaga/frame-timing.h>
+
+#include "rtb_private/util.h"
+
+#define NS_TO_MS(ns) ((float) (ns) / 1000000.f)
+
+/* overlay geometry, in window coordinates. */
+#define OVERLAY_X       8.f
+#define OVERLAY_Y       8.f
+#define OVERLAY_HEIGHT  100.f
+#define OVERLAY_PX_PER_MS 4.f
+#define OVERLAY_BUDGET_MS (1000.f / 60.f)
+
+#define OVERLAY_VERTICES (4 + (4 * RTB_FRAME_TIMING_SAMPLES) + 2)
+
+/**
+ * histograms
+ */
+
+static void
+histogram_push(struct rtb_frame_histogram *h, float ms)
+{
+	h->samples[h->head] = ms;
+	h->head = (h->head + 1) % RTB_FRAME_TIMING_SAMPLES;
+
+	if (h->count < RTB_FRAME_TIMING_SAMPLES)
+		h->count++;
+}
+
+/* `i` counts from the oldest sample still around. */
+static float
+histogram_sample(const struct rtb_frame_histogram *h, unsigned int i)
+{
+	return h->samples[(h->head + RTB_FRAME_TIMING_SAMPLES - h->count + i)
+		% RTB_FRAME_TIMING_SAMPLES];
+}
+
+static int
+compare_floats(const void *_a, const void *_b)
+{
+	float a = *(const float *) _a, b = *(const float *) _b;
+	return (a > b) - (a < b);
+}
+
+static float
+percentile(const float *sorted, unsigned int n, float p)
+{
+	unsigned int i = ceilf(p * n);
+	return sorted[i ? i - 1 : 0];
+}
+
+/**
+ * GPU queries
+ */
+
+/* results are read back 64 bits wide, which needs the extension's entry
+ * points even on GL 3.3, where timer queries are core. */
+static int
+have_timer_query(void)
+{
+	return ogl_ext_ARB_timer_query == ogl_LOAD_SUCCEEDED;
+}
+
+/* returns -1 if the frame's results haven't arrived yet. */
+static int
+gpu_collect(struct rtb_frame_timing *self, unsigned int frame)
+{
+	uint64_t total = 0, surfaces = 0;
+	GLuint available;
+	GLuint64 ns;
+	unsigned int i, nsegments;
+
+	nsegments = MIN(self->gpu[frame].nsegments, RTB_FRAME_TIMING_SEGMENTS);
+
+	/* nothing was recorded, so there's nothing to wait for. */
+	if (!nsegments) {
+		self->gpu[frame].pending = 0;
+		return 0;
+	}
+
+	/* queries complete in order, so the last one is enough. */
+	glGetQueryObjectuiv(self->gpu[frame].queries[nsegments - 1],
+			GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+		return -1;
+
+	for (i = 0; i < nsegments; i++) {
+		glGetQueryObjectui64v(self->gpu[frame].queries[i],
+				GL_QUERY_RESULT, &ns);
+
+		total += ns;
+		if (self->gpu[frame].is_surface[i])
+			surfaces += ns;
+	}
+
+	histogram_push(&self->metrics[RTB_FRAME_GPU_TOTAL], NS_TO_MS(total));
+	histogram_push(&self->metrics[RTB_FRAME_GPU_SURFACES],
+			NS_TO_MS(surfaces));
+
+	self->gpu[frame].pending = 0;
+	return 0;
+}
+
+static void
+gpu_frame_begin(struct rtb_frame_timing *self)
+{
+	unsigned int frame;
+
+	self->gpu_recording = 0;
+	if (!self->have_timer_query)
+		return;
+
+	frame = (self->gpu_frame + 1) % RTB_FRAME_TIMING_LATENCY;
+
+	/* if the GPU is more than RTB_FRAME_TIMING_LATENCY frames behind,
+	 * we'd rather miss a sample than wait for it. */
+	if (self->gpu[frame].pending && gpu_collect(self, frame))
+		return;
+
+	self->gpu_frame = frame;
+	self->gpu[frame].nsegments = 0;
+	self->gpu_recording = 1;
+}
+
+/* ends the running segment (if any) and starts the next one. once
+ * we're out of segments, the last one just keeps running. */
+static void
+gpu_split(struct rtb_frame_timing *self, int is_surface)
+{
+	unsigned int frame = self->gpu_frame, seg;
+
+	seg = self->gpu[frame].nsegments;
+	if (seg >= RTB_FRAME_TIMING_SEGMENTS)
+		return;
+
+	if (seg)
+		glEndQuery(GL_TIME_ELAPSED);
+
+	self->gpu[frame].is_surface[seg] = is_surface;
+	glBeginQuery(GL_TIME_ELAPSED, self->gpu[frame].queries[seg]);
+	self->gpu[frame].nsegments++;
+}
+
+static void
+gpu_frame_end(struct rtb_frame_timing *self)
+{
+	if (!self->gpu_recording)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	self->gpu[self->gpu_frame].pending = 1;
+	self->gpu_recording = 0;
+}
+
+/**
+ * stages
+ */
+
+void
+rtb_frame_timing_begin(struct rtb_frame_timing *self, rtb_frame_stage_t stage)
+{
+	switch (stage) {
+	case RTB_FRAME_STAGE_FRAME:
+		/* enabling timing from within a frame only takes effect with
+		 * the next one. */
+		self->recording = self->enabled;
+		self->surface_depth = 0;
+		memset(self->elapsed, 0, sizeof(self->elapsed));
+		break;
+
+	case RTB_FRAME_STAGE_DRAW:
+		if (self->recording) {
+			gpu_frame_begin(self);
+			if (self->gpu_recording)
+				gpu_split(self, 0);
+		}
+		break;
+
+	case RTB_FRAME_STAGE_SURFACE:
+		if (self->surface_depth++)
+			return;
+
+		if (self->gpu_recording)
+			gpu_split(self, 1);
+		break;
+
+	default:
+		break;
+	}
+
+	if (self->recording)
+		self->stage_start[stage] = uv_hrtime();
+}
+
+void
+rtb_frame_timing_end(struct rtb_frame_timing *self, rtb_frame_stage_t stage)
+{
+	uint64_t elapsed;
+	int i;
+
+	if (stage == RTB_FRAME_STAGE_SURFACE && --self->surface_depth)
+		return;
+
+	if (!self->recording)
+		return;
+
+	elapsed = uv_hrtime() - self->stage_start[stage];
+
+	switch (stage) {
+	case RTB_FRAME_STAGE_FRAME:
+		self->elapsed[RTB_FRAME_CPU_TOTAL] = elapsed;
+
+		for (i = RTB_FRAME_CPU_TOTAL; i <= RTB_FRAME_CPU_SURFACES; i++)
+			histogram_push(&self->metrics[i], NS_TO_MS(self->elapsed[i]));
+
+		self->recording = 0;
+		break;
+
+	case RTB_FRAME_STAGE_UPDATE:
+		self->elapsed[RTB_FRAME_CPU_UPDATE] += elapsed;
+		break;
+
+	case RTB_FRAME_STAGE_DRAW:
+		self->elapsed[RTB_FRAME_CPU_DRAW] += elapsed;
+		gpu_frame_end(self);
+		break;
+
+	case RTB_FRAME_STAGE_SURFACE:
+		self->elapsed[RTB_FRAME_CPU_SURFACES] += elapsed;
+		if (self->gpu_recording)
+			gpu_split(self, 0);
+		break;
+	}
+}
+
+void
+rtb_frame_timing_cancel(struct rtb_frame_timing *self)
+{
+	/* GPU queries only run within RTB_FRAME_STAGE_DRAW, so there's
+	 * nothing to clean up there. */
+	self->recording = 0;
+}
+
+/**
+ * overlay
+ */
+
+void
+rtb_frame_timing_overlay_rect(const struct rtb_frame_timing *self,
+		struct rtb_rect *rect)
+{
+	rect->x  = OVERLAY_X;
+	rect->y  = OVERLAY_Y;
+	rect->x2 = OVERLAY_X + RTB_FRAME_TIMING_SAMPLES;
+	rect->y2 = OVERLAY_Y + OVERLAY_HEIGHT;
+
+	rtb_rect_update_size_from_points(rect);
+}
+
+/* one vertical line per sample, oldest on the left. returns the number
+ * of vertices written. */
+static int
+overlay_bars(const struct rtb_frame_histogram *h, GLfloat (*v)[2])
+{
+	const GLfloat bottom = OVERLAY_Y + OVERLAY_HEIGHT;
+	unsigned int i;
+	GLfloat x, height;
+
+	for (i = 0; i < h->count; i++) {
+		x = OVERLAY_X + (RTB_FRAME_TIMING_SAMPLES - h->count + i) + .5f;
+		height = MIN(histogram_sample(h, i) * OVERLAY_PX_PER_MS,
+				OVERLAY_HEIGHT);
+
+		v[i * 2][0] = v[i * 2 + 1][0] = x;
+		v[i * 2][1] = bottom;
+		v[i * 2 + 1][1] = bottom - height;
+	}
+
+	return h->count * 2;
+}
+
+void
+rtb_frame_timing_draw_overlay(struct rtb_frame_timing *self,
+		struct rtb_window *win)
+{
+	struct rtb_render_context *ctx = &RTB_SURFACE(win)->render_ctx;
+	GLfloat v[OVERLAY_VERTICES][2];
+	GLfloat budget;
+	int ncpu, ngpu;
+
+	struct rtb_rect rect;
+
+	if (!self->overlay)
+		return;
+
+	rtb_frame_timing_overlay_rect(self, &rect);
+	budget = rect.y2 - OVERLAY_BUDGET_MS * OVERLAY_PX_PER_MS;
+
+	/* background */
+	v[0][0] = rect.x;  v[0][1] = rect.y;
+	v[1][0] = rect.x2; v[1][1] = rect.y;
+	v[2][0] = rect.x;  v[2][1] = rect.y2;
+	v[3][0] = rect.x2; v[3][1] = rect.y2;
+
+	ncpu = overlay_bars(&self->metrics[RTB_FRAME_CPU_TOTAL], &v[4]);
+	ngpu = overlay_bars(&self->metrics[RTB_FRAME_GPU_TOTAL], &v[4 + ncpu]);
+
+	v[4 + ncpu + ngpu][0]     = rect.x;  v[4 + ncpu + ngpu][1]     = budget;
+	v[4 + ncpu + ngpu + 1][0] = rect.x2; v[4 + ncpu + ngpu + 1][1] = budget;
+
+	rtb_render_reset(RTB_ELEMENT(win));
+	rtb_render_set_position(ctx, 0.f, 0.f);
+
+	rtb_render_state_bind_vertex_array(ctx->state, self->overlay_gl.vao);
+	rtb_render_state_bind_buffer(ctx->state,
+			GL_ARRAY_BUFFER, self->overlay_gl.vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STREAM_DRAW);
+
+	rtb_render_set_color(ctx, 0.f, 0.f, 0.f, .6f);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	rtb_render_set_color(ctx, .3f, .6f, 1.f, .8f);
+	glDrawArrays(GL_LINES, 4, ncpu);
+
+	rtb_render_set_color(ctx, 1.f, .6f, .2f, .8f);
+	glDrawArrays(GL_LINES, 4 + ncpu, ngpu);
+
+	rtb_render_set_color(ctx, 1.f, 0.f, 0.f, .8f);
+	glDrawArrays(GL_LINES, 4 + ncpu + ngpu, 2);
+}
+
+/**
+ * public API
+ */
+
+void
+rtb_frame_timing_enable(struct rtb_frame_timing *self, int enable)
+{
+	int i;
+
+	if (self->enabled == !!enable)
+		return;
+
+	/* a fresh start, rather than a gap in the samples. */
+	if (enable) {
+		for (i = 0; i < RTB_FRAME_METRIC_COUNT; i++)
+			self->metrics[i].head = self->metrics[i].count = 0;
+
+		for (i = 0; i < RTB_FRAME_TIMING_LATENCY; i++)
+			self->gpu[i].pending = 0;
+	}
+
+	self->enabled = !!enable;
+}
+
+void
+rtb_frame_timing_show_overlay(struct rtb_frame_timing *self, int show)
+{
+	self->overlay = !!show;
+}
+
+int
+rtb_frame_timing_get(const struct rtb_frame_timing *self,
+		rtb_frame_metric_t metric, struct rtb_frame_percentiles *out)
+{
+	const struct rtb_frame_histogram *h = &self->metrics[metric];
+	float sorted[RTB_FRAME_TIMING_SAMPLES];
+
+	if (!h->count)
+		return -1;
+
+	/* until the ring wraps, the samples are all at the front. */
+	memcpy(sorted, h->samples, h->count * sizeof(*sorted));
+	qsort(sorted, h->count, sizeof(*sorted), compare_floats);
+
+	out->p50 = percentile(sorted, h->count, .50f);
+	out->p95 = percentile(sorted, h->count, .95f);
+	out->p99 = percentile(sorted, h->count, .99f);
+	out->max = sorted[h->count - 1];
+	out->samples = h->count;
+
+	return 0;
+}
+
+/**
+ * lifecycle
+ */
+
+int
+rtb_frame_timing_init(struct rtb_frame_timing *self)
+{
+	int i;
+
+	memset(self, 0, sizeof(*self));
+
+	self->have_timer_query = have_timer_query();
+	if (self->have_timer_query)
+		for (i = 0; i < RTB_FRAME_TIMING_LATENCY; i++)
+			glGenQueries(RTB_FRAME_TIMING_SEGMENTS, self->gpu[i].queries);
+
+	glGenVertexArrays(1, &self->overlay_gl.vao);
+	glGenBuffers(1, &self->overlay_gl.vbo);
+
+	glBindVertexArray(self->overlay_gl.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, self->overlay_gl.vbo);
+
+	glEnableVertexAttribArray(RTB_ATTRIB_VERTEX);
+	glVertexAttribPointer(RTB_ATTRIB_VERTEX, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+#ifdef _RTB_DEBUG_FRAME
+	rtb_frame_timing_enable(self, 1);
+	rtb_frame_timing_show_overlay(self, 1);
+#endif
+
+	return 0;
+}
+
+void
+rtb_frame_timing_fini(struct rtb_frame_timing *self)
+{
+	int i;
+
+	if (self->have_timer_query)
+		for (i = 0; i < RTB_FRAME_TIMING_LATENCY; i++)
+			glDeleteQueries(RTB_FRAME_TIMING_SEGMENTS, self->gpu[i].queries);
+
+	glDeleteBuffers(1, &self->overlay_gl.vbo);
+	glDeleteVertexArrays(1, &self->overlay_gl.vao);
+}
@@ -0,0 +1,194 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <rtb_private/mapped-file.h>
+
+/**
+ * platform mappings
+ */
+
+#ifdef _WIN32
+
+static int
+map_file(struct rtb_mapped_file *self, const char *path)
+{
+	HANDLE file, mapping;
+	LARGE_INTEGER size;
+	void *data = NULL;
+
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return -1;
+
+	if (!GetFileSizeEx(file, &size) || !size.QuadPart
+			|| (ULONGLONG) size.QuadPart > (size_t) -1)
+		goto err_size;
+
+	if (!(mapping = CreateFileMappingA(file, NULL, PAGE_READONLY,
+					0, 0, NULL)))
+		goto err_size;
+
+	data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	/* the view keeps the mapping open. */
+	CloseHandle(mapping);
+err_size:
+	CloseHandle(file);
+
+	if (!data)
+		return -1;
+
+	self->data = data;
+	self->size = size.QuadPart;
+	return 0;
+}
+
+static void
+unmap_file(struct rtb_mapped_file *self)
+{
+	UnmapViewOfFile(self->data);
+}
+
+#else
+
+static int
+map_file(struct rtb_mapped_file *self, const char *path)
+{
+	struct stat st;
+	void *data;
+	int fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return -1;
+
+	if (fstat(fd, &st) || st.st_size <= 0)
+		goto err;
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+		goto err;
+
+	/* the mapping outlives the descriptor. */
+	close(fd);
+
+	self->data = data;
+	self->size = st.st_size;
+	return 0;
+
+err:
+	close(fd);
+	return -1;
+}
+
+static void
+unmap_file(struct rtb_mapped_file *self)
+{
+	munmap((void *) self->data, self->size);
+}
+
+#endif
+
+/**
+ * fallback
+ */
+
+static int
+read_file(struct rtb_mapped_file *self, const char *path)
+{
+	void *data;
+	FILE *f;
+	long size;
+
+	if (!(f = fopen(path, "rb")))
+		return -1;
+
+	if (fseek(f, 0, SEEK_END) || (size = ftell(f)) <= 0
+			|| fseek(f, 0, SEEK_SET))
+		goto err_size;
+
+	if (!(data = malloc(size)))
+		goto err_size;
+
+	if (fread(data, 1, size, f) != (size_t) size)
+		goto err_read;
+
+	fclose(f);
+
+	self->data = data;
+	self->size = size;
+	return 0;
+
+err_read:
+	free(data);
+err_size:
+	fclose(f);
+	return -1;
+}
+
+/**
+ * public API
+ */
+
+int
+rtb_mapped_file_open(struct rtb_mapped_file *self, const char *path)
+{
+	self->data = NULL;
+	self->size = 0;
+	self->mapped = 1;
+
+	if (!map_file(self, path))
+		return 0;
+
+	/* some filesystems can't be mapped. */
+	self->mapped = 0;
+	return read_file(self, path);
+}
+
+void
+rtb_mapped_file_close(struct rtb_mapped_file *self)
+{
+	if (self->mapped)
+		unmap_file(self);
+	else
+		free((void *) self->data);
+
+	self->data = NULL;
+	self->size = 0;
+}
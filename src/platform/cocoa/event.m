@@ -53,6 +53,14 @@ frame_timer_callback(CFRunLoopTimerRef timer, void *info)
 	rtb__cocoa_draw_frame(cwin, 0);
 }
 
+/* the CFRunLoopTimer above checks for dirtiness every frame, so there's
+ * nothing to schedule. */
+void
+window_impl_schedule_frame(struct rtb_window *win)
+{
+	return;
+}
+
 /**
  * uv shim
  */
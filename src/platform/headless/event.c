@@ -0,0 +1,154 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
+#include <rutabaga/surface.h>
+#include <rutabaga/event.h>
+#include <rutabaga/keyboard.h>
+#include <rutabaga/headless.h>
+
+#include "rtb_private/window_impl.h"
+
+#include "hrtb.h"
+
+/**
+ * frames
+ */
+
+int
+rtb_headless_draw_frame(struct rtb_window *win, int force)
+{
+	struct headless_window *self = RTB_WINDOW_AS(win, headless_window);
+	int drawn;
+
+	rtb_window_lock(win);
+
+	if (win->need_reconfigure) {
+		rtb_window_reinit(win);
+		win->need_reconfigure = 0;
+	}
+
+	if (force)
+		rtb_surface_invalidate(RTB_SURFACE(win));
+
+	/* the pbuffer keeps whatever was drawn into it last, so after the
+	 * first frame, only the damage has to be redrawn. */
+	win->buffer_age = self->has_drawn;
+
+	drawn = rtb_window_draw(win, 0);
+	if (drawn) {
+		eglSwapBuffers(self->hrtb->dpy, self->gl_surface);
+		self->has_drawn = 1;
+	}
+
+	rtb_window_unlock(win);
+	return drawn;
+}
+
+static void
+frame_request_cb(uv_async_t *_handle)
+{
+	struct hrtb_frame_request *request;
+
+	request = RTB_DOWNCAST(_handle, hrtb_frame_request, uv_async_s);
+	rtb_headless_draw_frame(((struct rutabaga *) request->hrtb)->win, 0);
+}
+
+void
+window_impl_schedule_frame(struct rtb_window *win)
+{
+	struct headless_rutabaga *hrtb = (void *) win->rtb;
+
+	/* the event loop hasn't been set up yet. rtb_event_loop_init()
+	 * schedules the first frame. */
+	if (!hrtb || !hrtb->frame_request.hrtb)
+		return;
+
+	uv_async_send(RTB_UPCAST(&hrtb->frame_request, uv_async_s));
+}
+
+/**
+ * input
+ */
+
+void
+rtb_headless_set_modkeys(struct rtb_window *win, rtb_modkey_t mod_keys)
+{
+	((struct headless_rutabaga *) win->rtb)->mod_keys = mod_keys;
+}
+
+rtb_modkey_t
+rtb_get_modkeys(struct rtb_window *win)
+{
+	return ((struct headless_rutabaga *) win->rtb)->mod_keys;
+}
+
+/**
+ * event loop
+ */
+
+void
+rtb_headless_run_pending(struct rutabaga *r)
+{
+	uv_run(&r->event_loop, UV_RUN_NOWAIT);
+}
+
+void
+rtb_event_loop_init(struct rutabaga *r)
+{
+	struct headless_rutabaga *hrtb = (void *) r;
+
+	hrtb->frame_request.hrtb = hrtb;
+	uv_async_init(&r->event_loop,
+			RTB_UPCAST(&hrtb->frame_request, uv_async_s), frame_request_cb);
+
+	window_impl_schedule_frame(r->win);
+}
+
+void
+rtb_event_loop_run(struct rutabaga *r)
+{
+	uv_run(&r->event_loop, UV_RUN_DEFAULT);
+}
+
+void
+rtb_event_loop_stop(struct rutabaga *r)
+{
+	uv_stop(&r->event_loop);
+}
+
+void
+rtb_event_loop_fini(struct rutabaga *r)
+{
+	struct headless_rutabaga *hrtb = (void *) r;
+
+	hrtb->frame_request.hrtb = NULL;
+	uv_close((void *) RTB_UPCAST(&hrtb->frame_request, uv_async_s), NULL);
+
+	uv_run(&r->event_loop, UV_RUN_NOWAIT);
+}
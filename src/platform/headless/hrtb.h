@@ -0,0 +1,84 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdio.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
+#include <rutabaga/keyboard.h>
+
+#include <uv.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+#define ERR(...) fprintf(stderr, "rutabaga headless: " __VA_ARGS__)
+
+/* there's no display to pace us, so a requested frame is drawn as soon
+ * as the loop gets around to it. */
+struct hrtb_frame_request {
+	RTB_INHERIT(uv_async_s);
+	struct headless_rutabaga *hrtb;
+};
+
+struct headless_rutabaga {
+	struct rutabaga rtb;
+
+	EGLDisplay dpy;
+
+	struct hrtb_frame_request frame_request;
+
+	/* whatever was last set with rtb_headless_set_modkeys(). */
+	rtb_modkey_t mod_keys;
+
+	struct {
+		rtb_utf8_t *buffer;
+		size_t nbytes;
+	} clipboard;
+};
+
+struct headless_window {
+	RTB_INHERIT(rtb_window);
+
+	struct headless_rutabaga *hrtb;
+
+	EGLContext gl_ctx;
+
+	/* a pbuffer rather than a surfaceless context, so that the window
+	 * still has a default framebuffer to blit into. */
+	EGLSurface gl_surface;
+
+	/* set once the pbuffer holds a frame. pbuffers aren't swapped, so
+	 * every frame after the first draws on top of the last one. */
+	int has_drawn;
+};
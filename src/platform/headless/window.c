@@ -0,0 +1,301 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/window.h>
+#include <rutabaga/headless.h>
+
+#include "rtb_private/window_impl.h"
+
+#include "hrtb.h"
+
+#define DEFAULT_DPI 96
+
+/**
+ * display
+ */
+
+static EGLDisplay
+get_display(void)
+{
+	PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display;
+	const char *extensions;
+	EGLDisplay dpy;
+
+	/* on mesa, the surfaceless platform doesn't need a GPU, a DRM node,
+	 * or a display server. llvmpipe is fine. */
+	extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	get_platform_display = (void *)
+		eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+	if (extensions && get_platform_display
+			&& strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+		dpy = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+				EGL_DEFAULT_DISPLAY, NULL);
+
+		if (dpy != EGL_NO_DISPLAY)
+			return dpy;
+	}
+
+	return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+struct rutabaga *
+window_impl_rtb_alloc(void)
+{
+	struct headless_rutabaga *self;
+	EGLint major, minor;
+
+	if (!(self = calloc(1, sizeof(*self))))
+		goto err_malloc;
+
+	self->dpy = get_display();
+	if (self->dpy == EGL_NO_DISPLAY) {
+		ERR("can't get an EGL display\n");
+		goto err_dpy;
+	}
+
+	if (!eglInitialize(self->dpy, &major, &minor)) {
+		ERR("can't initialize EGL\n");
+		goto err_initialize;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		ERR("EGL implementation doesn't support desktop openGL\n");
+		goto err_bind_api;
+	}
+
+	return (struct rutabaga *) self;
+
+err_bind_api:
+	eglTerminate(self->dpy);
+err_initialize:
+err_dpy:
+	free(self);
+err_malloc:
+	return NULL;
+}
+
+void
+window_impl_rtb_free(struct rutabaga *rtb)
+{
+	struct headless_rutabaga *self = (void *) rtb;
+
+	eglTerminate(self->dpy);
+
+	free(self->clipboard.buffer);
+	free(self);
+}
+
+/**
+ * windows
+ */
+
+static EGLConfig
+find_config(EGLDisplay dpy)
+{
+	const EGLint attribs[] = {
+		EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE,        8,
+		EGL_GREEN_SIZE,      8,
+		EGL_BLUE_SIZE,       8,
+		EGL_ALPHA_SIZE,      8,
+		EGL_NONE
+	};
+
+	EGLConfig config;
+	EGLint nconfigs;
+
+	if (!eglChooseConfig(dpy, attribs, &config, 1, &nconfigs)
+			|| nconfigs < 1)
+		return NULL;
+
+	return config;
+}
+
+static EGLContext
+new_gl_context(EGLDisplay dpy, EGLConfig config)
+{
+	const EGLint attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, 3,
+		EGL_CONTEXT_MINOR_VERSION_KHR, 2,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,
+			EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_NONE
+	};
+
+	return eglCreateContext(dpy, config, EGL_NO_CONTEXT, attribs);
+}
+
+struct rtb_window *
+window_impl_open(struct rutabaga *rtb,
+		int w, int h, const char *title, intptr_t parent)
+{
+	struct headless_rutabaga *hrtb = (void *) rtb;
+	struct headless_window *self;
+	EGLConfig config;
+
+	const EGLint pbuffer_attribs[] = {
+		EGL_WIDTH,  w,
+		EGL_HEIGHT, h,
+		EGL_NONE
+	};
+
+	assert(rtb);
+	assert(h > 0);
+	assert(w > 0);
+
+	if (!(self = calloc(1, sizeof(*self))))
+		goto err_malloc;
+
+	self->hrtb = hrtb;
+
+	config = find_config(hrtb->dpy);
+	if (!config) {
+		ERR("no reasonable EGL configurations, bailing out\n");
+		goto err_config;
+	}
+
+	self->gl_ctx = new_gl_context(hrtb->dpy, config);
+	if (self->gl_ctx == EGL_NO_CONTEXT) {
+		ERR("couldn't create an openGL 3.2 core context\n");
+		goto err_gl_ctx;
+	}
+
+	self->gl_surface = eglCreatePbufferSurface(hrtb->dpy, config,
+			pbuffer_attribs);
+	if (self->gl_surface == EGL_NO_SURFACE) {
+		ERR("couldn't create a %dx%d pbuffer\n", w, h);
+		goto err_gl_surface;
+	}
+
+	if (!eglMakeCurrent(hrtb->dpy,
+				self->gl_surface, self->gl_surface, self->gl_ctx)) {
+		ERR("couldn't activate EGL context\n");
+		goto err_make_current;
+	}
+
+	self->dpi.x = self->dpi.y = DEFAULT_DPI;
+
+	/* nothing can cover us up, and there's no map notify to wait for
+	 * before laying out. */
+	self->visibility = RTB_UNOBSCURED;
+	self->need_reconfigure = 1;
+
+	uv_mutex_init(&self->lock);
+	return RTB_WINDOW(self);
+
+err_make_current:
+	eglDestroySurface(hrtb->dpy, self->gl_surface);
+err_gl_surface:
+	eglDestroyContext(hrtb->dpy, self->gl_ctx);
+err_gl_ctx:
+err_config:
+	free(self);
+err_malloc:
+	return NULL;
+}
+
+void
+window_impl_close(struct rtb_window *rwin)
+{
+	struct headless_window *self = RTB_WINDOW_AS(rwin, headless_window);
+	EGLDisplay dpy = self->hrtb->dpy;
+
+	eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroySurface(dpy, self->gl_surface);
+	eglDestroyContext(dpy, self->gl_ctx);
+
+	uv_mutex_unlock(&self->lock);
+	uv_mutex_destroy(&self->lock);
+
+	free(self);
+}
+
+void
+rtb_window_lock(struct rtb_window *rwin)
+{
+	struct headless_window *self = RTB_WINDOW_AS(rwin, headless_window);
+
+	uv_mutex_lock(&self->lock);
+	eglMakeCurrent(self->hrtb->dpy,
+			self->gl_surface, self->gl_surface, self->gl_ctx);
+}
+
+void
+rtb_window_unlock(struct rtb_window *rwin)
+{
+	struct headless_window *self = RTB_WINDOW_AS(rwin, headless_window);
+
+	eglMakeCurrent(self->hrtb->dpy,
+			EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	uv_mutex_unlock(&self->lock);
+}
+
+/**
+ * readback
+ */
+
+int
+rtb_headless_read_pixels(struct rtb_window *rwin, void *pixels)
+{
+	struct headless_window *self = RTB_WINDOW_AS(rwin, headless_window);
+	int y, w = rwin->w, h = rwin->h;
+	size_t stride = w * 4;
+	uint8_t *rows = pixels, *row;
+
+	if (!self->has_drawn)
+		return -1;
+
+	rtb_window_lock(rwin);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	rtb_render_state_invalidate(&rwin->render_state,
+			RTB_RENDER_STATE_FRAMEBUFFER);
+	rtb_window_unlock(rwin);
+
+	/* GL hands the rows over bottom first. */
+	if (!(row = malloc(stride)))
+		return -1;
+
+	for (y = 0; y < h / 2; y++) {
+		memcpy(row, rows + y * stride, stride);
+		memcpy(rows + y * stride, rows + (h - y - 1) * stride, stride);
+		memcpy(rows + (h - y - 1) * stride, row, stride);
+	}
+
+	free(row);
+	return 0;
+}
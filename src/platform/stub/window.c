@@ -50,3 +50,9 @@ window_impl_close(struct rtb_window *self)
 {
 	return;
 }
+
+void
+window_impl_schedule_frame(struct rtb_window *self)
+{
+	return;
+}
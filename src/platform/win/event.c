@@ -61,6 +61,14 @@ draw_frame(struct win_rtb_window *self, int force)
 	UNLOCK(self);
 }
 
+/* we're still polling on WIN_RTB_FRAME_TIMER, since we can't count on
+ * owning the message loop (see rtb_event_loop_run()). */
+void
+window_impl_schedule_frame(struct rtb_window *win)
+{
+	return;
+}
+
 /**
  * window events
  */
@@ -48,15 +48,11 @@
 #include <rutabaga/platform.h>
 #include <rutabaga/keyboard.h>
 
+#include "rtb_private/window_impl.h"
 #include "rtb_private/util.h"
 
 #include "xrtb.h"
 
-#ifndef GL_ARB_timer_query
-#define GL_TIME_ELAPSED 0x88BF
-#define GL_TIMESTAMP 0x8E28
-#endif
-
 #define CAST_EVENT_TO(type) type *ev = (type *) _ev
 #define SET_IF_TRUE(w, m, f) (w = (w & ~m) | (-f & m))
 
@@ -242,8 +238,13 @@ handle_visibility_notify(struct xrtb_window *win, xcb_generic_event_t *_ev)
 
 	case XCB_VISIBILITY_FULLY_OBSCURED:
 		win->visibility = RTB_FULLY_OBSCURED;
-		break;
+		return;
 	}
+
+	/* frames aren't drawn while we're fully obscured, so anything that
+	 * got dirty in the meantime is still waiting, and frame handlers
+	 * stopped asking for frames. */
+	rtb_window_request_frame(RTB_WINDOW(win));
 }
 
 static void
@@ -490,7 +491,7 @@ handle_generic_event(struct xrtb_window *win, xcb_generic_event_t *ev)
 		break;
 
 	case XCB_EXPOSE:
-		win->dirty = 1;
+		rtb_elem_mark_dirty(RTB_ELEMENT(win));
 		break;
 
 	case XCB_VISIBILITY_NOTIFY:
@@ -589,9 +590,19 @@ frame_cb(uv_timer_t *_handle)
 	xwin = timer->xwin;
 	win = RTB_WINDOW(xwin);
 
+	timer->last_frame = uv_hrtime();
+
 	rtb_window_lock(win);
 	drain_xcb_event_queue(xwin->xrtb->xcb_conn, win);
 
+	if (xwin->has_buffer_age) {
+		unsigned int age;
+
+		glXQueryDrawable(xwin->xrtb->dpy, xwin->gl_draw,
+				GLX_BACK_BUFFER_AGE_EXT, &age);
+		win->buffer_age = age;
+	}
+
 	if (rtb_window_draw(win, 0))
 		glXSwapBuffers(xwin->xrtb->dpy, xwin->gl_draw);
 
@@ -599,15 +610,77 @@ frame_cb(uv_timer_t *_handle)
 	rtb_window_unlock(win);
 }
 
-static int
-frame_timer_init(struct xrtb_frame_timer *timer)
+static void
+frame_timer_arm(struct xrtb_frame_timer *timer)
 {
-	/* FIXME: get FPS from xrandr? or xcomposite? whatever. */
+	uv_timer_t *handle = RTB_UPCAST(timer, uv_timer_s);
+	uint64_t now, next;
+
+	if (uv_is_active((uv_handle_t *) handle))
+		return;
+
+	/* keep frames a refresh interval apart, so that a steady stream of
+	 * requests lines up with the swap interval instead of beating
+	 * against it. */
+	now  = uv_hrtime();
+	next = timer->last_frame + timer->refresh_interval;
+
+	uv_timer_start(handle, frame_cb,
+			next > now ? (next - now) / 1000000 : 0, 0);
+}
+
+static uint64_t
+refresh_interval(struct xrtb_window *xwin)
+{
+	PFNGLXGETMSCRATEOMLPROC get_msc_rate;
+	int32_t numerator, denominator;
+
+	get_msc_rate = (void *)
+		glXGetProcAddress((GLubyte *) "glXGetMscRateOML");
 
-	timer->wait_msec = 15;
+	if (get_msc_rate
+			&& get_msc_rate(xwin->xrtb->dpy, xwin->gl_draw,
+				&numerator, &denominator)
+			&& numerator > 0 && denominator > 0)
+		return (1000000000ull * denominator) / numerator;
+
+	/* no GLX_OML_sync_control. assume 60Hz. */
+	return 1000000000ull / 60;
+}
+
+static int
+frame_timer_init(struct xrtb_frame_timer *timer, struct xrtb_window *xwin)
+{
+	timer->xwin = xwin;
+	timer->refresh_interval = refresh_interval(xwin);
+	timer->last_frame = 0;
 	return 0;
 }
 
+static void
+frame_request_cb(uv_async_t *_handle)
+{
+	struct xrtb_frame_request *request;
+
+	request = RTB_DOWNCAST(_handle, xrtb_frame_request, uv_async_s);
+	frame_timer_arm(&request->xrtb->frame_timer);
+}
+
+void
+window_impl_schedule_frame(struct rtb_window *win)
+{
+	struct xcb_rutabaga *xrtb = (void *) win->rtb;
+
+	/* the event loop hasn't been set up yet. rtb_event_loop_init()
+	 * schedules the first frame. */
+	if (!xrtb || !xrtb->frame_request.xrtb)
+		return;
+
+	/* libuv coalesces these, so marking lots of things dirty in one
+	 * go only wakes the loop once. */
+	uv_async_send(RTB_UPCAST(&xrtb->frame_request, uv_async_s));
+}
+
 void
 rtb_event_loop_init(struct rutabaga *r)
 {
@@ -618,14 +691,16 @@ rtb_event_loop_init(struct rutabaga *r)
 	uv_poll_init(&r->event_loop, RTB_UPCAST(&xrtb->xcb_poll, uv_poll_s),
 			xcb_get_file_descriptor(xrtb->xcb_conn));
 
-	xrtb->frame_timer.xwin = xwin;
-	frame_timer_init(&xrtb->frame_timer);
 	uv_timer_init(&r->event_loop, RTB_UPCAST(&xrtb->frame_timer, uv_timer_s));
+	frame_timer_init(&xrtb->frame_timer, xwin);
+
+	xrtb->frame_request.xrtb = xrtb;
+	uv_async_init(&r->event_loop,
+			RTB_UPCAST(&xrtb->frame_request, uv_async_s), frame_request_cb);
 
 	uv_poll_start(RTB_UPCAST(&xrtb->xcb_poll, uv_poll_s), UV_READABLE,
 			xcb_poll_cb);
-	uv_timer_start(RTB_UPCAST(&xrtb->frame_timer, uv_timer_s),
-			frame_cb, 0, xrtb->frame_timer.wait_msec);
+	frame_timer_arm(&xrtb->frame_timer);
 }
 
 void
@@ -645,6 +720,8 @@ rtb_event_loop_fini(struct rutabaga *r)
 {
 	struct xcb_rutabaga *xrtb = (void *) r;
 
+	xrtb->frame_request.xrtb = NULL;
+	uv_close((void *) RTB_UPCAST(&xrtb->frame_request, uv_async_s), NULL);
 	uv_close((void *) RTB_UPCAST(&xrtb->frame_timer, uv_timer_s), NULL);
 	uv_close((void *) RTB_UPCAST(&xrtb->xcb_poll, uv_poll_s), NULL);
 
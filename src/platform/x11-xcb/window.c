@@ -492,6 +492,13 @@ set_swap_interval(Display *dpy, GLXDrawable drawable)
 	swap_interval(dpy, drawable, 1);
 }
 
+static int
+has_buffer_age(Display *dpy, int screen)
+{
+	const char *extensions = glXQueryExtensionsString(dpy, screen);
+	return extensions && !!strstr(extensions, "GLX_EXT_buffer_age");
+}
+
 static void
 raise_window(xcb_connection_t *xcb_conn, xcb_window_t window)
 {
@@ -642,6 +649,7 @@ window_impl_open(struct rutabaga *rtb,
 	}
 
 	set_swap_interval(dpy, self->gl_draw);
+	self->has_buffer_age = has_buffer_age(dpy, default_screen);
 
 	ck_map = xcb_map_window_checked(xcb_conn, self->xcb_win);
 	if ((err = xcb_request_check(xcb_conn, ck_map))) {
@@ -36,12 +36,29 @@
 
 #include <GL/glx.h>
 
+#ifndef GLX_BACK_BUFFER_AGE_EXT
+#define GLX_BACK_BUFFER_AGE_EXT 0x20F4
+#endif
+
 #define ERR(...) fprintf(stderr, "rutabaga XCB: " __VA_ARGS__)
 
+/* one-shot: only armed while a frame is pending, so an idle window
+ * doesn't wake up at all. */
 struct xrtb_frame_timer {
 	RTB_INHERIT(uv_timer_s);
 	struct xrtb_window *xwin;
-	unsigned int wait_msec;
+
+	/* in uv_hrtime() nanoseconds */
+	uint64_t refresh_interval;
+	uint64_t last_frame;
+};
+
+/* rtb_window_request_frame() and friends can be called from any thread
+ * that holds the window lock, but the frame timer can only be armed from
+ * the loop thread. */
+struct xrtb_frame_request {
+	RTB_INHERIT(uv_async_s);
+	struct xcb_rutabaga *xrtb;
 };
 
 struct xrtb_uv_poll {
@@ -86,6 +103,7 @@ struct xcb_rutabaga {
 
 	struct xrtb_uv_poll xcb_poll;
 	struct xrtb_frame_timer frame_timer;
+	struct xrtb_frame_request frame_request;
 
 	struct {
 		xcb_connection_t *conn;
@@ -109,6 +127,9 @@ struct xrtb_window {
 	GLXContext gl_ctx;
 	GLXWindow gl_win;
 
+	/* GLX_EXT_buffer_age, for partial redraws. */
+	int has_buffer_age;
+
 	uint16_t numlock_mask;
 	uint16_t capslock_mask;
 	uint16_t shiftlock_mask;
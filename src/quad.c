@@ -25,10 +25,26 @@
  */
 
 #include <rutabaga/rutabaga.h>
+#include <rutabaga/shader.h>
 #include <rutabaga/quad.h>
 
-void
-rtb_quad_set_vertices(struct rtb_quad *self, struct rtb_rect *from)
+/* everything goes through the window's state tracker, since quads are
+ * filled in during layout, which can happen in the middle of a frame. */
+
+static void
+attach_buffer(struct rtb_quad *self, struct rtb_render_state *state,
+		GLuint attrib, GLuint buffer)
+{
+	rtb_render_state_bind_vertex_array(state, self->vao);
+	rtb_render_state_bind_buffer(state, GL_ARRAY_BUFFER, buffer);
+
+	glEnableVertexAttribArray(attrib);
+	glVertexAttribPointer(attrib, 2, GL_FLOAT, GL_FALSE, 0, 0);
+}
+
+static void
+fill_buffer(struct rtb_render_state *state, GLuint buffer,
+		const struct rtb_rect *from)
 {
 	GLfloat v[4][2] = {
 		{from->x,  from->y},
@@ -37,34 +53,45 @@ rtb_quad_set_vertices(struct rtb_quad *self, struct rtb_rect *from)
 		{from->x,  from->y2}
 	};
 
-	glBindBuffer(GL_ARRAY_BUFFER, self->vertices);
+	rtb_render_state_bind_buffer(state, GL_ARRAY_BUFFER, buffer);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void
-rtb_quad_set_tex_coords(struct rtb_quad *self, struct rtb_rect *from)
+rtb_quad_set_vertices(struct rtb_quad *self, struct rtb_render_state *state,
+		struct rtb_rect *from)
 {
-	GLfloat v[4][2] = {
-		{from->x,  from->y},
-		{from->x2, from->y},
-		{from->x2, from->y2},
-		{from->x,  from->y2}
-	};
+	if (!self->vertices) {
+		glGenVertexArrays(1, &self->vao);
+		glGenBuffers(1, &self->vertices);
+		attach_buffer(self, state, RTB_ATTRIB_VERTEX, self->vertices);
+	}
+
+	fill_buffer(state, self->vertices, from);
+}
+
+void
+rtb_quad_set_tex_coords(struct rtb_quad *self, struct rtb_render_state *state,
+		struct rtb_rect *from)
+{
+	/* the vertex array comes with the vertices. */
+	if (!self->vertices)
+		return;
 
-	if (!self->tex_coords)
+	if (!self->tex_coords) {
 		glGenBuffers(1, &self->tex_coords);
+		attach_buffer(self, state, RTB_ATTRIB_TEX_COORD, self->tex_coords);
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, self->tex_coords);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	fill_buffer(state, self->tex_coords, from);
 }
 
 void
 rtb_quad_init(struct rtb_quad *self)
 {
-	glGenBuffers(1, &self->vertices);
+	self->vertices = 0;
 	self->tex_coords = 0;
+	self->vao = 0;
 }
 
 void
@@ -74,4 +101,9 @@ rtb_quad_fini(struct rtb_quad *self)
 
 	FREE_BUFFER_IF_USED(tex_coords);
 	FREE_BUFFER_IF_USED(vertices);
+
+#undef FREE_BUFFER_IF_USED
+
+	if (self->vao)
+		glDeleteVertexArrays(1, &self->vao);
 }
@@ -0,0 +1,373 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <limits.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/render.h>
+#include <rutabaga/render-batch.h>
+#include <rutabaga/window.h>
+
+#include "rtb_private/util.h"
+#include "rtb_private/stdlib-allocator.h"
+
+#include "wwrl/vector.h"
+
+/* VECTOR_PUSH_BACK_DATA() only grows the vector by the amount being
+ * pushed, which would mean a realloc() for nearly every quad. jumps to
+ * `err_label` if it can't, leaving the vector as it was. */
+#define RESERVE(vec, count, err_label) do {									\
+	size_t _need = (vec)->size + (count);									\
+	size_t _capacity = (vec)->capacity;										\
+	void *_data;															\
+	if (_need >= _capacity) {												\
+		while (_need >= _capacity)											\
+			_capacity *= 2;													\
+		_data = (vec)->allocator->realloc((vec)->data,						\
+				_capacity * sizeof(*(vec)->data));							\
+		if (!_data)															\
+			goto err_label;													\
+		(vec)->data = _data;												\
+		(vec)->capacity = _capacity;										\
+	}																		\
+} while (0)
+
+/**
+ * collecting geometry
+ */
+
+/* returns NULL, and leaves the runs as they were, if a new run is needed
+ * and there's no room for it. */
+static struct rtb_batch_run *
+run_for(struct rtb_render_batch *self, GLenum mode, GLuint texture)
+{
+	struct rtb_batch_run *run, new_run;
+
+	if (self->runs.size) {
+		run = VECTOR_BACK(&self->runs);
+
+		/* untextured geometry doesn't sample, so it can ride along
+		 * with whatever texture the run already has bound. */
+		if (run->mode == mode
+				&& (!texture || !run->texture || run->texture == texture)) {
+			if (!run->texture)
+				run->texture = texture;
+
+			return run;
+		}
+	}
+
+	new_run.mode    = mode;
+	new_run.texture = texture;
+	new_run.first   = self->indices.size;
+	new_run.count   = 0;
+
+	RESERVE(&self->runs, 1, err_reserve);
+	VECTOR_PUSH_BACK(&self->runs, &new_run);
+	return VECTOR_BACK(&self->runs);
+
+err_reserve:
+	return NULL;
+}
+
+int
+rtb_render_batch_add(struct rtb_render_batch *self, GLenum mode,
+		GLuint texture, const struct rtb_batch_vertex *vertices,
+		const GLubyte *indices, GLsizei count)
+{
+	GLuint remap[UCHAR_MAX + 1];
+	struct rtb_batch_run *run;
+	GLsizei i, nindices;
+	GLenum list_mode;
+	GLubyte max_index;
+	GLuint *dst;
+
+	switch (mode) {
+	case GL_TRIANGLE_STRIP:
+		list_mode = GL_TRIANGLES;
+		nindices  = (count - 2) * 3;
+		break;
+
+	case GL_LINE_LOOP:
+		list_mode = GL_LINES;
+		nindices  = count * 2;
+		break;
+
+	default:
+		list_mode = mode;
+		nindices  = count;
+		break;
+	}
+
+	if (nindices <= 0)
+		return 0;
+
+	/* make room for everything up front, so that running out of memory
+	 * leaves the batch as it was. */
+	RESERVE(&self->vertices, count, err_reserve);
+	RESERVE(&self->indices, nindices, err_reserve);
+
+	if (!(run = run_for(self, list_mode, texture)))
+		goto err_reserve;
+
+	/* copy over only the vertices that are actually referenced. */
+	for (max_index = 0, i = 0; i < count; i++)
+		if (indices[i] > max_index)
+			max_index = indices[i];
+
+	for (i = 0; i <= max_index; i++)
+		remap[i] = UINT_MAX;
+
+	for (i = 0; i < count; i++) {
+		if (remap[indices[i]] != UINT_MAX)
+			continue;
+
+		remap[indices[i]] = self->vertices.size;
+		self->vertices.data[self->vertices.size++] = vertices[indices[i]];
+	}
+
+	dst = self->indices.data + self->indices.size;
+
+#define IDX(n) remap[indices[(n)]]
+	switch (mode) {
+	case GL_TRIANGLE_STRIP:
+		for (i = 2; i < count; i++) {
+			/* alternate to keep the winding consistent with the strip */
+			*dst++ = IDX(i - 2 + (i & 1));
+			*dst++ = IDX(i - 1 - (i & 1));
+			*dst++ = IDX(i);
+		}
+
+		break;
+
+	case GL_LINE_LOOP:
+		for (i = 0; i < count; i++) {
+			*dst++ = IDX(i);
+			*dst++ = IDX((i + 1) % count);
+		}
+
+		break;
+
+	default:
+		for (i = 0; i < count; i++)
+			*dst++ = IDX(i);
+
+		break;
+	}
+#undef IDX
+
+	self->indices.size += nindices;
+	run->count += nindices;
+
+	self->stats.submitted++;
+	return 0;
+
+err_reserve:
+	return -1;
+}
+
+struct rtb_batch_vertex *
+rtb_render_batch_add_quads(struct rtb_render_batch *self, GLuint texture,
+		GLsizei nquads)
+{
+	struct rtb_batch_run *run;
+	GLuint *dst, base;
+	GLsizei i;
+
+	RESERVE(&self->vertices, nquads * 4, err_reserve);
+	RESERVE(&self->indices, nquads * 6, err_reserve);
+
+	if (!(run = run_for(self, GL_TRIANGLES, texture)))
+		goto err_reserve;
+
+	base = self->vertices.size;
+	dst  = self->indices.data + self->indices.size;
+
+	for (i = 0; i < nquads; i++, base += 4) {
+		*dst++ = base;
+		*dst++ = base + 1;
+		*dst++ = base + 2;
+		*dst++ = base;
+		*dst++ = base + 2;
+		*dst++ = base + 3;
+	}
+
+	self->indices.size += nquads * 6;
+	run->count += nquads * 6;
+
+	base = self->vertices.size;
+	self->vertices.size += nquads * 4;
+
+	self->stats.submitted++;
+	return self->vertices.data + base;
+
+err_reserve:
+	return NULL;
+}
+
+/**
+ * submitting
+ */
+
+static void
+enable_attrib(GLint location, GLint size, GLenum type, GLboolean normalized,
+		size_t offset)
+{
+	if (location < 0)
+		return;
+
+	glEnableVertexAttribArray(location);
+	glVertexAttribPointer(location, size, type, normalized,
+			sizeof(struct rtb_batch_vertex), (void *) offset);
+}
+
+/* the batch is only ever drawn with the window's batch shader, so its
+ * vertex array can be set up once against that shader's locations. */
+static void
+init_vertex_array(struct rtb_render_batch *self,
+		struct rtb_render_state *state, const struct rtb_batch_shader *shader)
+{
+	glGenBuffers(1, &self->vbo);
+	glGenBuffers(1, &self->ibo);
+	glGenVertexArrays(1, &self->vao);
+
+	rtb_render_state_bind_vertex_array(state, self->vao);
+	rtb_render_state_bind_buffer(state, GL_ARRAY_BUFFER, self->vbo);
+
+#define ATTRIB(loc, size, type, norm, member) \
+	enable_attrib(loc, size, type, norm, \
+			offsetof(struct rtb_batch_vertex, member))
+	ATTRIB(shader->vertex,       2, GL_FLOAT,         GL_FALSE, x);
+	ATTRIB(shader->tex_coord,    2, GL_FLOAT,         GL_FALSE, s);
+	ATTRIB(shader->clip_rect,    4, GL_FLOAT,         GL_FALSE, clip);
+	ATTRIB(shader->vertex_color, 4, GL_UNSIGNED_BYTE, GL_TRUE,  color);
+	ATTRIB(shader->textured,     1, GL_FLOAT,         GL_FALSE, textured);
+	ATTRIB(shader->text_params,  2, GL_FLOAT,         GL_FALSE, text);
+#undef ATTRIB
+}
+
+void
+rtb_render_batch_flush(struct rtb_render_batch *self,
+		struct rtb_render_context *ctx)
+{
+	const struct rtb_batch_shader *shader;
+	struct rtb_render_state *state;
+	const struct rtb_batch_run *run;
+	size_t i;
+
+	if (!self->runs.size)
+		return;
+
+	shader = &ctx->window->local_storage.shader.batch;
+	state = ctx->state;
+
+	rtb_render_state_use_program(state, shader->program);
+	ctx->shader = RTB_SHADER(shader);
+
+	rtb_render_state_bind_uniform_buffer(state, ctx->uniform_buffer);
+	glUniform1i(shader->texture, 0);
+
+	if (!self->vao)
+		init_vertex_array(self, state, shader);
+	else
+		rtb_render_state_bind_vertex_array(state, self->vao);
+
+	rtb_render_state_bind_buffer(state, GL_ARRAY_BUFFER, self->vbo);
+	glBufferData(GL_ARRAY_BUFFER,
+			self->vertices.size * sizeof(*self->vertices.data),
+			self->vertices.data, GL_STREAM_DRAW);
+
+	rtb_render_state_bind_buffer(state, GL_ELEMENT_ARRAY_BUFFER, self->ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+			self->indices.size * sizeof(*self->indices.data),
+			self->indices.data, GL_STREAM_DRAW);
+
+	rtb_render_state_blend_func(state, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glLineWidth(1.f);
+
+	/* every vertex carries its own clip rectangle, so the scissor
+	 * test would only get in the way here. */
+	rtb_render_state_scissor_test(state, 0);
+
+	for (i = 0; i < self->runs.size; i++) {
+		run = &self->runs.data[i];
+
+		if (run->texture)
+			rtb_render_state_bind_texture(state, run->texture);
+
+		glDrawElements(run->mode, run->count, GL_UNSIGNED_INT,
+				(void *) (run->first * sizeof(GLuint)));
+	}
+
+	rtb_render_state_scissor_test(state, 1);
+
+	self->stats.draw_calls += self->runs.size;
+	self->stats.flushes++;
+
+	VECTOR_CLEAR(&self->vertices);
+	VECTOR_CLEAR(&self->indices);
+	VECTOR_CLEAR(&self->runs);
+}
+
+/**
+ * lifecycle
+ */
+
+int
+rtb_render_batch_init(struct rtb_render_batch *self)
+{
+	memset(self, 0, sizeof(*self));
+
+	VECTOR_INIT(&self->vertices, &stdlib_allocator, 256);
+	VECTOR_INIT(&self->indices, &stdlib_allocator, 512);
+	VECTOR_INIT(&self->runs, &stdlib_allocator, 16);
+
+	if (!self->vertices.data || !self->indices.data || !self->runs.data) {
+		rtb_render_batch_fini(self);
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+rtb_render_batch_fini(struct rtb_render_batch *self)
+{
+	if (self->vao) {
+		glDeleteBuffers(1, &self->vbo);
+		glDeleteBuffers(1, &self->ibo);
+		glDeleteVertexArrays(1, &self->vao);
+	}
+
+	if (self->vertices.data)
+		VECTOR_FREE(&self->vertices);
+	if (self->indices.data)
+		VECTOR_FREE(&self->indices);
+	if (self->runs.data)
+		VECTOR_FREE(&self->runs);
+}
@@ -0,0 +1,193 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/render-state.h>
+#include <rutabaga/shader.h>
+
+/* evaluates to 1 (and counts the elision) if `bit` is known and `same`
+ * holds. otherwise marks `bit` as known and counts an issued call. */
+#define ELIDE(self, bit, same)												\
+	(((self)->known & (bit)) && (same)										\
+	 ? ((self)->stats.elided++, 1)											\
+	 : ((self)->known |= (bit), (self)->stats.issued++, 0))
+
+void
+rtb_render_state_invalidate(struct rtb_render_state *self, unsigned int bits)
+{
+	self->known &= ~bits;
+}
+
+void
+rtb_render_state_use_program(struct rtb_render_state *self, GLuint program)
+{
+	if (ELIDE(self, RTB_RENDER_STATE_PROGRAM, self->program == program))
+		return;
+
+	self->program = program;
+	glUseProgram(program);
+}
+
+void
+rtb_render_state_bind_buffer(struct rtb_render_state *self,
+		GLenum target, GLuint buffer)
+{
+	switch (target) {
+	case GL_ARRAY_BUFFER:
+		if (ELIDE(self, RTB_RENDER_STATE_ARRAY_BUFFER,
+					self->array_buffer == buffer))
+			return;
+
+		self->array_buffer = buffer;
+		break;
+
+	case GL_ELEMENT_ARRAY_BUFFER:
+		if (ELIDE(self, RTB_RENDER_STATE_ELEMENT_ARRAY_BUFFER,
+					self->element_array_buffer == buffer))
+			return;
+
+		self->element_array_buffer = buffer;
+		break;
+
+	default:
+		break;
+	}
+
+	glBindBuffer(target, buffer);
+}
+
+void
+rtb_render_state_bind_texture(struct rtb_render_state *self, GLuint texture)
+{
+	if (ELIDE(self, RTB_RENDER_STATE_TEXTURE, self->texture == texture))
+		return;
+
+	self->texture = texture;
+	glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void
+rtb_render_state_bind_framebuffer(struct rtb_render_state *self,
+		GLuint framebuffer)
+{
+	if (ELIDE(self, RTB_RENDER_STATE_FRAMEBUFFER,
+				self->framebuffer == framebuffer))
+		return;
+
+	self->framebuffer = framebuffer;
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void
+rtb_render_state_bind_uniform_buffer(struct rtb_render_state *self,
+		GLuint buffer)
+{
+	if (ELIDE(self, RTB_RENDER_STATE_UNIFORM_BUFFER,
+				self->uniform_buffer == buffer))
+		return;
+
+	self->uniform_buffer = buffer;
+	glBindBufferBase(GL_UNIFORM_BUFFER, RTB_UNIFORM_BLOCK_MATRICES, buffer);
+}
+
+void
+rtb_render_state_bind_vertex_array(struct rtb_render_state *self,
+		GLuint vertex_array)
+{
+	if (ELIDE(self, RTB_RENDER_STATE_VERTEX_ARRAY,
+				self->vertex_array == vertex_array))
+		return;
+
+	self->vertex_array = vertex_array;
+	self->known &= ~RTB_RENDER_STATE_ELEMENT_ARRAY_BUFFER;
+	glBindVertexArray(vertex_array);
+}
+
+void
+rtb_render_state_blend_func(struct rtb_render_state *self,
+		GLenum src, GLenum dst)
+{
+	if (ELIDE(self, RTB_RENDER_STATE_BLEND,
+				self->blend.src == src && self->blend.dst == dst))
+		return;
+
+	self->blend.src = src;
+	self->blend.dst = dst;
+	glBlendFunc(src, dst);
+}
+
+void
+rtb_render_state_scissor(struct rtb_render_state *self,
+		GLint x, GLint y, GLsizei w, GLsizei h)
+{
+	GLint scissor[4] = {x, y, w, h};
+
+	if (ELIDE(self, RTB_RENDER_STATE_SCISSOR,
+				!memcmp(self->scissor, scissor, sizeof(scissor))))
+		return;
+
+	memcpy(self->scissor, scissor, sizeof(scissor));
+	glScissor(x, y, w, h);
+}
+
+void
+rtb_render_state_scissor_test(struct rtb_render_state *self, int enabled)
+{
+	enabled = !!enabled;
+
+	if (ELIDE(self, RTB_RENDER_STATE_SCISSOR_TEST,
+				self->scissor_test == enabled))
+		return;
+
+	self->scissor_test = enabled;
+
+	if (enabled)
+		glEnable(GL_SCISSOR_TEST);
+	else
+		glDisable(GL_SCISSOR_TEST);
+}
+
+void
+rtb_render_state_viewport(struct rtb_render_state *self,
+		GLint x, GLint y, GLsizei w, GLsizei h)
+{
+	GLint viewport[4] = {x, y, w, h};
+
+	if (ELIDE(self, RTB_RENDER_STATE_VIEWPORT,
+				!memcmp(self->viewport, viewport, sizeof(viewport))))
+		return;
+
+	memcpy(self->viewport, viewport, sizeof(viewport));
+	glViewport(x, y, w, h);
+}
+
+void
+rtb_render_state_init(struct rtb_render_state *self)
+{
+	memset(self, 0, sizeof(*self));
+}
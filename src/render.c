@@ -24,9 +24,13 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stddef.h>
+#include <string.h>
+
 #include <rutabaga/rutabaga.h>
 #include <rutabaga/window.h>
 #include <rutabaga/render.h>
+#include <rutabaga/surface.h>
 #include <rutabaga/style.h>
 #include <rutabaga/quad.h>
 
@@ -95,63 +99,127 @@ rtb_render_set_position(struct rtb_render_context *ctx, float x, float y)
 void
 rtb_render_set_modelview(struct rtb_render_context *ctx, const GLfloat *matrix)
 {
-	glUniformMatrix4fv(ctx->shader->matrices.modelview,
-		1, GL_FALSE, matrix);
+	ctx->modelview_is_identity = 0;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, ctx->uniform_buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER,
+			offsetof(struct rtb_render_uniforms, modelview),
+			sizeof(mat4), matrix);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void
+rtb_render_set_projection(struct rtb_render_context *ctx,
+		const mat4 *projection)
+{
+	ctx->projection = *projection;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, ctx->uniform_buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER,
+			offsetof(struct rtb_render_uniforms, projection),
+			sizeof(mat4), projection->data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 /**
- * quad drawing
+ * deferred state
  */
 
 static void
-render_quad(struct rtb_render_context *ctx, struct rtb_quad *quad,
-		GLenum mode, GLuint ibo)
+intersect_box(GLint box[4], const GLint with[4])
 {
-	const struct rtb_shader *shader = ctx->shader;
+	GLint x2 = MIN(box[0] + box[2], with[0] + with[2]);
+	GLint y2 = MIN(box[1] + box[3], with[1] + with[3]);
 
-	if (!quad->vertices)
+	box[0] = MAX(box[0], with[0]);
+	box[1] = MAX(box[1], with[1]);
+	box[2] = MAX(x2 - box[0], 0);
+	box[3] = MAX(y2 - box[1], 0);
+}
+
+void
+rtb_render_get_scissor(struct rtb_element *elem, GLint scissor[4])
+{
+	const struct rtb_render_context *ctx = &elem->surface->render_ctx;
+
+	scissor[0] = elem->x - elem->surface->x;
+	scissor[1] = elem->surface->y + elem->surface->h - elem->h - elem->y;
+	scissor[2] = elem->w;
+	scissor[3] = elem->h;
+
+	if (ctx->clip.active)
+		intersect_box(scissor, ctx->clip.box);
+}
+
+void
+rtb_render_set_clip(struct rtb_render_context *ctx, const GLint box[4])
+{
+	rtb_render_flush(ctx);
+
+	ctx->clip.active = !!box;
+	if (box)
+		memcpy(ctx->clip.box, box, sizeof(ctx->clip.box));
+}
+
+static void
+apply_pending(struct rtb_render_context *ctx)
+{
+	GLint scissor[4];
+
+	if (!ctx->pending_element)
 		return;
 
-	glBindBuffer(GL_ARRAY_BUFFER, quad->vertices);
-	glEnableVertexAttribArray(shader->vertex);
-	glVertexAttribPointer(shader->vertex, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	rtb_render_get_scissor(ctx->pending_element, scissor);
+	rtb_render_state_scissor(ctx->state,
+			scissor[0], scissor[1], scissor[2], scissor[3]);
 
-	if (quad->tex_coords) {
-		glBindBuffer(GL_ARRAY_BUFFER, quad->tex_coords);
-		glEnableVertexAttribArray(shader->tex_coord);
-		glVertexAttribPointer(shader->tex_coord,
-				2, GL_FLOAT, GL_FALSE, 0, 0);
-	}
+	rtb_render_state_blend_func(ctx->state,
+			GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	ctx->pending_element = NULL;
+}
+
+void
+rtb_render_flush(struct rtb_render_context *ctx)
+{
+	rtb_render_batch_flush(&ctx->batch, ctx);
+}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	glDrawElements(mode, 4, GL_UNSIGNED_BYTE, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+/**
+ * quad drawing
+ */
 
-	glDisableVertexAttribArray(shader->vertex);
+static void
+render_quad(struct rtb_render_context *ctx, struct rtb_quad *quad,
+		GLenum mode)
+{
+	if (!quad->vertices)
+		return;
 
-	if (quad->tex_coords)
-		glDisableVertexAttribArray(shader->tex_coord);
+	rtb_render_state_bind_vertex_array(ctx->state, quad->vao);
+	glDrawArrays(mode, 0, 4);
 }
 
 void
 rtb_render_quad_outline(struct rtb_render_context *ctx, struct rtb_quad *quad)
 {
-	render_quad(ctx, quad, GL_LINE_LOOP,
-			ctx->window->local_storage.ibo.quad.outline);
+	render_quad(ctx, quad, GL_LINE_LOOP);
 }
 
 void
 rtb_render_quad(struct rtb_render_context *ctx, struct rtb_quad *quad)
 {
-	render_quad(ctx, quad, GL_TRIANGLE_STRIP,
-			ctx->window->local_storage.ibo.quad.solid);
+	render_quad(ctx, quad, GL_TRIANGLE_FAN);
 }
 
 void
 rtb_render_clear(struct rtb_element *elem)
 {
+	struct rtb_render_context *ctx = rtb_render_get_context(elem);
+
+	rtb_render_flush(ctx);
+	apply_pending(ctx);
+
 	glClearColor(0.f, 0.f, 0.f, 0.f);
 	glClear(GL_COLOR_BUFFER_BIT);
 }
@@ -171,41 +239,56 @@ void
 rtb_render_use_shader(struct rtb_render_context *ctx,
 		const struct rtb_shader *shader)
 {
-	GLuint program;
-	program = shader->program;
-	ctx->shader = shader;
+	/* anything batched so far has to hit the framebuffer before we
+	 * draw over it. */
+	rtb_render_flush(ctx);
+	apply_pending(ctx);
 
-	glUseProgram(program);
+	ctx->shader = shader;
+	rtb_render_state_use_program(ctx->state, shader->program);
+	rtb_render_state_bind_uniform_buffer(ctx->state, ctx->uniform_buffer);
 
-	glUniformMatrix4fv(shader->matrices.projection,
-		1, GL_FALSE, ctx->projection.data);
-	glUniformMatrix4fv(shader->matrices.modelview,
-		1, GL_FALSE, identity_matrix);
+	if (!ctx->modelview_is_identity) {
+		rtb_render_set_modelview(ctx, identity_matrix);
+		ctx->modelview_is_identity = 1;
+	}
 }
 
 void
 rtb_render_reset(struct rtb_element *elem)
 {
 	struct rtb_render_context *ctx = rtb_render_get_context(elem);
-	rtb_render_use_shader(ctx, &elem->window->local_storage.shader.dfault);
 
-	glScissor(elem->x - elem->surface->x,
-			elem->surface->y + elem->surface->h - elem->h - elem->y,
-			elem->w, elem->h);
-
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	ctx->pending_element = elem;
+	rtb_render_use_shader(ctx, &elem->window->local_storage.shader.dfault);
 }
 
+/**
+ * pushing an element doesn't touch GL at all. its scissor rectangle is
+ * only applied once something actually draws without going through the
+ * batch, which keeps elements that only draw stylequads from breaking
+ * up the batch.
+ */
+
 void
 rtb_render_push(struct rtb_element *elem)
 {
-	rtb_render_reset(elem);
+	rtb_render_get_context(elem)->pending_element = elem;
 }
 
 void
 rtb_render_pop(struct rtb_element *elem)
 {
-	glUseProgram(0);
+	struct rtb_render_context *ctx = rtb_render_get_context(elem);
+	struct rtb_element *parent = elem->parent;
+
+	/* hand the clip region back to the parent if it's still drawing
+	 * into the same surface. */
+	if (parent && parent->surface == elem->surface
+			&& parent != RTB_ELEMENT(elem->surface))
+		ctx->pending_element = parent;
+	else if (ctx->pending_element == elem)
+		ctx->pending_element = NULL;
 }
 
 struct rtb_render_context *
@@ -213,3 +296,50 @@ rtb_render_get_context(struct rtb_element *elem)
 {
 	return &elem->surface->render_ctx;
 }
+
+/**
+ * lifecycle
+ */
+
+int
+rtb_render_context_init(struct rtb_render_context *ctx)
+{
+	struct rtb_render_uniforms uniforms;
+
+	ctx->window = NULL;
+	ctx->state  = NULL;
+	ctx->shader = NULL;
+	ctx->pending_element = NULL;
+	ctx->clip.active = 0;
+
+	if (rtb_render_batch_init(&ctx->batch))
+		goto err_batch;
+
+	glGenBuffers(1, &ctx->uniform_buffer);
+	if (!ctx->uniform_buffer)
+		goto err_uniform_buffer;
+
+	mat4_set_identity(&ctx->projection);
+	uniforms.projection = ctx->projection;
+	mat4_set_identity(&uniforms.modelview);
+	ctx->modelview_is_identity = 1;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, ctx->uniform_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(uniforms), &uniforms,
+			GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	return 0;
+
+err_uniform_buffer:
+	rtb_render_batch_fini(&ctx->batch);
+err_batch:
+	return -1;
+}
+
+void
+rtb_render_context_fini(struct rtb_render_context *ctx)
+{
+	glDeleteBuffers(1, &ctx->uniform_buffer);
+	rtb_render_batch_fini(&ctx->batch);
+}
@@ -75,7 +75,7 @@ print_program_error(GLuint program)
 }
 
 static GLuint
-shader_link(struct rtb_shader *shader)
+shader_link(struct rtb_shader *shader, const struct rtb_shader_locations *loc)
 {
 	GLuint program;
 	GLint status;
@@ -88,6 +88,11 @@ shader_link(struct rtb_shader *shader)
 	if (shader->geometry_shader)
 		glAttachShader(program, shader->geometry_shader);
 
+	glBindAttribLocation(program, RTB_ATTRIB_VERTEX,
+			loc->vertex ? loc->vertex : "vertex");
+	glBindAttribLocation(program, RTB_ATTRIB_TEX_COORD,
+			loc->tex_coord ? loc->tex_coord : "tex_coord");
+
 	glLinkProgram(program);
 	glGetProgramiv(program, GL_LINK_STATUS, &status);
 
@@ -145,7 +150,7 @@ rtb_shader_create_with_locations(struct rtb_shader *shader,
 			|| (geometry_src && !shader->geometry_shader))
 		return 0;
 
-	status = shader_link(shader);
+	status = shader_link(shader, loc);
 	if (!status)
 		return 0;
 
@@ -156,10 +161,13 @@ rtb_shader_create_with_locations(struct rtb_shader *shader,
 #define CACHE_UNIFORM(TO, NAME) \
 	shader->TO = glGetUniformLocation(program, loc->NAME ? loc->NAME : #NAME)
 #define CACHE_SIMPLE_UNIFORM(NAME) CACHE_UNIFORM(NAME, NAME)
-#define CACHE_MATRIX_UNIFORM(NAME) CACHE_UNIFORM(matrices.NAME, NAME)
 
-	CACHE_MATRIX_UNIFORM(modelview);
-	CACHE_MATRIX_UNIFORM(projection);
+	shader->matrices = glGetUniformBlockIndex(program,
+			loc->matrices ? loc->matrices : "matrices");
+
+	if (shader->matrices != GL_INVALID_INDEX)
+		glUniformBlockBinding(program, shader->matrices,
+				RTB_UNIFORM_BLOCK_MATRICES);
 
 	CACHE_SIMPLE_UNIFORM(offset);
 	CACHE_SIMPLE_UNIFORM(color);
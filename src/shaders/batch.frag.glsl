@@ -0,0 +1,113 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#version 150
+
+uniform sampler2D tx_sampler;
+
+in vec2 coord;
+in vec4 color;
+in float shift;
+flat in vec4 clip;
+flat in float use_texture;
+flat in float gamma;
+
+out vec4 frag_color;
+
+/* the edge of a distance-field glyph is at 0.5. blending over how much
+ * the field changes across the pixel keeps it a pixel wide at any
+ * scale. */
+float
+sdf_coverage(float dist)
+{
+	return clamp(0.5 + (dist - 0.5) / max(fwidth(dist), 1e-4), 0.0, 1.0);
+}
+
+/* subpixel-positioned glyphs from an RGB atlas. this is the LCD path of
+ * text.frag.glsl. */
+vec4
+lcd_text(vec2 uv, vec2 pixel)
+{
+	vec4 current  = texture(tx_sampler, uv);
+	vec4 previous = texture(tx_sampler, uv - vec2(pixel.x, 0.0));
+
+	current  = pow(current,  vec4(1.0 / gamma));
+	previous = pow(previous, vec4(1.0 / gamma));
+
+	float r = current.r;
+	float g = current.g;
+	float b = current.b;
+
+	if (shift <= 0.333) {
+		float z = shift / 0.333;
+		r = mix(current.r, previous.b, z);
+		g = mix(current.g, current.r,  z);
+		b = mix(current.b, current.g,  z);
+	} else if (shift <= 0.666) {
+		float z = (shift - 0.33) / 0.333;
+		r = mix(previous.b, previous.g, z);
+		g = mix(current.r,  previous.b, z);
+		b = mix(current.g,  current.r,  z);
+	} else if (shift < 1.0) {
+		float z = (shift - 0.66) / 0.334;
+		r = mix(previous.g, previous.r, z);
+		g = mix(previous.b, previous.g, z);
+		b = mix(current.r,  previous.b, z);
+	}
+
+	float t = max(max(r, g), b);
+	vec4 c = vec4(color.rgb, (r + g + b) / 3.0);
+	c = t * c + (1.0 - t) * vec4(r, g, b, min(min(r, g), b));
+
+	return vec4(c.rgb, color.a * c.a);
+}
+
+void main()
+{
+	/* stands in for glScissor(), since every quad in a batch can have
+	 * a different clip rectangle. */
+	if (gl_FragCoord.x < clip.x || gl_FragCoord.x >= clip.z
+			|| gl_FragCoord.y < clip.y || gl_FragCoord.y >= clip.w)
+		discard;
+
+	/* see rtb_batch_texture_mode_t. glyph texture coordinates are in
+	 * atlas pixels, so that they survive the atlas growing. */
+	if (use_texture > 1.5) {
+		vec2 pixel = 1.0 / vec2(textureSize(tx_sampler, 0));
+
+		if (use_texture > 3.5)
+			frag_color = color * pow(sdf_coverage(
+					texture(tx_sampler, coord * pixel).r), 1.0 / gamma);
+		else if (use_texture > 2.5)
+			frag_color = lcd_text(coord * pixel, pixel);
+		else
+			frag_color = color
+				* pow(texture(tx_sampler, coord * pixel).r, 1.0 / gamma);
+	} else if (use_texture > 0.5)
+		frag_color = texture(tx_sampler, coord);
+	else
+		frag_color = color;
+}
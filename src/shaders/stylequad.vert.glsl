@@ -26,8 +26,10 @@
 
 #version 150
 
-uniform mat4 projection;
-uniform mat4 modelview;
+layout(std140) uniform matrices {
+	mat4 projection;
+	mat4 modelview;
+};
 
 uniform vec2 offset;
 
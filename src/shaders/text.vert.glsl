@@ -26,12 +26,17 @@
 
 #version 150
 
-uniform mat4 projection;
-uniform mat4 modelview;
+layout(std140) uniform matrices {
+	mat4 projection;
+	mat4 modelview;
+};
 
 uniform vec2 offset;
 uniform vec4 color;
 
+/* 1 / atlas width, 1 / atlas height, atlas depth */
+uniform vec3 atlas_pixel;
+
 in vec2 vertex;
 in vec2 tex_coord;
 in float subpixel_shift;
@@ -44,7 +49,8 @@ void main()
 {
 	vec4 offset_vector = vec4(offset.x, offset.y, 0.0, 0.0);
 
-	uv = tex_coord.xy;
+	/* glyph texture coordinates are in atlas pixels. */
+	uv = tex_coord.xy * atlas_pixel.xy;
 	shift = subpixel_shift;
 	front_color = color;
 
@@ -24,6 +24,9 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <assert.h>
+#include <string.h>
+
 #include <rutabaga/rutabaga.h>
 #include <rutabaga/element.h>
 #include <rutabaga/window.h>
@@ -75,7 +78,7 @@ load_texture(const struct rtb_style_texture_definition *def)
 {
 	const struct rtb_asset *asset = RTB_ASSET(def);
 
-	if (!RTB_ASSET_IS_LOADED(asset))
+	if (!RTB_ASSET_IS_LOADED(asset) && !RTB_ASSET_IS_DEFERRED(asset))
 		return -1;
 
 	return 0;
@@ -86,17 +89,17 @@ load_font_face(const struct rtb_style_font_face *face)
 {
 	const struct rtb_asset *asset = RTB_ASSET(face);
 
-	if (!RTB_ASSET_IS_LOADED(asset))
+	if (!RTB_ASSET_IS_LOADED(asset) && !RTB_ASSET_IS_DEFERRED(asset))
 		return -1;
 
 	return 0;
 }
 
+/* fonts aren't loaded here. see rtb_style_get_font_for_def(). */
 static int
 load_assets(struct rtb_window *window,
 		const struct rtb_style_property_definition *property)
 {
-	struct rtb_font *font;
 	int assets_loaded = 0;
 
 	for(; property->property_name; property++) {
@@ -112,15 +115,6 @@ load_assets(struct rtb_window *window,
 			if (load_font_face(property->font.face))
 				return -1;
 
-			font = rtb_style_get_font_for_def(window, &property->font);
-			font->lcd_gamma = property->font.lcd_gamma;
-
-			if (rtb_font_manager_load_embedded_font(&window->font_manager,
-						font, property->font.size,
-						property->font.face->buffer.data,
-						property->font.face->buffer.size))
-				return -1;
-
 			assets_loaded++;
 			break;
 
@@ -163,12 +157,18 @@ inherits_from(struct rtb_type_atom_descriptor *type,
 static int
 style_resolve(struct rtb_window *window, struct rtb_style *style)
 {
+	struct rtb_type_atom_descriptor *super;
 	rtb_draw_state_t state;
 
 	style->resolved_type = rtb_type_lookup(window, style->for_type);
 	if (!style->resolved_type)
 		return -1;
 
+	/* the style holds its own reference, so the descriptor stays
+	 * around when the last widget of its type is detached. */
+	for (super = style->resolved_type; super; super = super->super[0])
+		super->ref_count++;
+
 	style->inherit_from = inherits_from(style->resolved_type, style);
 
 	for (state = 0; state < RTB_DRAW_STATE_COUNT; state++) {
@@ -274,10 +274,82 @@ rtb_style_elem_has_properties_for_state(struct rtb_element *elem,
 	return 0;
 }
 
+/**
+ * fonts
+ */
+
+static int
+load_font(struct rtb_window *win, const struct rtb_style_font_definition *def,
+		struct rtb_font *font)
+{
+	const void *face;
+	size_t size;
+
+	if (!(face = rtb_asset_data(RTB_ASSET(def->face), &size)))
+		goto err;
+
+	font->lcd_gamma = def->lcd_gamma;
+
+	if (rtb_font_manager_load_embedded_font(&win->font_manager,
+				font, def->size, face, size))
+		goto err;
+
+	return 0;
+
+err:
+	printf("rutabaga: couldn't load font %s (%s) at %dpt\n",
+			def->face->family, def->face->weight, def->size);
+	return -1;
+}
+
+/**
+ * texture cache
+ */
+
+/* a compressed image is decompressed here, the first time any window
+ * draws with it. for an image in an atlas, that's the whole atlas. */
+static void
+upload_texture(struct rtb_render_state *state, GLuint handle,
+		const struct rtb_style_texture_definition *def)
+{
+	const void *data;
+	GLsizei w, h;
+	size_t size;
+
+	w = def->atlas.w ? (GLsizei) def->atlas.w : def->w;
+	h = def->atlas.w ? (GLsizei) def->atlas.h : def->h;
+
+	if (!(data = rtb_asset_data(RTB_ASSET(def), &size)))
+		printf("rutabaga: couldn't load a %dx%d style texture\n",
+				(int) w, (int) h);
+
+	/* restyles can happen in the middle of a frame, so the bind goes
+	 * through the tracker. */
+	rtb_render_state_bind_texture(state, handle);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h,
+			0, GL_BGRA, GL_UNSIGNED_BYTE, data);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
 /**
  * public API
  */
 
+static void
+link_inheritance(struct rtb_style *style_list)
+{
+	struct rtb_style *s;
+
+	for (s = style_list; s->for_type; s++)
+		if (s->resolved_type)
+			s->inherit_from = inherits_from(s->resolved_type, style_list);
+}
+
+/* styles which were resolved when one of their type's widgets was first
+ * attached are left as they are. */
 int
 rtb_style_resolve_list(struct rtb_window *win, struct rtb_style *style_list)
 {
@@ -289,19 +361,46 @@ rtb_style_resolve_list(struct rtb_window *win, struct rtb_style *style_list)
 	for (i = 0; style_list[i].for_type; i++) {
 		s = &style_list[i];
 
-		if (style_resolve(win, s))
+		if (!s->resolved_type && style_resolve(win, s))
 			unresolved_styles++;
 	}
 
-	for (i = 0; style_list[i].for_type; i++) {
-		s = &style_list[i];
-		if (!s->resolved_type)
+	link_inheritance(style_list);
+	return unresolved_styles;
+}
+
+void
+rtb_style_type_registered(struct rtb_window *win,
+		struct rtb_type_atom_descriptor *type)
+{
+	struct rtb_style *s;
+	int changed = 0;
+
+	if (!win->style_list)
+		return;
+
+	for (s = win->style_list; s->for_type; s++) {
+		if (s->resolved_type || strcmp(s->for_type, type->name))
 			continue;
 
-		s->inherit_from = inherits_from(s->resolved_type, style_list);
+		if (!style_resolve(win, s))
+			changed = 1;
 	}
 
-	return unresolved_styles;
+	if (changed)
+		link_inheritance(win->style_list);
+}
+
+void
+rtb_style_unresolve_list(struct rtb_window *win, struct rtb_style *style_list)
+{
+	struct rtb_style *s;
+
+	for (s = style_list; s->for_type; s++) {
+		rtb_type_unref(s->resolved_type);
+		s->resolved_type = NULL;
+		s->inherit_from = NULL;
+	}
 }
 
 void
@@ -322,11 +421,68 @@ rtb_style_for_element(struct rtb_element *elem, struct rtb_style *style_list)
 	return style_for_type(RTB_TYPE_ATOM(elem), style_list);
 }
 
+GLuint
+rtb_style_texture_ref(struct rtb_window *win,
+		const struct rtb_style_texture_definition *def)
+{
+	struct rtb_style_texture *tx;
+
+	assert(def->slot < win->nstyle_textures);
+	tx = &win->style_textures[def->slot];
+
+	if (!tx->gl_handle) {
+		glGenTextures(1, &tx->gl_handle);
+		upload_texture(&win->render_state, tx->gl_handle, def);
+	}
+
+	tx->refcount++;
+	return tx->gl_handle;
+}
+
+/* a texture whose refcount drops to zero stays resident. the set of
+ * textures is bounded by the stylesheet, and the next state change will
+ * most likely want it back. */
+void
+rtb_style_texture_unref(struct rtb_window *win,
+		const struct rtb_style_texture_definition *def)
+{
+	struct rtb_style_texture *tx;
+
+	assert(def->slot < win->nstyle_textures);
+	tx = &win->style_textures[def->slot];
+
+	assert(tx->refcount > 0);
+	tx->refcount--;
+}
+
+void
+rtb_style_textures_fini(struct rtb_window *win)
+{
+	size_t i;
+
+	for (i = 0; i < win->nstyle_textures; i++)
+		if (win->style_textures[i].gl_handle)
+			glDeleteTextures(1, &win->style_textures[i].gl_handle);
+}
+
 struct rtb_font *
 rtb_style_get_font_for_def(struct rtb_window *win,
 		const struct rtb_style_font_definition *def)
 {
-	return &win->style_fonts[def->slot];
+	struct rtb_font *font = &win->style_fonts[def->slot];
+
+	if (font->txfont)
+		return font;
+
+	if (win->style_fonts_failed[def->slot])
+		return NULL;
+
+	if (load_font(win, def, font)) {
+		win->style_fonts_failed[def->slot] = 1;
+		return NULL;
+	}
+
+	return font;
 }
 
 struct rtb_style_data
@@ -337,6 +493,7 @@ rtb_style_get_defaults(void)
 
 	return (struct rtb_style_data) {
 		.style = stlist,
-		.nfonts	= default_style_fonts
+		.nfonts	= default_style_fonts,
+		.ntextures = default_style_textures
 	};
 }
@@ -24,34 +24,39 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <math.h>
+#include <string.h>
+
 #include <rutabaga/rutabaga.h>
 #include <rutabaga/element.h>
 #include <rutabaga/render.h>
 #include <rutabaga/style.h>
 #include <rutabaga/quad.h>
+#include <rutabaga/shader.h>
 #include <rutabaga/stylequad.h>
 #include <rutabaga/window.h>
 
 #include "rtb_private/util.h"
+#include "rtb_private/stylequad-indices.h"
 
 /**
  * drawing
  */
 
 static void
-draw_solid(const struct rtb_stylequad *self, const struct rtb_shader *shader,
+draw_elements(struct rtb_render_context *ctx,
 		GLenum mode, GLuint ibo, GLsizei count)
 {
-	glBindBuffer(GL_ARRAY_BUFFER, self->vertices);
-	glEnableVertexAttribArray(shader->vertex);
-	glVertexAttribPointer(shader->vertex, 2, GL_FLOAT, GL_FALSE, 0, 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	rtb_render_state_bind_buffer(ctx->state, GL_ELEMENT_ARRAY_BUFFER, ibo);
 	glDrawElements(mode, count, GL_UNSIGNED_BYTE, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
 
-	glDisableVertexAttribArray(shader->vertex);
+static void
+draw_solid(struct rtb_render_context *ctx, const struct rtb_stylequad *self,
+		GLenum mode, GLuint ibo, GLsizei count)
+{
+	rtb_render_state_bind_vertex_array(ctx->state, self->vao);
+	draw_elements(ctx, mode, ibo, count);
 }
 
 static void
@@ -61,28 +66,22 @@ draw_textured(struct rtb_render_context *ctx,
 {
 	const struct rtb_shader *shader = ctx->shader;
 
-	glBindTexture(GL_TEXTURE_2D, tx->gl_handle);
+	rtb_render_state_bind_texture(ctx->state, tx->gl_handle);
 	glUniform1i(shader->texture, 0);
 	glUniform2f(shader->texture_size,
 			tx->definition->w, tx->definition->h);
 
-	glBindBuffer(GL_ARRAY_BUFFER, tx->coords);
-	glEnableVertexAttribArray(shader->tex_coord);
-	glVertexAttribPointer(shader->tex_coord,
-			2, GL_FLOAT, GL_FALSE, 0, 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	rtb_render_state_bind_vertex_array(ctx->state, tx->vao);
 
 	/* XXX: hardcoded `count` value here */
 	if (border)
-		draw_solid(self, shader, GL_TRIANGLES,
+		draw_elements(ctx, GL_TRIANGLES,
 				ctx->window->local_storage.ibo.stylequad.border, 48);
 
 	if (!border || tx->definition->flags & RTB_TEXTURE_FILL)
-		draw_solid(self, shader, GL_TRIANGLE_STRIP,
+		draw_elements(ctx, GL_TRIANGLE_STRIP,
 				ctx->window->local_storage.ibo.stylequad.solid, 4);
 
-	glDisableVertexAttribArray(shader->tex_coord);
-	glBindTexture(GL_TEXTURE_2D, 0);
 	glUniform2f(shader->texture_size, 0.f, 0.f);
 }
 
@@ -102,7 +101,7 @@ draw(struct rtb_render_context *ctx, const struct rtb_stylequad *self,
 				self->properties.bg_color->b,
 				self->properties.bg_color->a);
 
-		draw_solid(self, shader, GL_TRIANGLE_STRIP,
+		draw_solid(ctx, self, GL_TRIANGLE_STRIP,
 				ctx->window->local_storage.ibo.stylequad.solid, 4);
 	}
 
@@ -124,11 +123,144 @@ draw(struct rtb_render_context *ctx, const struct rtb_stylequad *self,
 
 		glLineWidth(1.f);
 
-		draw_solid(self, shader, GL_LINE_LOOP,
+		draw_solid(ctx, self, GL_LINE_LOOP,
 				ctx->window->local_storage.ibo.stylequad.outline, 4);
 	}
 }
 
+/**
+ * batched drawing
+ */
+
+static void
+batch_set_color(struct rtb_batch_vertex *v, const struct rtb_rgb_color *c)
+{
+	GLubyte color[4] = {
+		lrintf(c->r * 255.f),
+		lrintf(c->g * 255.f),
+		lrintf(c->b * 255.f),
+		lrintf(c->a * 255.f)
+	};
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		memcpy(v[i].color, color, sizeof(color));
+		v[i].textured = RTB_BATCH_UNTEXTURED;
+	}
+}
+
+static void
+batch_set_texture(struct rtb_batch_vertex *v,
+		const struct rtb_stylequad_texture *tx)
+{
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		v[i].s = tx->coord_data[i][0];
+		v[i].t = tx->coord_data[i][1];
+		v[i].textured = RTB_BATCH_TEXTURED;
+	}
+}
+
+static int
+batch_textured(struct rtb_render_batch *batch, struct rtb_batch_vertex *v,
+		const struct rtb_stylequad_texture *tx, int border)
+{
+	batch_set_texture(v, tx);
+
+	if (border && rtb_render_batch_add(batch, GL_TRIANGLES, tx->gl_handle,
+				v, stylequad_border_indices,
+				ARRAY_LENGTH(stylequad_border_indices)))
+		return -1;
+
+	if ((!border || tx->definition->flags & RTB_TEXTURE_FILL)
+			&& rtb_render_batch_add(batch, GL_TRIANGLE_STRIP,
+				tx->gl_handle, v, stylequad_solid_indices,
+				ARRAY_LENGTH(stylequad_solid_indices)))
+		return -1;
+
+	return 0;
+}
+
+static int
+batch(struct rtb_render_context *ctx, const struct rtb_stylequad *self,
+		struct rtb_element *on, const mat4 *mv,
+		rtb_stylequad_draw_mode_t mode)
+{
+	struct rtb_render_batch *batch = &ctx->batch;
+	struct rtb_batch_vertex v[16];
+	const GLfloat (*g)[2];
+	GLint scissor[4];
+	int i;
+
+	if (!((self->properties.bg_color && mode & RTB_STYLEQUAD_DRAW_BG_COLOR)
+			|| (self->background_image.definition
+				&& mode & RTB_STYLEQUAD_DRAW_BG_IMAGE)
+			|| (self->border_image.definition
+				&& mode & RTB_STYLEQUAD_DRAW_BORDER_IMAGE)
+			|| (self->properties.border_color
+				&& mode & RTB_STYLEQUAD_DRAW_BORDER_COLOR)))
+		return 0;
+
+	rtb_render_get_scissor(on, scissor);
+
+	/* this is what the stylequad vertex shader would do with
+	 * `offset` and `modelview`. */
+	for (g = self->geometry, i = 0; i < 16; i++) {
+		if (mv) {
+			v[i].x = mv->m00 * g[i][0] + mv->m10 * g[i][1] + mv->m30;
+			v[i].y = mv->m01 * g[i][0] + mv->m11 * g[i][1] + mv->m31;
+		} else {
+			v[i].x = g[i][0];
+			v[i].y = g[i][1];
+		}
+
+		v[i].x += self->offset.x;
+		v[i].y += self->offset.y;
+
+		v[i].s = v[i].t = 0.f;
+		v[i].text[0] = v[i].text[1] = 0.f;
+
+		v[i].clip[0] = scissor[0];
+		v[i].clip[1] = scissor[1];
+		v[i].clip[2] = scissor[0] + scissor[2];
+		v[i].clip[3] = scissor[1] + scissor[3];
+	}
+
+	if (self->properties.bg_color && (mode & RTB_STYLEQUAD_DRAW_BG_COLOR)) {
+		batch_set_color(v, self->properties.bg_color);
+		if (rtb_render_batch_add(batch, GL_TRIANGLE_STRIP, 0, v,
+					stylequad_solid_indices,
+					ARRAY_LENGTH(stylequad_solid_indices)))
+			return -1;
+	}
+
+	if (self->background_image.definition
+			&& (mode & RTB_STYLEQUAD_DRAW_BG_IMAGE)
+			&& batch_textured(batch, v, &self->background_image, 0))
+		return -1;
+
+	if (self->border_image.definition
+			&& (mode & RTB_STYLEQUAD_DRAW_BORDER_IMAGE)
+			&& batch_textured(batch, v, &self->border_image, 1))
+		return -1;
+
+	if (self->properties.border_color
+			&& mode & RTB_STYLEQUAD_DRAW_BORDER_COLOR) {
+		batch_set_color(v, self->properties.border_color);
+		if (rtb_render_batch_add(batch, GL_LINE_LOOP, 0, v,
+					stylequad_outline_indices,
+					ARRAY_LENGTH(stylequad_outline_indices)))
+			return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * public API
+ */
+
 void
 rtb_stylequad_draw(const struct rtb_stylequad *self,
 		struct rtb_render_context *ctx, const struct rtb_point *center,
@@ -146,41 +278,51 @@ rtb_stylequad_draw_solid(const struct rtb_stylequad *self,
 	rtb_render_set_position(ctx, center->x, center->y);
 	glUniform2f(shader->texture_size, 0.f, 0.f);
 
-	draw_solid(self, shader, GL_TRIANGLE_STRIP,
+	draw_solid(ctx, self, GL_TRIANGLE_STRIP,
 			ctx->window->local_storage.ibo.stylequad.solid, 4);
 }
 
-void
+int
 rtb_stylequad_draw_on_element(struct rtb_stylequad *self,
 		struct rtb_element *on, rtb_stylequad_draw_mode_t mode)
 {
-	struct rtb_shader *shader = &on->window->local_storage.shader.stylequad;
-	struct rtb_render_context *ctx = rtb_render_get_context(on);
-
-	rtb_render_reset(on);
-	rtb_render_use_shader(ctx, shader);
-
-	draw(ctx, self, &self->offset, mode);
+	return batch(rtb_render_get_context(on), self, on, NULL, mode);
 }
 
-void
+int
 rtb_stylequad_draw_with_modelview(struct rtb_stylequad *self, struct rtb_element *on,
 		const mat4 *modelview, rtb_stylequad_draw_mode_t mode)
 {
-	struct rtb_shader *shader = &on->window->local_storage.shader.stylequad;
-	struct rtb_render_context *ctx = rtb_render_get_context(on);
-
-	rtb_render_reset(on);
-	rtb_render_use_shader(ctx, shader);
-	rtb_render_set_modelview(ctx, modelview->data);
-
-	draw(ctx, self, &self->offset, mode);
+	return batch(rtb_render_get_context(on), self, on, modelview, mode);
 }
 
 /**
  * property/style wrangling
  */
 
+/* `v` is in the image's own texture coordinates. an image packed into
+ * an atlas only covers its own rectangle of the texture. */
+static void
+map_into_atlas(const struct rtb_style_texture_definition *d,
+		GLfloat v[16][2])
+{
+	GLfloat x, y, w, h;
+	int i;
+
+	if (!d->atlas.w)
+		return;
+
+	x = d->atlas.x / (GLfloat) d->atlas.w;
+	y = d->atlas.y / (GLfloat) d->atlas.h;
+	w = d->w / (GLfloat) d->atlas.w;
+	h = d->h / (GLfloat) d->atlas.h;
+
+	for (i = 0; i < 16; i++) {
+		v[i][0] = x + v[i][0] * w;
+		v[i][1] = y + v[i][1] * h;
+	}
+}
+
 static void
 set_border_tex_coords(struct rtb_stylequad_texture *tx)
 {
@@ -216,6 +358,9 @@ set_border_tex_coords(struct rtb_stylequad_texture *tx)
 		{1.f - bdr_rgt, 0.f},
 	};
 
+	map_into_atlas(d, v);
+	memcpy(tx->coord_data, v, sizeof(v));
+
 	glBindBuffer(GL_ARRAY_BUFFER, tx->coords);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -231,6 +376,9 @@ set_background_tex_coords(struct rtb_stylequad_texture *tx)
 		[12] = {1.f, 0.f}
 	};
 
+	map_into_atlas(tx->definition, v);
+	memcpy(tx->coord_data, v, sizeof(v));
+
 	glBindBuffer(GL_ARRAY_BUFFER, tx->coords);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -238,8 +386,39 @@ set_background_tex_coords(struct rtb_stylequad_texture *tx)
 
 
 
+/**
+ * vertex arrays
+ */
+
+static void
+attach_buffer(GLuint attrib, GLuint buffer)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glEnableVertexAttribArray(attrib);
+	glVertexAttribPointer(attrib, 2, GL_FLOAT, GL_FALSE, 0, 0);
+}
+
+static void
+init_vertex_array(GLuint *vao, GLuint vertices, GLuint coords)
+{
+	glGenVertexArrays(1, vao);
+	glBindVertexArray(*vao);
+
+	attach_buffer(RTB_ATTRIB_VERTEX, vertices);
+	if (coords)
+		attach_buffer(RTB_ATTRIB_TEX_COORD, coords);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+/**
+ * textures
+ */
+
 static int
-load_texture(struct rtb_stylequad_texture *dst,
+load_texture(struct rtb_stylequad *self, struct rtb_window *win,
+		struct rtb_stylequad_texture *dst,
 		const struct rtb_style_texture_definition *src)
 {
 	if (dst->definition == src)
@@ -247,35 +426,26 @@ load_texture(struct rtb_stylequad_texture *dst,
 
 	if (!dst->coords) {
 		glGenBuffers(1, &dst->coords);
-		glGenTextures(1, &dst->gl_handle);
+		init_vertex_array(&dst->vao, self->vertices, dst->coords);
 	}
 
-	glBindTexture(GL_TEXTURE_2D, dst->gl_handle);
-
-	if (!src) {
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 0, 0,
-				0, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
-	} else {
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
-				src->w, src->h,
-				0, GL_BGRA, GL_UNSIGNED_BYTE,
-				RTB_ASSET_DATA(RTB_ASSET(src)));
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	}
+	/* take the new reference before dropping the old one so that
+	 * swapping between two images never releases either. */
+	dst->gl_handle = src ? rtb_style_texture_ref(win, src) : 0;
 
-	glBindTexture(GL_TEXTURE_2D, 0);
+	if (dst->definition)
+		rtb_style_texture_unref(self->window, dst->definition);
 
+	self->window = win;
 	dst->definition = src;
 	return 0;
 }
 
 int
 rtb_stylequad_set_border_image(struct rtb_stylequad *self,
-		const struct rtb_style_texture_definition *tx)
+		struct rtb_window *win, const struct rtb_style_texture_definition *tx)
 {
-	if (load_texture(&self->border_image, tx))
+	if (load_texture(self, win, &self->border_image, tx))
 		return -1;
 
 	if (tx)
@@ -286,9 +456,9 @@ rtb_stylequad_set_border_image(struct rtb_stylequad *self,
 
 int
 rtb_stylequad_set_background_image(struct rtb_stylequad *self,
-		const struct rtb_style_texture_definition *tx)
+		struct rtb_window *win, const struct rtb_style_texture_definition *tx)
 {
-	if (load_texture(&self->background_image, tx))
+	if (load_texture(self, win, &self->background_image, tx))
 		return -1;
 
 	if (tx)
@@ -374,6 +544,7 @@ rtb_stylequad_update_geometry(struct rtb_stylequad *self,
 			{r.x2 - bdr_rgt, r.y2}
 		};
 
+		memcpy(self->geometry, v, sizeof(v));
 		glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
 	} else {
 		GLfloat v[16][2] = {
@@ -383,6 +554,7 @@ rtb_stylequad_update_geometry(struct rtb_stylequad *self,
 			[9]  = {r.x,  r.y2}
 		};
 
+		memcpy(self->geometry, v, sizeof(v));
 		glBufferData(GL_ARRAY_BUFFER, sizeof(v), v, GL_STATIC_DRAW);
 	}
 
@@ -397,13 +569,17 @@ rtb_stylequad_update_geometry(struct rtb_stylequad *self,
 	(tx)->definition = NULL;												\
 	(tx)->coords    = 0;													\
 	(tx)->gl_handle = 0;													\
+	(tx)->vao       = 0;													\
 } while (0)
 
-#define FINI_STYLEQUAD_TEXTURE(tx) do {										\
+#define FINI_STYLEQUAD_TEXTURE(self, tx) do {								\
 	if ((tx)->coords) {														\
 		glDeleteBuffers(1, &(tx)->coords);									\
-		glDeleteTextures(1, &(tx)->gl_handle);								\
+		glDeleteVertexArrays(1, &(tx)->vao);								\
 	}																		\
+																			\
+	if ((tx)->definition)													\
+		rtb_style_texture_unref((self)->window, (tx)->definition);			\
 } while (0)
 
 void
@@ -411,6 +587,7 @@ rtb_stylequad_init(struct rtb_stylequad *self)
 {
 	memset(self, 0, sizeof(*self));
 	glGenBuffers(1, &self->vertices);
+	init_vertex_array(&self->vao, self->vertices, 0);
 
 	INIT_STYLEQUAD_TEXTURE(&self->border_image);
 	INIT_STYLEQUAD_TEXTURE(&self->background_image);
@@ -418,8 +595,9 @@ rtb_stylequad_init(struct rtb_stylequad *self)
 
 void rtb_stylequad_fini(struct rtb_stylequad *self)
 {
-	FINI_STYLEQUAD_TEXTURE(&self->border_image);
-	FINI_STYLEQUAD_TEXTURE(&self->background_image);
+	FINI_STYLEQUAD_TEXTURE(self, &self->border_image);
+	FINI_STYLEQUAD_TEXTURE(self, &self->background_image);
 
 	glDeleteBuffers(1, &self->vertices);
+	glDeleteVertexArrays(1, &self->vao);
 }
@@ -25,6 +25,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include <rutabaga/rutabaga.h>
@@ -71,34 +72,39 @@ reflow(struct rtb_element *elem, struct rtb_element *instigator,
 		}
 	};
 
+	struct rtb_render_state *state;
+	mat4 projection;
+
 	SELF_FROM(elem);
 	if (!super.reflow(elem, instigator, direction))
 		return 0;
 
+	state = &self->window->render_state;
+
 	if (self->w <= 0 || self->h <= 0)
 		return -1;
 
-	mat4_set_orthographic(&self->render_ctx.projection,
+	mat4_set_orthographic(&projection,
 			self->x, self->x + self->w,
 			self->y + self->h, self->y,
 			-1.f, 1.f);
+	rtb_render_set_projection(&self->render_ctx, &projection);
 
-	glBindTexture(GL_TEXTURE_2D, self->texture);
+	rtb_render_state_bind_texture(state, self->texture);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
 			lrintf(self->w), lrintf(self->h), 0,
 			GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glBindTexture(GL_TEXTURE_2D, 0);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, self->fbo);
+	rtb_render_state_bind_framebuffer(state, self->fbo);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
 			GL_TEXTURE_2D, self->texture, 0);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	rtb_render_state_bind_framebuffer(state, 0);
 
-	rtb_quad_set_vertices(&self->quad, &self->rect);
-	rtb_quad_set_tex_coords(&self->quad, &tex_coords);
+	rtb_quad_set_vertices(&self->quad, state, &self->rect);
+	rtb_quad_set_tex_coords(&self->quad, state, &tex_coords);
 
 	rtb_surface_invalidate(self);
 
@@ -118,9 +124,14 @@ static void
 attached(struct rtb_element *self,
 		struct rtb_element *parent, struct rtb_window *window)
 {
+	struct rtb_surface *surface = RTB_ELEMENT_AS(self, rtb_surface);
+
 	super.attached(self, parent, window);
 	self->type = rtb_type_ref(window, self->type,
 			"net.illest.rutabaga.surface");
+
+	surface->render_ctx.window = window;
+	surface->render_ctx.state = &window->render_state;
 }
 
 static void
@@ -161,37 +172,59 @@ rtb_surface_blit(struct rtb_surface *self)
 	rtb_render_use_shader(ctx, shader);
 	rtb_render_set_position(ctx, 0, 0);
 
-	glBindTexture(GL_TEXTURE_2D, self->texture);
+	rtb_render_state_bind_texture(ctx->state, self->texture);
 	glUniform1i(shader->texture, 0);
 
-	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	rtb_render_state_blend_func(ctx->state, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
 	rtb_render_quad(ctx, &self->quad);
 
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-
 	LAYOUT_DEBUG_DRAW_BOX(elem);
 }
 
 void
 rtb_surface_draw_children(struct rtb_surface *self)
 {
+	struct rtb_render_state *state = &self->window->render_state;
+	struct rtb_frame_timing *timing = &self->window->frame_timing;
 	struct rtb_element *iter;
 
-	GLint bound_fb;
+	GLuint bound_fb;
 	GLint viewport[4];
+	int offscreen;
 
 	if (!rtb_surface_is_dirty(self))
 		return;
 
-	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &bound_fb);
-	glGetIntegerv(GL_VIEWPORT, viewport);
+	/* the window's own pass is the whole frame, which is timed
+	 * separately. */
+	offscreen = self != RTB_SURFACE(self->window);
+	if (offscreen)
+		rtb_frame_timing_begin(timing, RTB_FRAME_STAGE_SURFACE);
+
+	/* whatever the parent surface has batched up belongs in its
+	 * framebuffer, not ours. */
+	rtb_render_flush(rtb_render_get_context(RTB_ELEMENT(self)));
+
+	/* the state tracker already knows what's bound, so there's no need
+	 * to stall on glGetIntegerv() here. */
+	if ((state->known & RTB_RENDER_STATE_FRAMEBUFFER)
+			&& (state->known & RTB_RENDER_STATE_VIEWPORT)) {
+		bound_fb = state->framebuffer;
+		memcpy(viewport, state->viewport, sizeof(viewport));
+	} else {
+		GLint fb;
+
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &fb);
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		bound_fb = fb;
+	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, self->fbo);
-	glViewport(0, 0, self->w, self->h);
+	rtb_render_state_bind_framebuffer(state, self->fbo);
+	rtb_render_state_viewport(state, 0, 0, self->w, self->h);
 
 	self->render_ctx.window = self->window;
+	self->render_ctx.state = state;
 
 	/* we have slightly different ways of handling this redraw depending
 	 * on what the state of the surface is. */
@@ -200,9 +233,9 @@ rtb_surface_draw_children(struct rtb_surface *self)
 		/* if we're marked as invalid, we clear the entire surface and
 		 * redraw it from scratch. */
 
-		glDisable(GL_SCISSOR_TEST);
+		rtb_render_state_scissor_test(state, 0);
 		rtb_render_clear(RTB_ELEMENT(self));
-		glEnable(GL_SCISSOR_TEST);
+		rtb_render_state_scissor_test(state, 1);
 
 		/* first, we clean out the renderqueue for dirty elements (since
 		 * we're going to be redrawing everything anyway.) */
@@ -235,14 +268,22 @@ rtb_surface_draw_children(struct rtb_surface *self)
 		break;
 	}
 
-	glBindFramebuffer(GL_FRAMEBUFFER, bound_fb);
-	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	rtb_render_flush(&self->render_ctx);
+	rtb_damage_clear(&self->damage);
+
+	rtb_render_state_bind_framebuffer(state, bound_fb);
+	rtb_render_state_viewport(state,
+			viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	if (offscreen)
+		rtb_frame_timing_end(timing, RTB_FRAME_STAGE_SURFACE);
 }
 
 void
 rtb_surface_invalidate(struct rtb_surface *self)
 {
 	self->surface_state = RTB_SURFACE_INVALID;
+	rtb_damage_add_all(&self->damage);
 	rtb_elem_mark_dirty(RTB_ELEMENT(self));
 }
 
@@ -261,19 +302,28 @@ rtb_surface_init(struct rtb_surface *self)
 
 	TAILQ_INIT(&self->render_queue);
 
+	if (rtb_render_context_init(&self->render_ctx))
+		goto err_render_ctx;
+
 	glGenTextures(1, &self->texture);
 	glGenFramebuffers(1, &self->fbo);
 	rtb_quad_init(&self->quad);
 
 	self->surface_state = RTB_SURFACE_INVALID;
+	rtb_damage_add_all(&self->damage);
 
 	return 0;
+
+err_render_ctx:
+	rtb_elem_fini(RTB_ELEMENT(self));
+	return -1;
 }
 
 void
 rtb_surface_fini(struct rtb_surface *self)
 {
 	rtb_quad_fini(&self->quad);
+	rtb_render_context_fini(&self->render_ctx);
 
 	glDeleteFramebuffers(1, &self->fbo);
 	glDeleteTextures(1, &self->texture);
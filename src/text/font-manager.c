@@ -24,15 +24,20 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <rutabaga/rutabaga.h>
 #include <rutabaga/font-manager.h>
+#include <rutabaga/text-cache.h>
 #include <rutabaga/window.h>
 #include <rutabaga/shader.h>
 
+#include <rtb_private/glyph-cache.h>
+
 #include "shaders/text.glsl.h"
+#include "shaders/text-sdf.glsl.h"
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -56,29 +61,380 @@ static const rtb_utf32_t default_cache[] = {
 	' ', ',', '.', '!', '?', ';', '[', '\\', ']', '^', '_', '@', '{', '|', '}', '~', '\"', '#', '$', '%', '&', '\'', '(', ')',
 	'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z',
 	'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z',
-	'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '*', '+', '-', '/', ':', '<', '=', '>', '`'
+	'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '*', '+', '-', '/', ':', '<', '=', '>', '`',
+	0
 };
 
 static int
 init_font(struct rtb_font *font, const rtb_utf32_t *cache)
 {
+	const char *dir = font->fm->glyph_cache_dir;
+	texture_glyph_batch_t *batch;
+
 	if (0)
 		memcpy(font->txfont->lcd_weights, lcd_weights, sizeof(lcd_weights));
 
-	texture_font_load_glyphs(font->txfont, cache ? cache : default_cache);
+	if (!cache)
+		cache = default_cache;
+
+	if (dir && !rtb_glyph_cache_load(dir, font->txfont, cache))
+		return 0;
+
+	if (!(batch = texture_font_new_batch(font->txfont, cache)))
+		return -1;
+
+	texture_glyph_batch_render(batch);
+	texture_font_add_batch(font->txfont, batch);
+
+	if (dir)
+		rtb_glyph_cache_store(dir, font->txfont, cache, batch);
+
+	texture_glyph_batch_delete(batch);
 	return 0;
 }
 
 /**
- * emebedded font
+ * glyph rasterisation
  */
 
-int
-rtb_font_manager_load_embedded_font(struct rtb_font_manager *fm,
-		struct rtb_font *font, int pt_size, const void *base, size_t size)
+struct rtb_glyph_job {
+	uv_work_t work;
+	struct rtb_font_manager *fm;
+
+	/* NULL once the font has been freed, in which case the batch is
+	 * thrown away when it lands. */
+	texture_font_t *txfont;
+	texture_glyph_batch_t *batch;
+
+	/* `rendered` is set by the worker, under the manager's glyph lock.
+	 * the job is freed once it has landed and libuv has returned it. a
+	 * job abandoned by fini_jobs() has already lost its batch and left
+	 * the manager's list, and only the job itself is freed on return. */
+	int rendered;
+	int landed;
+	int returned;
+	int abandoned;
+
+	TAILQ_ENTRY(rtb_glyph_job) entry;
+};
+
+static void
+free_job(struct rtb_glyph_job *job)
+{
+	texture_glyph_batch_delete(job->batch);
+	free(job);
+}
+
+static void
+render_job(uv_work_t *work)
+{
+	struct rtb_glyph_job *job =
+		RTB_CONTAINER_OF(work, struct rtb_glyph_job, work);
+
+	texture_glyph_batch_render(job->batch);
+
+	uv_mutex_lock(&job->fm->glyph_lock);
+	job->rendered = 1;
+	uv_cond_broadcast(&job->fm->glyph_rendered);
+	uv_mutex_unlock(&job->fm->glyph_lock);
+}
+
+/* adds every batch which has been rendered to its font. */
+static void
+land_jobs(struct rtb_font_manager *fm)
+{
+	struct rtb_glyph_job *job, *next;
+	int rendered;
+
+	for (job = TAILQ_FIRST(&fm->glyph_jobs); job; job = next) {
+		next = TAILQ_NEXT(job, entry);
+
+		uv_mutex_lock(&fm->glyph_lock);
+		rendered = job->rendered;
+		uv_mutex_unlock(&fm->glyph_lock);
+
+		if (!rendered || job->landed)
+			continue;
+
+		if (job->txfont) {
+			texture_font_add_batch(job->txfont, job->batch);
+			fm->glyphs_landed = 1;
+		}
+
+		job->landed = 1;
+
+		if (job->returned) {
+			TAILQ_REMOVE(&fm->glyph_jobs, job, entry);
+			free_job(job);
+		}
+	}
+}
+
+static void
+job_returned(uv_work_t *work, int status)
+{
+	struct rtb_glyph_job *job =
+		RTB_CONTAINER_OF(work, struct rtb_glyph_job, work);
+	struct rtb_font_manager *fm;
+
+	/* the manager is gone. */
+	if (job->abandoned) {
+		free(job);
+		return;
+	}
+
+	fm = job->fm;
+	job->returned = 1;
+
+	if (job->landed) {
+		TAILQ_REMOVE(&fm->glyph_jobs, job, entry);
+		free_job(job);
+	}
+
+	/* land it, or let whatever was waiting on it know it's landed. */
+	rtb_window_request_frame(fm->window);
+}
+
+static void
+send_queued(struct rtb_font_manager *fm, texture_font_t *txfont)
 {
-	font->txfont =
-		texture_font_new_from_memory(fm->atlas, pt_size, base, size);
+	struct rtb_window *win = fm->window;
+	texture_glyph_batch_t *batch;
+	struct rtb_glyph_job *job;
+
+	if (!(batch = texture_font_take_queued(txfont)))
+		return;
+
+	if (!(job = calloc(1, sizeof(*job)))) {
+		texture_glyph_batch_render(batch);
+		texture_font_add_batch(txfont, batch);
+		texture_glyph_batch_delete(batch);
+
+		fm->glyphs_landed = 1;
+		return;
+	}
+
+	job->fm = fm;
+	job->txfont = txfont;
+	job->batch = batch;
+	TAILQ_INSERT_TAIL(&fm->glyph_jobs, job, entry);
+
+	/* without an event loop to hand it to, the batch is rendered here
+	 * and lands with the rest. */
+	if (!win || !win->rtb || uv_queue_work(&win->rtb->event_loop, &job->work,
+				render_job, job_returned)) {
+		render_job(&job->work);
+		job->returned = 1;
+	}
+}
+
+static int
+font_rendering(struct rtb_font_manager *fm, const texture_font_t *txfont)
+{
+	struct rtb_glyph_job *job;
+
+	TAILQ_FOREACH(job, &fm->glyph_jobs, entry)
+		if (job->txfont == txfont && !job->rendered)
+			return 1;
+
+	return 0;
+}
+
+/* called before a txfont is deleted. its batches read the face's file or
+ * memory while they render, so the ones still rendering are waited for,
+ * and whatever the face was loaded from can go (or be unmapped) as soon as
+ * the font has. */
+static void
+forget_jobs(struct rtb_font_manager *fm, const texture_font_t *txfont)
+{
+	struct rtb_glyph_job *job;
+
+	uv_mutex_lock(&fm->glyph_lock);
+
+	TAILQ_FOREACH(job, &fm->glyph_jobs, entry) {
+		if (job->txfont != txfont)
+			continue;
+
+		while (!job->rendered)
+			uv_cond_wait(&fm->glyph_rendered, &fm->glyph_lock);
+
+		job->txfont = NULL;
+	}
+
+	uv_mutex_unlock(&fm->glyph_lock);
+}
+
+/* jobs libuv hasn't started on are cancelled, and the ones it has are
+ * waited for, so that no batch (or the face it renders from) outlives the
+ * manager. the event loop isn't run from here: a job libuv still has to
+ * hand back is abandoned, and job_returned() frees what's left of it. */
+static void
+fini_jobs(struct rtb_font_manager *fm)
+{
+	struct rtb_glyph_job *job;
+	int cancelled;
+
+	while ((job = TAILQ_FIRST(&fm->glyph_jobs))) {
+		TAILQ_REMOVE(&fm->glyph_jobs, job, entry);
+
+		if (job->returned) {
+			free_job(job);
+			continue;
+		}
+
+		cancelled = !uv_cancel((uv_req_t *) &job->work);
+
+		uv_mutex_lock(&fm->glyph_lock);
+		while (!cancelled && !job->rendered)
+			uv_cond_wait(&fm->glyph_rendered, &fm->glyph_lock);
+		uv_mutex_unlock(&fm->glyph_lock);
+
+		texture_glyph_batch_delete(job->batch);
+		job->batch = NULL;
+		job->abandoned = 1;
+	}
+
+	uv_cond_destroy(&fm->glyph_rendered);
+	uv_mutex_destroy(&fm->glyph_lock);
+}
+
+/**
+ * distance-field faces
+ */
+
+static int
+init_shader(struct rtb_font_shader *shader,
+		const char *vert, const char *frag)
+{
+	if (!rtb_shader_create(RTB_SHADER(shader), vert, NULL, frag))
+		return -1;
+
+#define CACHE_UNIFORM(UNIFORM) \
+	shader->UNIFORM = glGetUniformLocation(shader->program, #UNIFORM)
+
+	CACHE_UNIFORM(offset);
+	CACHE_UNIFORM(texture);
+	CACHE_UNIFORM(atlas_pixel);
+	CACHE_UNIFORM(gamma);
+
+#undef CACHE_UNIFORM
+
+	return 0;
+}
+
+static int
+init_sdf(struct rtb_font_manager *fm)
+{
+	if (init_shader(&fm->sdf_shader,
+				TEXT_SDF_VERT_SHADER, TEXT_SDF_FRAG_SHADER)) {
+		ERR("couldn't compile distance-field text shader.\n");
+		return -1;
+	}
+
+	fm->sdf_atlas = texture_atlas_new(512, 512, 1,
+			fm->atlas->dpi.x, fm->atlas->dpi.y);
+
+	/* the fields get scaled, so they have to be interpolated. */
+	fm->sdf_atlas->filter = GL_LINEAR;
+	return 0;
+}
+
+static int
+same_face(const texture_font_t *txfont, const void *base, const char *path)
+{
+	if (path)
+		return txfont->location == TEXTURE_FONT_FILE
+			&& !strcmp(txfont->filename, path);
+
+	return txfont->location == TEXTURE_FONT_MEMORY
+		&& txfont->memory.base == base;
+}
+
+/* the distance-field txfont for a face, loaded from `path` if it's set
+ * and from memory otherwise. */
+static texture_font_t *
+get_sdf_txfont(struct rtb_font_manager *fm,
+		const void *base, size_t size, const char *path)
+{
+	struct rtb_sdf_face *face;
+	texture_font_t *txfont;
+
+	LIST_FOREACH(face, &fm->sdf_faces, entry) {
+		if (same_face(face->txfont, base, path)) {
+			face->refcount++;
+			return face->txfont;
+		}
+	}
+
+	if (!fm->sdf_atlas && init_sdf(fm))
+		return NULL;
+
+	if (!(face = malloc(sizeof(*face))))
+		return NULL;
+
+	txfont = path
+		? texture_font_new_from_file(fm->sdf_atlas, RTB_FONT_SDF_SIZE, path)
+		: texture_font_new_from_memory(fm->sdf_atlas, RTB_FONT_SDF_SIZE,
+				base, size);
+
+	if (!txfont) {
+		free(face);
+		return NULL;
+	}
+
+	txfont->rendermode = RENDER_SIGNED_DISTANCE_FIELD;
+
+	face->txfont = txfont;
+	face->refcount = 1;
+	LIST_INSERT_HEAD(&fm->sdf_faces, face, entry);
+
+	return txfont;
+}
+
+static void
+free_sdf_face(struct rtb_sdf_face *face)
+{
+	LIST_REMOVE(face, entry);
+	texture_font_delete(face->txfont);
+	free(face);
+}
+
+static void
+release_txfont(struct rtb_font *font)
+{
+	struct rtb_sdf_face *face;
+
+	if (font->txfont->rendermode == RENDER_NORMAL) {
+		forget_jobs(font->fm, font->txfont);
+		texture_font_delete(font->txfont);
+		return;
+	}
+
+	LIST_FOREACH(face, &font->fm->sdf_faces, entry) {
+		if (face->txfont == font->txfont) {
+			if (!--face->refcount) {
+				forget_jobs(font->fm, face->txfont);
+				free_sdf_face(face);
+			}
+
+			return;
+		}
+	}
+}
+
+static int
+load_font(struct rtb_font_manager *fm, struct rtb_font *font, int pt_size,
+		const void *base, size_t size, const char *path)
+{
+	if (fm->raster == RTB_FONT_RASTER_SDF) {
+		font->txfont = get_sdf_txfont(fm, base, size, path);
+		font->scale  = pt_size / (float) RTB_FONT_SDF_SIZE;
+	} else {
+		font->txfont = path
+			? texture_font_new_from_file(fm->atlas, pt_size, path)
+			: texture_font_new_from_memory(fm->atlas, pt_size, base, size);
+		font->scale  = 1.f;
+	}
 
 	if (!font->txfont)
 		return -1;
@@ -86,7 +442,116 @@ rtb_font_manager_load_embedded_font(struct rtb_font_manager *fm,
 	font->size = pt_size;
 	font->fm   = fm;
 
-	init_font(font, fm->cache_glyphs);
+	if (init_font(font, fm->cache_glyphs)) {
+		release_txfont(font);
+		font->txfont = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * glyphs
+ */
+
+int
+rtb_font_rasterize_queued(const struct rtb_font *font)
+{
+	struct rtb_font_manager *fm = font->fm;
+	texture_font_t *txfont = font->txfont;
+	uint64_t now, deadline;
+
+	send_queued(fm, txfont);
+
+	if (fm->glyph_policy == RTB_GLYPHS_WAIT) {
+		deadline = uv_hrtime() + fm->glyph_wait_ms * UINT64_C(1000000);
+
+		uv_mutex_lock(&fm->glyph_lock);
+		while (font_rendering(fm, txfont) && (now = uv_hrtime()) < deadline)
+			uv_cond_timedwait(&fm->glyph_rendered, &fm->glyph_lock,
+					deadline - now);
+		uv_mutex_unlock(&fm->glyph_lock);
+	}
+
+	land_jobs(fm);
+	return txfont->pending ? -1 : 0;
+}
+
+void
+rtb_font_manager_wait_for_glyphs(struct rtb_font_manager *fm,
+		struct rtb_glyph_waiter *waiter)
+{
+	if (waiter->waiting)
+		return;
+
+	waiter->waiting = 1;
+	waiter->serial  = fm->glyph_serial;
+	TAILQ_INSERT_TAIL(&fm->glyph_waiters, waiter, entry);
+}
+
+void
+rtb_font_manager_stop_waiting(struct rtb_font_manager *fm,
+		struct rtb_glyph_waiter *waiter)
+{
+	if (!waiter->waiting)
+		return;
+
+	waiter->waiting = 0;
+	TAILQ_REMOVE(&fm->glyph_waiters, waiter, entry);
+}
+
+void
+rtb_font_manager_land_glyphs(struct rtb_font_manager *fm)
+{
+	struct rtb_glyph_waiter *waiter;
+
+	land_jobs(fm);
+
+	if (!fm->glyphs_landed)
+		return;
+
+	fm->glyphs_landed = 0;
+	fm->glyph_serial++;
+
+	/* waiters which are still missing glyphs wait again, behind
+	 * everyone who was already waiting. */
+	while ((waiter = TAILQ_FIRST(&fm->glyph_waiters))
+			&& waiter->serial != fm->glyph_serial) {
+		rtb_font_manager_stop_waiting(fm, waiter);
+		waiter->glyphs_landed(waiter);
+	}
+}
+
+/**
+ * glyph cache
+ */
+
+int
+rtb_font_manager_set_glyph_cache_dir(struct rtb_font_manager *fm,
+		const char *dir)
+{
+	char *copy = NULL;
+
+	if (dir && !(copy = strdup(dir)))
+		return -1;
+
+	free(fm->glyph_cache_dir);
+	fm->glyph_cache_dir = copy;
+	return 0;
+}
+
+/**
+ * emebedded font
+ */
+
+int
+rtb_font_manager_load_embedded_font(struct rtb_font_manager *fm,
+		struct rtb_font *font, int pt_size, const void *base, size_t size)
+{
+	if (load_font(fm, font, pt_size, base, size, NULL))
+		return -1;
+
 	TAILQ_INSERT_TAIL(&fm->managed_fonts, font, manager_entry);
 	return 0;
 }
@@ -94,8 +559,9 @@ rtb_font_manager_load_embedded_font(struct rtb_font_manager *fm,
 void
 rtb_font_manager_free_embedded_font(struct rtb_font *font)
 {
+	rtb_text_cache_forget_font(font->fm->text_cache, font);
 	TAILQ_REMOVE(&font->fm->managed_fonts, font, manager_entry);
-	texture_font_delete(font->txfont);
+	release_txfont(font);
 
 	font->manager_entry.tqe_next = NULL;
 	font->manager_entry.tqe_prev = NULL;
@@ -109,47 +575,47 @@ int
 rtb_font_manager_load_external_font(struct rtb_font_manager *fm,
 		struct rtb_external_font *font, int pt_size, const char *path)
 {
-	font->txfont = texture_font_new_from_file(fm->atlas, pt_size, path);
-	if (!font->txfont) {
+	if (load_font(fm, RTB_FONT(font), pt_size, NULL, 0, path)) {
 		ERR("couldn't load font \"%s\"\n", path);
 		return -1;
 	}
 
 	font->path = strdup(path);
-	font->size = pt_size;
-	font->fm   = fm;
-
-	init_font(RTB_FONT(font), fm->cache_glyphs);
 	return 0;
 }
 
 void
 rtb_font_manager_free_external_font(struct rtb_external_font *font)
 {
+	rtb_text_cache_forget_font(RTB_FONT(font)->fm->text_cache, RTB_FONT(font));
 	free(font->path);
-	texture_font_delete(font->txfont);
+	release_txfont(RTB_FONT(font));
 }
 
 int
 rtb_font_manager_init(struct rtb_font_manager *fm, int dpi_x, int dpi_y)
 {
-	if (!rtb_shader_create(RTB_SHADER(&fm->shader),
-				TEXT_VERT_SHADER, NULL, TEXT_FRAG_SHADER)) {
+	if (init_shader(&fm->shader, TEXT_VERT_SHADER, TEXT_FRAG_SHADER)) {
 		ERR("couldn't compile text shader.\n");
 		goto err_shader;
 	}
 
-#define CACHE_UNIFORM(UNIFORM) \
-	fm->shader.UNIFORM = glGetUniformLocation(fm->shader.program, #UNIFORM)
-
-	CACHE_UNIFORM(offset);
-	CACHE_UNIFORM(texture);
-	CACHE_UNIFORM(atlas_pixel);
-	CACHE_UNIFORM(gamma);
-
-#undef CACHE_UNIFORM
-
 	fm->cache_glyphs = NULL;
+	fm->raster = RTB_FONT_RASTER_BITMAP;
+	fm->sdf_atlas = NULL;
+	LIST_INIT(&fm->sdf_faces);
+
+	fm->glyph_cache_dir = rtb_glyph_cache_default_dir();
+
+	fm->window        = NULL;
+	fm->glyph_policy  = RTB_GLYPHS_WAIT;
+	fm->glyph_wait_ms = RTB_FONT_GLYPH_WAIT_MS;
+	fm->glyph_serial  = 0;
+	fm->glyphs_landed = 0;
+	TAILQ_INIT(&fm->glyph_jobs);
+	TAILQ_INIT(&fm->glyph_waiters);
+	uv_mutex_init(&fm->glyph_lock);
+	uv_cond_init(&fm->glyph_rendered);
 
 #if defined(FT_CONFIG_OPTION_SUBPIXEL_RENDERING) || (FREETYPE_MAJOR > 2 || (FREETYPE_MAJOR == 2 && (FREETYPE_MINOR > 8 || (FREETYPE_MINOR == 8 && FREETYPE_PATCH >= 1))))
 	fm->atlas = texture_atlas_new(512, 512, 3, dpi_x, dpi_y);
@@ -157,9 +623,21 @@ rtb_font_manager_init(struct rtb_font_manager *fm, int dpi_x, int dpi_y)
 	fm->atlas = texture_atlas_new(512, 512, 1, dpi_x, dpi_y);
 #endif
 
+	fm->text_cache = rtb_text_cache_new(fm);
+	if (!fm->text_cache) {
+		ERR("couldn't allocate text cache.\n");
+		goto err_text_cache;
+	}
+
 	TAILQ_INIT(&fm->managed_fonts);
 	return 0;
 
+err_text_cache:
+	free(fm->glyph_cache_dir);
+	uv_cond_destroy(&fm->glyph_rendered);
+	uv_mutex_destroy(&fm->glyph_lock);
+	texture_atlas_delete(fm->atlas);
+	rtb_shader_free(RTB_SHADER(&fm->shader));
 err_shader:
 	return -1;
 }
@@ -169,11 +647,25 @@ rtb_font_manager_fini(struct rtb_font_manager *fm)
 {
 	struct rtb_font *font;
 
+	fini_jobs(fm);
+	rtb_text_cache_free(fm->text_cache);
+
 	TAILQ_FOREACH(font, &fm->managed_fonts, manager_entry)
 		/* FIXME: free path of external font? */
-		texture_font_delete(font->txfont);
+		release_txfont(font);
+
+	/* external fonts aren't managed, and might still be holding on to
+	 * their faces. */
+	while (!LIST_EMPTY(&fm->sdf_faces))
+		free_sdf_face(LIST_FIRST(&fm->sdf_faces));
+
+	if (fm->sdf_atlas) {
+		texture_atlas_delete(fm->sdf_atlas);
+		rtb_shader_free(RTB_SHADER(&fm->sdf_shader));
+	}
 
 	texture_atlas_delete(fm->atlas);
+	free(fm->glyph_cache_dir);
 
 	rtb_shader_free(RTB_SHADER(&fm->shader));
 }
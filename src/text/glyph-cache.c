@@ -0,0 +1,371 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <uv.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir(path, mode) _mkdir(path)
+#endif
+
+#include <rtb_private/glyph-cache.h>
+#include <rtb_private/mapped-file.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#define ERR(...) fprintf(stderr, "rutabaga: " __VA_ARGS__)
+
+/* "rtbg", which also catches files written on a machine of the other
+ * byte order. bump the version whenever the layout of the key or of a
+ * packed batch changes. */
+#define CACHE_MAGIC   0x72746267
+#define CACHE_VERSION 1
+
+#define FNV_OFFSET UINT64_C(0xcbf29ce484222325)
+#define FNV_PRIME  UINT64_C(0x100000001b3)
+
+/* the start of every cache file, followed by the packed batch. it's
+ * compared whole, so it's zeroed before it's filled in, and it's a
+ * multiple of 8 bytes so that the batch after it stays aligned. */
+struct cache_key {
+	uint32_t magic;
+	uint32_t version;
+
+	/* rasterisation changes between FreeType releases. */
+	uint32_t freetype;
+	uint32_t depth;
+
+	/* the face's bytes, or for a face in a file, its path, size and
+	 * modification time. */
+	uint64_t face;
+	uint64_t charcodes;
+
+	float size;
+	float outline_thickness;
+	int32_t dpi_x;
+	int32_t dpi_y;
+
+	int32_t rendermode;
+	int32_t hinting;
+	int32_t filtering;
+	int32_t outline_type;
+
+	uint8_t lcd_weights[8];
+};
+
+/**
+ * keys
+ */
+
+/* the FreeType we're running against, which isn't necessarily the one
+ * we were built against. 0 if it couldn't be asked. */
+static uv_once_t freetype_once = UV_ONCE_INIT;
+static uint32_t freetype_version;
+
+static void
+query_freetype_version(void)
+{
+	FT_Library library;
+	FT_Int major, minor, patch;
+
+	if (FT_Init_FreeType(&library))
+		return;
+
+	FT_Library_Version(library, &major, &minor, &patch);
+	FT_Done_FreeType(library);
+
+	freetype_version = (major << 16) | (minor << 8) | patch;
+}
+
+/* FNV-1a, a word at a time. */
+static uint64_t
+hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+	const unsigned char *p = data;
+	uint64_t word;
+
+	for (; size >= sizeof(word); p += sizeof(word), size -= sizeof(word)) {
+		memcpy(&word, p, sizeof(word));
+		hash = (hash ^ word) * FNV_PRIME;
+		hash ^= hash >> 32;
+	}
+
+	for (; size; p++, size--)
+		hash = (hash ^ *p) * FNV_PRIME;
+
+	return hash;
+}
+
+static int
+hash_face(const texture_font_t *txfont, uint64_t *hash)
+{
+	struct stat st;
+	int64_t stamp[2];
+
+	if (txfont->location == TEXTURE_FONT_MEMORY) {
+		*hash = hash_bytes(FNV_OFFSET,
+				txfont->memory.base, txfont->memory.size);
+		return 0;
+	}
+
+	if (stat(txfont->filename, &st))
+		return -1;
+
+	stamp[0] = st.st_size;
+	stamp[1] = st.st_mtime;
+
+	*hash = hash_bytes(FNV_OFFSET, txfont->filename,
+			strlen(txfont->filename));
+	*hash = hash_bytes(*hash, stamp, sizeof(stamp));
+	return 0;
+}
+
+static size_t
+charcodes_len(const rtb_utf32_t *charcodes)
+{
+	size_t len;
+	for (len = 0; charcodes[len]; len++);
+
+	return len;
+}
+
+static int
+make_key(struct cache_key *key, const texture_font_t *txfont,
+		const rtb_utf32_t *charcodes)
+{
+	memset(key, 0, sizeof(*key));
+
+	uv_once(&freetype_once, query_freetype_version);
+	if (!freetype_version || hash_face(txfont, &key->face))
+		return -1;
+
+	key->magic    = CACHE_MAGIC;
+	key->version  = CACHE_VERSION;
+	key->freetype = freetype_version;
+	key->depth    = txfont->atlas->depth;
+
+	key->charcodes = hash_bytes(FNV_OFFSET, charcodes,
+			charcodes_len(charcodes) * sizeof(*charcodes));
+
+	key->size  = txfont->size;
+	key->dpi_x = txfont->atlas->dpi.x;
+	key->dpi_y = txfont->atlas->dpi.y;
+
+	key->rendermode   = txfont->rendermode;
+	key->hinting      = txfont->hinting;
+	key->filtering    = txfont->filtering;
+	key->outline_type = txfont->outline_type;
+	key->outline_thickness = txfont->outline_thickness;
+
+	memcpy(key->lcd_weights, txfont->lcd_weights,
+			sizeof(txfont->lcd_weights));
+
+	return 0;
+}
+
+/* "<dir>/<hash of the key>.glyphs", to be freed with free(). */
+static char *
+key_path(const char *dir, const struct cache_key *key)
+{
+	size_t size = strlen(dir) + 32;
+	char *path;
+
+	if (!(path = malloc(size)))
+		return NULL;
+
+	snprintf(path, size, "%s/%016" PRIx64 ".glyphs", dir,
+			hash_bytes(FNV_OFFSET, key, sizeof(*key)));
+
+	return path;
+}
+
+/**
+ * directories
+ */
+
+static char *
+join(const char *base, const char *sub)
+{
+	size_t size;
+	char *path;
+
+	if (!base || !*base)
+		return NULL;
+
+	size = strlen(base) + strlen(sub) + 2;
+	if (!(path = malloc(size)))
+		return NULL;
+
+	snprintf(path, size, "%s/%s", base, sub);
+	return path;
+}
+
+/* makes `dir` and whichever of its parents don't exist yet. */
+static int
+make_dirs(const char *dir)
+{
+	char *path, *p;
+	int err;
+
+	if (!(path = strdup(dir)))
+		return -1;
+
+	/* skips the root (or the drive). */
+	for (p = path + 1; *p; p++) {
+		if (*p != '/' && *p != '\\')
+			continue;
+
+		*p = '\0';
+		mkdir(path, 0755);
+		*p = '/';
+	}
+
+	err = mkdir(path, 0755) && errno != EEXIST;
+	free(path);
+
+	return err ? -1 : 0;
+}
+
+/**
+ * public API
+ */
+
+char *
+rtb_glyph_cache_default_dir(void)
+{
+#if defined(_WIN32)
+	return join(getenv("LOCALAPPDATA"), "rutabaga/glyphs");
+#elif defined(__APPLE__)
+	return join(getenv("HOME"), "Library/Caches/rutabaga/glyphs");
+#else
+	const char *xdg = getenv("XDG_CACHE_HOME");
+
+	if (xdg && *xdg)
+		return join(xdg, "rutabaga/glyphs");
+
+	return join(getenv("HOME"), ".cache/rutabaga/glyphs");
+#endif
+}
+
+int
+rtb_glyph_cache_load(const char *dir, texture_font_t *txfont,
+		const rtb_utf32_t *charcodes)
+{
+	struct rtb_mapped_file file;
+	struct cache_key key;
+	char *path;
+	int ret = -1;
+
+	if (make_key(&key, txfont, charcodes) || !(path = key_path(dir, &key)))
+		return -1;
+
+	if (rtb_mapped_file_open(&file, path))
+		goto err_open;
+
+	/* a stale file, or a collision. */
+	if (file.size < sizeof(key) || memcmp(file.data, &key, sizeof(key)))
+		goto out;
+
+	if (texture_font_load_packed(txfont,
+				(const char *) file.data + sizeof(key),
+				file.size - sizeof(key)) < 0) {
+		ERR("glyph cache \"%s\" is corrupt\n", path);
+		goto out;
+	}
+
+	ret = 0;
+
+out:
+	rtb_mapped_file_close(&file);
+err_open:
+	free(path);
+	return ret;
+}
+
+int
+rtb_glyph_cache_store(const char *dir, texture_font_t *txfont,
+		const rtb_utf32_t *charcodes, const texture_glyph_batch_t *batch)
+{
+	struct cache_key key;
+	char *path, *tmp;
+	void *packed;
+	size_t size;
+	int ret = -1;
+	FILE *f;
+
+	if (texture_glyph_batch_count(batch) != charcodes_len(charcodes)
+			|| make_key(&key, txfont, charcodes))
+		return -1;
+
+	if (!(packed = texture_glyph_batch_pack(batch, &size)))
+		return -1;
+
+	if (!(path = key_path(dir, &key)))
+		goto err_path;
+
+	if (!(tmp = malloc(strlen(path) + 16)))
+		goto err_tmp;
+
+	/* written to a file of our own, and renamed into place once it's
+	 * all there, so that nobody ever maps half a file. */
+	sprintf(tmp, "%s.%lu", path, (unsigned long) uv_os_getpid());
+
+	if (make_dirs(dir) || !(f = fopen(tmp, "wb")))
+		goto out;
+
+	if (fwrite(&key, sizeof(key), 1, f) != 1
+			|| fwrite(packed, size, 1, f) != 1) {
+		fclose(f);
+		goto err_write;
+	}
+
+	/* on windows, rename() won't replace a file, in which case another
+	 * process has already written it. */
+	if (fclose(f) || rename(tmp, path))
+		goto err_write;
+
+	ret = 0;
+	goto out;
+
+err_write:
+	remove(tmp);
+out:
+	free(tmp);
+err_tmp:
+	free(path);
+err_path:
+	free(packed);
+	return ret;
+}
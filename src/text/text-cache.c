@@ -0,0 +1,380 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/font-manager.h>
+#include <rutabaga/text-object.h>
+#include <rutabaga/text-cache.h>
+
+#include "freetype-gl/vertex-buffer.h"
+
+#define MIN_BUCKETS 64
+
+/**
+ * hashing
+ */
+
+static uint32_t
+hash_run(const struct rtb_font *font, const rtb_utf8_t *text,
+		float line_height_multiplier)
+{
+	uintptr_t fontp = (uintptr_t) font;
+	uint32_t hash, lhm;
+	unsigned i;
+
+	memcpy(&lhm, &line_height_multiplier, sizeof(lhm));
+
+	/* FNV-1a over the text, then the font and multiplier. */
+	for (hash = 2166136261u; *text; text++)
+		hash = (hash ^ (uint8_t) *text) * 16777619u;
+
+	for (i = 0; i < sizeof(fontp); i++, fontp >>= 8)
+		hash = (hash ^ (fontp & 0xFF)) * 16777619u;
+
+	for (i = 0; i < sizeof(lhm); i++, lhm >>= 8)
+		hash = (hash ^ (lhm & 0xFF)) * 16777619u;
+
+	return hash;
+}
+
+static struct rtb_text_run_bucket *
+bucket_for(struct rtb_text_cache *self, uint32_t hash)
+{
+	return &self->buckets[hash & (self->nbuckets - 1)];
+}
+
+static void
+grow_buckets(struct rtb_text_cache *self)
+{
+	struct rtb_text_run_bucket *old, *bucket;
+	struct rtb_text_run *run;
+	unsigned i, nold;
+
+	old  = self->buckets;
+	nold = self->nbuckets;
+
+	bucket = calloc(nold * 2, sizeof(*bucket));
+	if (!bucket)
+		return;
+
+	self->buckets  = bucket;
+	self->nbuckets = nold * 2;
+
+	for (i = 0; i < self->nbuckets; i++)
+		LIST_INIT(&self->buckets[i]);
+
+	for (i = 0; i < nold; i++) {
+		while ((run = LIST_FIRST(&old[i]))) {
+			LIST_REMOVE(run, bucket_entry);
+			LIST_INSERT_HEAD(bucket_for(self, run->hash), run,
+					bucket_entry);
+		}
+	}
+
+	free(old);
+}
+
+/**
+ * runs
+ */
+
+static size_t
+vector_bytes(const vector_t *v)
+{
+	return v->capacity * v->item_size;
+}
+
+static size_t
+run_bytes(struct rtb_text_run *run)
+{
+	struct rtb_text_object *tobj = RTB_UPCAST(run, rtb_text_object);
+	vertex_buffer_t *vb = tobj->vertices;
+
+	return vb->GPU_vsize + vb->GPU_isize
+		+ vector_bytes(vb->vertices)
+		+ vector_bytes(vb->indices)
+		+ vector_bytes(vb->items)
+		+ vector_bytes(tobj->glyphs);
+}
+
+static struct rtb_text_run *
+run_new(struct rtb_text_cache *self, struct rtb_font *font,
+		const rtb_utf8_t *text, float line_height_multiplier,
+		uint32_t hash)
+{
+	struct rtb_text_run *run;
+
+	run = calloc(1, sizeof(*run));
+	if (!run)
+		goto err_alloc;
+
+	if (rtb_text_object_init(RTB_UPCAST(run, rtb_text_object), self->fm))
+		goto err_init;
+
+	if (rtb_text_object_update(RTB_UPCAST(run, rtb_text_object),
+				font, text, line_height_multiplier))
+		goto err_update;
+
+	run->text = strdup(text);
+	if (!run->text)
+		goto err_update;
+
+	run->cache = self;
+	run->line_height_multiplier = line_height_multiplier;
+	run->hash  = hash;
+	run->bytes = run_bytes(run);
+
+	return run;
+
+err_update:
+	rtb_text_object_fini(RTB_UPCAST(run, rtb_text_object));
+err_init:
+	free(run);
+err_alloc:
+	return NULL;
+}
+
+static void
+run_free(struct rtb_text_run *run)
+{
+	rtb_text_object_fini(RTB_UPCAST(run, rtb_text_object));
+	free(run->text);
+	free(run);
+}
+
+/* takes an unused run out of the cache and frees it. */
+static void
+evict(struct rtb_text_cache *self, struct rtb_text_run *run)
+{
+	TAILQ_REMOVE(&self->unused, run, unused_entry);
+	LIST_REMOVE(run, bucket_entry);
+
+	self->nunused--;
+	self->unused_bytes -= run->bytes;
+
+	self->stats.runs--;
+	self->stats.bytes -= run->bytes;
+	self->stats.evictions++;
+
+	run_free(run);
+}
+
+/**
+ * public API
+ */
+
+struct rtb_text_run *
+rtb_text_cache_get(struct rtb_text_cache *self, struct rtb_font *font,
+		const rtb_utf8_t *text, float line_height_multiplier)
+{
+	struct rtb_text_run *run;
+	uint32_t hash;
+
+	if (!font || !text)
+		return NULL;
+
+	hash = hash_run(font, text, line_height_multiplier);
+
+	LIST_FOREACH(run, bucket_for(self, hash), bucket_entry) {
+		if (run->hash != hash
+				|| RTB_UPCAST(run, rtb_text_object)->font != font
+				|| run->line_height_multiplier != line_height_multiplier
+				|| strcmp(run->text, text))
+			continue;
+
+		self->stats.hits++;
+
+		if (!run->refcount) {
+			TAILQ_REMOVE(&self->unused, run, unused_entry);
+			self->nunused--;
+			self->unused_bytes -= run->bytes;
+		} else
+			self->stats.bytes_saved += run->bytes;
+
+		run->refcount++;
+
+		/* laid out with placeholders, which have all landed since. */
+		if (RTB_UPCAST(run, rtb_text_object)->pending
+				&& !font->txfont->pending)
+			rtb_text_run_refresh(run);
+
+		return run;
+	}
+
+	self->stats.misses++;
+
+	run = run_new(self, font, text, line_height_multiplier, hash);
+	if (!run)
+		return NULL;
+
+	run->refcount = 1;
+	LIST_INSERT_HEAD(bucket_for(self, hash), run, bucket_entry);
+
+	self->stats.runs++;
+	self->stats.bytes += run->bytes;
+
+	if (self->stats.runs > self->nbuckets)
+		grow_buckets(self);
+
+	return run;
+}
+
+void
+rtb_text_run_release(struct rtb_text_run *run)
+{
+	struct rtb_text_cache *self = run->cache;
+
+	assert(run->refcount > 0);
+
+	if (!self) {
+		/* the cache went away while we were still in use. */
+		if (!--run->refcount)
+			run_free(run);
+		return;
+	}
+
+	if (--run->refcount) {
+		self->stats.bytes_saved -= run->bytes;
+		return;
+	}
+
+	TAILQ_INSERT_TAIL(&self->unused, run, unused_entry);
+	self->nunused++;
+	self->unused_bytes += run->bytes;
+
+	while (self->nunused > self->max_unused
+			|| self->unused_bytes > self->max_unused_bytes)
+		evict(self, TAILQ_FIRST(&self->unused));
+}
+
+void
+rtb_text_run_refresh(struct rtb_text_run *run)
+{
+	struct rtb_text_object *tobj = RTB_UPCAST(run, rtb_text_object);
+	struct rtb_text_cache *self = run->cache;
+	size_t old_bytes = run->bytes;
+
+	if (!tobj->pending || rtb_text_object_update(tobj, tobj->font,
+				run->text, run->line_height_multiplier))
+		return;
+
+	run->bytes = run_bytes(run);
+
+	if (!self)
+		return;
+
+	/* the counts are unsigned, and wrap around back to the right
+	 * answer if the run got smaller. */
+	self->stats.bytes += run->bytes - old_bytes;
+
+	if (run->refcount)
+		self->stats.bytes_saved +=
+			(run->refcount - 1) * (run->bytes - old_bytes);
+	else
+		self->unused_bytes += run->bytes - old_bytes;
+}
+
+void
+rtb_text_cache_forget_font(struct rtb_text_cache *self,
+		const struct rtb_font *font)
+{
+	struct rtb_text_run *run, *next;
+
+	for (run = TAILQ_FIRST(&self->unused); run; run = next) {
+		next = TAILQ_NEXT(run, unused_entry);
+
+		if (RTB_UPCAST(run, rtb_text_object)->font == font)
+			evict(self, run);
+	}
+}
+
+float
+rtb_text_cache_hit_rate(const struct rtb_text_cache *self)
+{
+	unsigned long lookups = self->stats.hits + self->stats.misses;
+
+	if (!lookups)
+		return 0.f;
+
+	return (float) self->stats.hits / (float) lookups;
+}
+
+struct rtb_text_cache *
+rtb_text_cache_new(struct rtb_font_manager *fm)
+{
+	struct rtb_text_cache *self;
+	unsigned i;
+
+	self = calloc(1, sizeof(*self));
+	if (!self)
+		goto err_alloc;
+
+	self->buckets = calloc(MIN_BUCKETS, sizeof(*self->buckets));
+	if (!self->buckets)
+		goto err_buckets;
+
+	self->nbuckets = MIN_BUCKETS;
+	for (i = 0; i < self->nbuckets; i++)
+		LIST_INIT(&self->buckets[i]);
+
+	self->fm = fm;
+	self->max_unused = RTB_TEXT_CACHE_MAX_UNUSED;
+	self->max_unused_bytes = RTB_TEXT_CACHE_MAX_UNUSED_BYTES;
+	TAILQ_INIT(&self->unused);
+
+	return self;
+
+err_buckets:
+	free(self);
+err_alloc:
+	return NULL;
+}
+
+void
+rtb_text_cache_free(struct rtb_text_cache *self)
+{
+	struct rtb_text_run *run;
+	unsigned i;
+
+	for (i = 0; i < self->nbuckets; i++) {
+		while ((run = LIST_FIRST(&self->buckets[i]))) {
+			LIST_REMOVE(run, bucket_entry);
+
+			if (run->refcount)
+				run->cache = NULL;
+			else
+				run_free(run);
+		}
+	}
+
+	free(self->buckets);
+	free(self);
+}
@@ -25,6 +25,8 @@
  */
 
 #include <stdlib.h>
+#include <math.h>
+#include <string.h>
 
 #include <rutabaga/rutabaga.h>
 #include <rutabaga/element.h>
@@ -47,6 +49,115 @@ struct text_vertex {
 	float shift;
 };
 
+struct text_glyph {
+	rtb_utf32_t codepoint;
+	texture_glyph_t *glyph;
+
+	/* pen position, after kerning. */
+	float x;
+};
+
+static const GLuint glyph_indices[6] = {0, 1, 2, 0, 2, 3};
+
+/**
+ * layout
+ */
+
+/* decodes the next codepoint in `*text` and moves `*text` past it.
+ * malformed sequences come out as U+FFFD. returns 0 at the end of the
+ * string. */
+static int
+next_codepoint(const rtb_utf8_t **text, rtb_utf32_t *codepoint)
+{
+	uint32_t state, prev_state;
+	const rtb_utf8_t *p;
+
+	for (p = *text, state = UTF8_ACCEPT; *p; p++) {
+		prev_state = state;
+
+		switch (u8dec(&state, codepoint, *p)) {
+		case UTF8_ACCEPT:
+			*text = p + 1;
+			return 1;
+
+		case UTF8_REJECT:
+			/* the byte that broke the sequence might start the next
+			 * one. */
+			*text = (prev_state != UTF8_ACCEPT) ? p : p + 1;
+			*codepoint = 0xFFFD;
+			return 1;
+
+		default:
+			continue;
+		}
+	}
+
+	*text = p;
+	return 0;
+}
+
+static void
+glyph_vertices(struct text_vertex *v, const struct rtb_font *font,
+		const texture_glyph_t *glyph, float x, float y)
+{
+	float x0, y0, x1, y1, x0_shift, x1_shift;
+
+	x0 = x  + glyph->offset_x * font->scale;
+	y0 = y  - glyph->offset_y * font->scale;
+	x1 = x0 + glyph->width  * font->scale;
+	y1 = y0 + glyph->height * font->scale;
+
+	/* bitmap glyphs are snapped to the pixel grid, and the shader moves
+	 * them the rest of the way with subpixel rendering. distance fields
+	 * can go anywhere. */
+	if (font->txfont->rendermode == RENDER_SIGNED_DISTANCE_FIELD) {
+		x0_shift = x1_shift = 0.f;
+	} else {
+		x0_shift = x0 - floorf(x0);
+		x1_shift = x1 - floorf(x1);
+
+		x0 = floorf(x0);
+		x1 = floorf(x1);
+	}
+
+	v[0] = (struct text_vertex) {x0, y0, glyph->s0, glyph->t0, x0_shift};
+	v[1] = (struct text_vertex) {x0, y1, glyph->s0, glyph->t1, x0_shift};
+	v[2] = (struct text_vertex) {x1, y1, glyph->s1, glyph->t1, x1_shift};
+	v[3] = (struct text_vertex) {x1, y0, glyph->s1, glyph->t0, x1_shift};
+}
+
+/* adds kerning against the previous glyph to the pen position, and
+ * returns where the pen ends up after the glyph. */
+static float
+place_glyph(const struct rtb_font *font, struct text_glyph *g,
+		rtb_utf32_t prev_codepoint, float x)
+{
+	if (prev_codepoint)
+		x += texture_font_get_kerning(font->txfont,
+				prev_codepoint, g->codepoint) * font->scale;
+
+	g->x = x;
+	return x + g->glyph->advance_x * font->scale;
+}
+
+/* freetype-gl uploads through its own vertex array, and leaves no vertex
+ * array (or buffer) bound behind the tracker's back. */
+static void
+upload_vertices(struct rtb_text_object *self)
+{
+	struct rtb_window *win = self->fm->window;
+
+	vertex_buffer_upload(self->vertices);
+
+	if (win)
+		rtb_render_state_invalidate(&win->render_state,
+				RTB_RENDER_STATE_BUFFERS | RTB_RENDER_STATE_VERTEX_ARRAY);
+}
+
+/**
+ * public API
+ */
+
 int
 rtb_text_object_get_glyph_rect(struct rtb_text_object *self, int idx,
 		struct rtb_rect *rect)
@@ -79,14 +190,17 @@ rtb_text_object_count_glyphs(struct rtb_text_object *self)
 
 int
 rtb_text_object_update(struct rtb_text_object *self,
-		struct rtb_font *rfont, const rtb_utf8_t *text,
+		const struct rtb_font *rfont, const rtb_utf8_t *text,
 		float line_height_multiplier)
 {
-	float x, y, line_height, x0, y0, x1, y1, max_w;
-	rtb_utf32_t codepoint, prev_codepoint;
-	uint32_t state, prev_state;
+	struct text_vertex vertices[4];
+	float x, y, line_height, max_w;
+	rtb_utf32_t prev_codepoint;
+	const rtb_utf8_t *start;
+	struct text_glyph g;
 	texture_font_t *font;
 	unsigned lines;
+	int waited;
 
 	if (!rfont || !text)
 		return -1;
@@ -94,92 +208,269 @@ rtb_text_object_update(struct rtb_text_object *self,
 	font = rfont->txfont;
 	self->font = rfont;
 
+	start  = text;
+	waited = 0;
+
+relayout:
+	text = start;
+	self->pending = 0;
+
 	vertex_buffer_clear(self->vertices);
+	vector_clear(self->glyphs);
 
-	line_height = font->height * line_height_multiplier;
+	line_height = font->height * rfont->scale * line_height_multiplier;
 
 	x     = 0.f;
-	x1    = 0.f;
-	y     = ceilf(line_height / 2.f) - font->descender + 1.f;
+	y     = ceilf(line_height / 2.f) - font->descender * rfont->scale + 1.f;
 
 	max_w = 0.f;
 	lines = 1;
 
-	state = prev_state = UTF8_ACCEPT;
-	prev_codepoint = 0;
-
-	for (; *text; prev_state = state, text++) {
-		texture_glyph_t *glyph;
-		float s0, t0, s1, t1, x0_shift, x1_shift;
+	self->baseline = y;
+	self->spliceable = 1;
 
-		switch(u8dec(&state, &codepoint, *text)) {
-		case UTF8_ACCEPT:
-			break;
-
-		case UTF8_REJECT:
-			if (prev_state != UTF8_ACCEPT)
-				text--;
-
-			codepoint = 0xFFFD;
-			state = UTF8_ACCEPT;
-			break;
-
-		default:
-			continue;
-		}
+	prev_codepoint = 0;
 
-		if (codepoint == '\n') {
+	while (next_codepoint(&text, &g.codepoint)) {
+		if (g.codepoint == '\n') {
 			lines++;
 
 			if (x > max_w)
 				max_w = x;
 
 			y += line_height;
-			x = x1 = 0.f;
+			x = 0.f;
+
+			self->spliceable = 0;
 			continue;
 		}
 
-		glyph = texture_font_get_glyph(font, codepoint);
-		if (!glyph)
+		g.glyph = texture_font_queue_glyph(font, g.codepoint);
+		if (!g.glyph) {
+			self->spliceable = 0;
 			continue;
+		}
 
-		if (prev_codepoint)
-			x += texture_glyph_get_kerning(glyph, prev_codepoint);
+		if (g.glyph->pending)
+			self->pending++;
 
-		x0 = x  + glyph->offset_x;
-		y0 = y  - glyph->offset_y;
-		x1 = x0 + glyph->width;
-		y1 = y0 + glyph->height;
+		x = place_glyph(rfont, &g, prev_codepoint, x);
+		glyph_vertices(vertices, rfont, g.glyph, g.x, y);
 
-		s0 = glyph->s0;
-		s1 = glyph->s1;
+		vector_push_back(self->glyphs, &g);
+		vertex_buffer_push_back(self->vertices, vertices, 4,
+				(GLuint *) glyph_indices, 6);
 
-		t0 = glyph->t0;
-		t1 = glyph->t1;
+		prev_codepoint = g.codepoint;
+	}
 
-		x0_shift = x0 - floorf(x0);
-		x1_shift = x1 - floorf(x1);
+	/* if the placeholders' glyphs all land while we wait, lay the text
+	 * out again with them. */
+	if (self->pending && !waited) {
+		waited = 1;
 
-		x0 = floorf(x0);
-		x1 = floorf(x1);
+		if (!rtb_font_rasterize_queued(rfont))
+			goto relayout;
+	}
 
-		GLuint indices[6] = {0, 1, 2, 0, 2, 3};
-		struct text_vertex vertices[4] = {
-			{x0, y0, s0, t0, x0_shift},
-			{x0, y1, s0, t1, x0_shift},
-			{x1, y1, s1, t1, x1_shift},
-			{x1, y0, s1, t0, x1_shift}
-		};
+	upload_vertices(self);
+	self->h = line_height * lines;
+	self->w = roundf((x > max_w) ? x : max_w);
 
-		vertex_buffer_push_back(self->vertices, vertices, 4, indices, 6);
+	return 0;
+}
 
-		x += glyph->advance_x;
-		prev_codepoint = codepoint;
+int
+rtb_text_object_splice(struct rtb_text_object *self, int idx, int ndelete,
+		const rtb_utf8_t *text)
+{
+	size_t i, nglyphs, ninsert, new_nglyphs, dirty_end;
+	struct text_vertex *vertices;
+	struct text_glyph *glyphs, *g;
+	rtb_utf32_t prev_codepoint;
+	texture_font_t *font;
+	ivec4 item;
+	float x;
+
+	nglyphs = vector_size(self->glyphs);
+
+	if (!self->font || !self->spliceable || self->pending
+			|| idx < 0 || ndelete < 0 || (size_t) idx + ndelete > nglyphs)
+		return -1;
+
+	font = self->font->txfont;
+
+	/* worst case, every byte is a character. */
+	ninsert = strlen(text) + 1;
+	glyphs = malloc(ninsert * sizeof(*glyphs));
+	vertices = malloc(ninsert * sizeof(*vertices) * 4);
+
+	if (!glyphs || !vertices)
+		goto err;
+
+	/* the glyphs for the new text, positioned after the glyph before
+	 * `idx`. anything that would make the text stop being a single line
+	 * of one glyph per character needs a full update. */
+	if (idx > 0) {
+		g = (void *) vector_get(self->glyphs, idx - 1);
+		x = g->x + g->glyph->advance_x * self->font->scale;
+		prev_codepoint = g->codepoint;
+	} else {
+		x = 0.f;
+		prev_codepoint = 0;
 	}
 
-	vertex_buffer_upload(self->vertices);
-	self->h = line_height * lines;
-	self->w = roundf((x > max_w) ? x : max_w);
+	for (ninsert = 0; next_codepoint(&text, &glyphs[ninsert].codepoint);) {
+		g = &glyphs[ninsert];
+
+		if (g->codepoint == '\n'
+				|| !(g->glyph = texture_font_queue_glyph(font, g->codepoint))
+				|| g->glyph->pending)
+			goto err;
+
+		x = place_glyph(self->font, g, prev_codepoint, x);
+		glyph_vertices(&vertices[ninsert * 4], self->font, g->glyph, g->x,
+				self->baseline);
+
+		prev_codepoint = g->codepoint;
+		ninsert++;
+	}
+
+	/* splice the glyphs and their vertices in. */
+	if (ndelete) {
+		vector_erase_range(self->glyphs, idx, idx + ndelete);
+		vector_erase_range(self->vertices->vertices,
+				idx * 4, (idx + ndelete) * 4);
+	}
+
+	if (ninsert && (size_t) idx == vector_size(self->glyphs)) {
+		vector_push_back_data(self->glyphs, glyphs, ninsert);
+		vector_push_back_data(self->vertices->vertices,
+				vertices, ninsert * 4);
+	} else if (ninsert) {
+		vector_insert_data(self->glyphs, idx, glyphs, ninsert);
+		vector_insert_data(self->vertices->vertices,
+				idx * 4, vertices, ninsert * 4);
+	}
+
+	free(glyphs);
+	free(vertices);
+
+	/* every glyph uses the same 6 indices into its own 4 vertices, so
+	 * only the count has to change, at the end. */
+	new_nglyphs = nglyphs - ndelete + ninsert;
+
+	for (i = nglyphs; i < new_nglyphs; i++) {
+		GLuint indices[6];
+		int j;
+
+		for (j = 0; j < 6; j++)
+			indices[j] = glyph_indices[j] + (i * 4);
+
+		item = (ivec4) {{i * 4, 4, i * 6, 6}};
+
+		vertex_buffer_push_back_indices(self->vertices, indices, 6);
+		vector_push_back(self->vertices->items, &item);
+	}
+
+	if (new_nglyphs < nglyphs) {
+		vector_resize(self->vertices->indices, new_nglyphs * 6);
+		vector_resize(self->vertices->items, new_nglyphs);
+	}
+
+	/* move the rest of the line along. once a glyph ends up where it
+	 * already was, so does everything after it. */
+	for (i = idx + ninsert; i < new_nglyphs; i++) {
+		struct text_glyph moved;
+
+		g = (void *) vector_get(self->glyphs, i);
+		moved = *g;
+
+		x = place_glyph(self->font, &moved, prev_codepoint, x);
+		if (moved.x == g->x)
+			break;
+
+		*g = moved;
+		glyph_vertices((void *) vector_get(self->vertices->vertices, i * 4),
+				self->font, g->glyph, g->x, self->baseline);
+
+		prev_codepoint = g->codepoint;
+	}
+
+	/* if the glyph count changed, everything after the edit moved in
+	 * the buffer. */
+	dirty_end = (new_nglyphs != nglyphs) ? new_nglyphs : i;
+	vertex_buffer_invalidate_vertices(self->vertices,
+			idx * 4, dirty_end * 4);
+	upload_vertices(self);
+
+	if (i == new_nglyphs)
+		self->w = roundf(x);
+
+	return 0;
+
+err:
+	free(glyphs);
+	free(vertices);
+	return -1;
+}
+
+int
+rtb_text_object_draw_on_element(struct rtb_text_object *self,
+		struct rtb_element *on, float x, float y,
+		const struct rtb_rgb_color *color)
+{
+	struct rtb_render_context *ctx;
+	const struct text_vertex *src;
+	struct rtb_batch_vertex *v;
+	texture_atlas_t *atlas;
+	GLfloat clip[4], mode;
+	GLint scissor[4];
+	GLubyte rgba[4];
+	size_t i, n;
+
+	n = self->vertices->vertices->size;
+	if (!n)
+		return 0;
+
+	ctx   = rtb_render_get_context(on);
+	atlas = self->font->txfont->atlas;
+
+	if (self->font->txfont->rendermode == RENDER_SIGNED_DISTANCE_FIELD)
+		mode = RTB_BATCH_TEXT_SDF;
+	else
+		mode = (atlas->depth == 1) ? RTB_BATCH_TEXT : RTB_BATCH_TEXT_LCD;
+
+	rtb_render_get_scissor(on, scissor);
+	clip[0] = scissor[0];
+	clip[1] = scissor[1];
+	clip[2] = scissor[0] + scissor[2];
+	clip[3] = scissor[1] + scissor[3];
+
+	rgba[0] = lrintf(color->r * 255.f);
+	rgba[1] = lrintf(color->g * 255.f);
+	rgba[2] = lrintf(color->b * 255.f);
+	rgba[3] = lrintf(color->a * 255.f);
+
+	/* every glyph is a quad of four vertices. */
+	if (!(v = rtb_render_batch_add_quads(&ctx->batch, atlas->id, n / 4)))
+		return -1;
+
+	src = self->vertices->vertices->items;
+
+	for (i = 0; i < n; i++, v++, src++) {
+		v->x = src->x + x;
+		v->y = src->y + y;
+		v->s = src->s;
+		v->t = src->t;
+
+		memcpy(v->clip, clip, sizeof(clip));
+		memcpy(v->color, rgba, sizeof(rgba));
+
+		v->textured = mode;
+		v->text[0]  = src->shift;
+		v->text[1]  = self->font->lcd_gamma;
+	}
 
 	return 0;
 }
@@ -197,11 +488,15 @@ rtb_text_object_render(struct rtb_text_object *self,
 		return;
 
 	fm = self->fm;
-	shader = &fm->shader;
-	atlas = fm->atlas;
+	atlas = self->font->txfont->atlas;
+
+	if (self->font->txfont->rendermode == RENDER_SIGNED_DISTANCE_FIELD)
+		shader = &fm->sdf_shader;
+	else
+		shader = &fm->shader;
 
 	rtb_render_use_shader(ctx, RTB_SHADER(shader));
-	glBindTexture(GL_TEXTURE_2D, atlas->id);
+	rtb_render_state_bind_texture(ctx->state, atlas->id);
 
 	glUniform1i(shader->texture, 0);
 	glUniform1f(shader->gamma, self->font->lcd_gamma);
@@ -209,12 +504,55 @@ rtb_text_object_render(struct rtb_text_object *self,
 	glUniform3f(shader->atlas_pixel,
 			1.f / atlas->width, 1.f / atlas->height, atlas->depth);
 
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	rtb_render_state_blend_func(ctx->state,
+			GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	glUniform2f(shader->offset, x, y);
 	rtb_render_set_color(ctx,
 			color->r, color->g, color->b, color->a);
 	vertex_buffer_render(self->vertices, GL_TRIANGLES);
+
+	/* freetype-gl binds (and unbinds) its buffers and vertex array
+	 * behind our back. */
+	rtb_render_state_invalidate(ctx->state,
+			RTB_RENDER_STATE_BUFFERS | RTB_RENDER_STATE_VERTEX_ARRAY);
+}
+
+int
+rtb_text_object_init(struct rtb_text_object *self,
+		struct rtb_font_manager *fm)
+{
+	self->w = 0.f;
+	self->h = 0.f;
+
+	self->fm   = fm;
+	self->font = NULL;
+
+	self->baseline   = 0.f;
+	self->spliceable = 0;
+	self->pending    = 0;
+
+	self->vertices = vertex_buffer_new("vertex:2f,tex_coord:2f,subpixel_shift:1f");
+	if (!self->vertices)
+		goto err_vertices;
+
+	self->glyphs = vector_new(sizeof(struct text_glyph));
+	if (!self->glyphs)
+		goto err_glyphs;
+
+	return 0;
+
+err_glyphs:
+	vertex_buffer_delete(self->vertices);
+err_vertices:
+	return -1;
+}
+
+void
+rtb_text_object_fini(struct rtb_text_object *self)
+{
+	vertex_buffer_delete(self->vertices);
+	vector_delete(self->glyphs);
 }
 
 struct rtb_text_object *
@@ -222,8 +560,13 @@ rtb_text_object_new(struct rtb_font_manager *fm)
 {
 	struct rtb_text_object *self = calloc(1, sizeof(*self));
 
-	self->fm = fm;
-	self->vertices = vertex_buffer_new("vertex:2f,tex_coord:2f,subpixel_shift:1f");
+	if (!self)
+		return NULL;
+
+	if (rtb_text_object_init(self, fm)) {
+		free(self);
+		return NULL;
+	}
 
 	return self;
 }
@@ -231,6 +574,6 @@ rtb_text_object_new(struct rtb_font_manager *fm)
 void
 rtb_text_object_free(struct rtb_text_object *self)
 {
-	vertex_buffer_delete(self->vertices);
+	rtb_text_object_fini(self);
 	free(self);
 }
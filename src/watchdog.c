@@ -0,0 +1,359 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <uv.h>
+
+#include <rutabaga/rutabaga.h>
+#include <rutabaga/element.h>
+#include <rutabaga/window.h>
+#include <rutabaga/watchdog.h>
+
+#define ERR(...) fprintf(stderr, "rutabaga: " __VA_ARGS__)
+
+#define NS_TO_MS(ns) ((float) (ns) / 1000000.f)
+
+/* open-addressed, keyed on (element, call kind). once it's 3/4 full,
+ * new entries are dropped until the next frame. */
+#define TABLE_SIZE  512
+#define TABLE_LIMIT (TABLE_SIZE * 3 / 4)
+
+/* calls nested deeper than this are charged to the innermost one we
+ * are still tracking. */
+#define STACK_DEPTH 128
+
+static const char *call_names[RTB_WATCHDOG_CALL_KINDS] = {
+	[RTB_WATCHDOG_DRAW]    = "draw",
+	[RTB_WATCHDOG_REFLOW]  = "reflow",
+	[RTB_WATCHDOG_RESTYLE] = "restyle",
+	[RTB_WATCHDOG_LAYOUT]  = "layout"
+};
+
+const char *
+rtb_watchdog_call_name(rtb_watchdog_call_t kind)
+{
+	return call_names[kind];
+}
+
+/**
+ * entries
+ */
+
+static void
+describe_path(const struct rtb_element *elem, char *buf, size_t size)
+{
+	const struct rtb_element *iter;
+	unsigned int indices[32];
+	int depth, idx, n;
+
+	for (depth = 0; elem->parent && depth < 32;
+			elem = elem->parent, depth++) {
+		idx = 0;
+		TAILQ_FOREACH(iter, &elem->parent->children, child) {
+			if (iter == elem)
+				break;
+			idx++;
+		}
+
+		indices[depth] = idx;
+	}
+
+	if (!depth) {
+		snprintf(buf, size, "/");
+		return;
+	}
+
+	for (n = 0; depth--; ) {
+		n += snprintf(buf + n, size - n, "/%u", indices[depth]);
+		if ((size_t) n >= size)
+			return;
+	}
+}
+
+static struct rtb_watchdog_entry *
+lookup_entry(struct rtb_frame_watchdog *self,
+		const struct rtb_element *elem, rtb_watchdog_call_t kind)
+{
+	struct rtb_watchdog_entry *entry;
+	uintptr_t hash;
+	unsigned int i;
+
+	hash = ((uintptr_t) elem >> 4) * 31 + kind;
+
+	for (i = hash % TABLE_SIZE;; i = (i + 1) % TABLE_SIZE) {
+		entry = &self->table[i];
+
+		if (!entry->elem)
+			break;
+
+		if (entry->elem == elem && entry->kind == kind)
+			return entry;
+	}
+
+	if (self->nused >= TABLE_LIMIT)
+		return NULL;
+
+	self->nused++;
+
+	entry->elem = elem;
+	entry->kind = kind;
+	entry->self_ns = 0;
+	entry->calls = 0;
+
+	snprintf(entry->type, sizeof(entry->type), "%s",
+			elem->type ? elem->type->name : "(unknown)");
+	describe_path(elem, entry->path, sizeof(entry->path));
+
+	return entry;
+}
+
+static void
+reset_entries(struct rtb_frame_watchdog *self)
+{
+	memset(self->table, 0, TABLE_SIZE * sizeof(*self->table));
+	self->nused = 0;
+	self->dropped = 0;
+	self->between_ns = 0;
+}
+
+/**
+ * element hooks
+ */
+
+void
+rtb_frame_watchdog_enter(struct rtb_frame_watchdog *self)
+{
+	if (!self->table)
+		return;
+
+	if (self->depth < STACK_DEPTH) {
+		self->stack[self->depth].start = uv_hrtime();
+		self->stack[self->depth].child_ns = 0;
+	}
+
+	self->depth++;
+}
+
+void
+rtb_frame_watchdog_leave(struct rtb_frame_watchdog *self,
+		const struct rtb_element *elem, rtb_watchdog_call_t kind)
+{
+	struct rtb_watchdog_entry *entry;
+	uint64_t elapsed;
+
+	/* the watchdog was switched off (or off and on again) in the
+	 * middle of this call. */
+	if (!self->table || !self->depth)
+		return;
+
+	if (--self->depth >= STACK_DEPTH)
+		return;
+
+	elapsed = uv_hrtime() - self->stack[self->depth].start;
+
+	if (self->depth)
+		self->stack[self->depth - 1].child_ns += elapsed;
+	else if (!self->in_frame)
+		self->between_ns += elapsed;
+
+	entry = lookup_entry(self, elem, kind);
+	if (!entry) {
+		self->dropped++;
+		return;
+	}
+
+	entry->self_ns += elapsed - self->stack[self->depth].child_ns;
+	entry->calls++;
+}
+
+/**
+ * frames
+ */
+
+static int
+compare_entries(const void *_a, const void *_b)
+{
+	const struct rtb_watchdog_entry *a = _a, *b = _b;
+	return (a->self_ns < b->self_ns) - (a->self_ns > b->self_ns);
+}
+
+static void
+print_report(const struct rtb_watchdog_report *report)
+{
+	const struct rtb_watchdog_entry *entry;
+	unsigned int i;
+
+	ERR("frame took %.2fms (budget %.2fms). slowest elements:\n",
+			report->frame_ms, report->budget_ms);
+
+	for (i = 0; i < report->nentries; i++) {
+		entry = &report->entries[i];
+
+		ERR("  %7.2fms  %-7s x%-4u %s %s\n",
+				NS_TO_MS(entry->self_ns),
+				rtb_watchdog_call_name(entry->kind), entry->calls,
+				entry->type, entry->path);
+	}
+
+	if (report->dropped)
+		ERR("  (%u calls not attributed)\n", report->dropped);
+}
+
+static void
+report(struct rtb_frame_watchdog *self, struct rtb_window *win,
+		float frame_ms)
+{
+	struct rtb_watchdog_report report;
+	struct rtb_watchdog_entry *entries;
+	unsigned int i, n;
+
+	report.frame_ms = frame_ms;
+	report.budget_ms = self->budget_ms;
+	report.dropped = self->dropped;
+
+	/* sorting the table in place is fine, it's cleared right after. */
+	entries = self->table;
+	for (i = n = 0; i < TABLE_SIZE; i++)
+		if (entries[i].elem)
+			entries[n++] = entries[i];
+
+	qsort(entries, n, sizeof(*entries), compare_entries);
+
+	report.nentries = (n < RTB_WATCHDOG_REPORT_ENTRIES)
+		? n : RTB_WATCHDOG_REPORT_ENTRIES;
+	memcpy(report.entries, entries,
+			report.nentries * sizeof(*report.entries));
+
+	if (self->cb)
+		self->cb(win, &report, self->cb_ctx);
+	else
+		print_report(&report);
+}
+
+void
+rtb_frame_watchdog_frame_begin(struct rtb_frame_watchdog *self)
+{
+	if (!self->enabled)
+		return;
+
+	self->in_frame = 1;
+	self->frame_start = uv_hrtime();
+}
+
+void
+rtb_frame_watchdog_frame_cancel(struct rtb_frame_watchdog *self)
+{
+	if (!self->in_frame)
+		return;
+
+	/* nothing got drawn, so whatever happened so far gets carried over
+	 * into the next frame that is. */
+	self->between_ns += uv_hrtime() - self->frame_start;
+	self->in_frame = 0;
+}
+
+void
+rtb_frame_watchdog_frame_end(struct rtb_frame_watchdog *self,
+		struct rtb_window *win)
+{
+	float frame_ms;
+
+	if (!self->in_frame)
+		return;
+
+	self->in_frame = 0;
+
+	frame_ms = NS_TO_MS(uv_hrtime() - self->frame_start + self->between_ns);
+	if (frame_ms > self->budget_ms)
+		report(self, win, frame_ms);
+
+	reset_entries(self);
+}
+
+/**
+ * public API
+ */
+
+int
+rtb_frame_watchdog_set_budget(struct rtb_frame_watchdog *self,
+		float budget_ms)
+{
+	if (budget_ms <= 0.f) {
+		rtb_frame_watchdog_fini(self);
+		return 0;
+	}
+
+	if (!self->table) {
+		self->table = calloc(TABLE_SIZE, sizeof(*self->table));
+		self->stack = calloc(STACK_DEPTH, sizeof(*self->stack));
+
+		if (!self->table || !self->stack) {
+			rtb_frame_watchdog_fini(self);
+			return -1;
+		}
+
+		reset_entries(self);
+		self->depth = 0;
+	}
+
+	self->budget_ms = budget_ms;
+	self->enabled = 1;
+	return 0;
+}
+
+void
+rtb_frame_watchdog_set_callback(struct rtb_frame_watchdog *self,
+		rtb_watchdog_cb_t cb, void *ctx)
+{
+	self->cb = cb;
+	self->cb_ctx = ctx;
+}
+
+/**
+ * lifecycle
+ */
+
+void
+rtb_frame_watchdog_init(struct rtb_frame_watchdog *self)
+{
+	memset(self, 0, sizeof(*self));
+}
+
+void
+rtb_frame_watchdog_fini(struct rtb_frame_watchdog *self)
+{
+	self->enabled = 0;
+	self->in_frame = 0;
+
+	free(self->stack);
+	free(self->table);
+
+	self->stack = NULL;
+	self->table = NULL;
+}
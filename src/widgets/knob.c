@@ -105,7 +105,8 @@ restyle(struct rtb_element *elem)
 	prop = rtb_style_query_prop(elem,
 			"-rtb-knob-rotor", RTB_STYLE_PROP_TEXTURE, 0);
 	if (prop &&
-			!rtb_stylequad_set_background_image(&self->rotor, &prop->texture))
+			!rtb_stylequad_set_background_image(&self->rotor,
+				elem->window, &prop->texture))
 		rtb_elem_mark_dirty(elem);
 }
 
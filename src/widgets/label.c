@@ -26,6 +26,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 
 #include <rutabaga/rutabaga.h>
@@ -33,21 +34,129 @@
 #include <rutabaga/window.h>
 #include <rutabaga/render.h>
 #include <rutabaga/style.h>
+#include <rutabaga/text-cache.h>
 
 #include <rutabaga/widgets/label.h>
 
+#include "rtb_private/utf8.h"
+
 #define SELF_FROM(elem) \
 	struct rtb_label *self = RTB_ELEMENT_AS(elem, rtb_label)
 
 static struct rtb_element_implementation super;
 
+/**
+ * text objects
+ */
+
+static void
+release_text(struct rtb_label *self)
+{
+	if (self->run)
+		rtb_text_run_release(self->run);
+	else if (self->tobj)
+		rtb_text_object_free(self->tobj);
+
+	self->run  = NULL;
+	self->tobj = NULL;
+}
+
+/* swaps whatever we had for the shared run of our text. the new run is
+ * looked up before the old one is let go of, so that it isn't evicted
+ * in between if they're one and the same. */
+static void
+layout_text(struct rtb_label *self)
+{
+	struct rtb_text_run *run;
+
+	run = rtb_text_cache_get(self->window->font_manager.text_cache,
+			self->font, self->text, self->line_height_multiplier);
+
+	release_text(self);
+
+	if (run) {
+		self->run  = run;
+		self->tobj = RTB_UPCAST(run, rtb_text_object);
+	}
+}
+
+/* gives the label a text object of its own, if it doesn't have one
+ * already, since shared runs can't be edited. labels whose text changes
+ * while they're attached are likely to have it change again, so from
+ * then on they lay it out in place. */
+static int
+unshare_text(struct rtb_label *self)
+{
+	struct rtb_text_object *tobj;
+
+	if (self->tobj && !self->run)
+		return 0;
+
+	tobj = rtb_text_object_new(&self->window->font_manager);
+	if (!tobj)
+		return -1;
+
+	release_text(self);
+	self->tobj = tobj;
+	return 0;
+}
+
+/**
+ * placeholders
+ */
+
+/* text with placeholders in it gets laid out again once their glyphs
+ * land. */
+static void
+wait_for_glyphs(struct rtb_label *self)
+{
+	struct rtb_font_manager *fm = &self->window->font_manager;
+
+	if (self->tobj && self->tobj->pending)
+		rtb_font_manager_wait_for_glyphs(fm, &self->glyph_waiter);
+	else
+		rtb_font_manager_stop_waiting(fm, &self->glyph_waiter);
+}
+
+static void
+glyphs_landed(struct rtb_glyph_waiter *waiter)
+{
+	struct rtb_label *self =
+		RTB_CONTAINER_OF(waiter, struct rtb_label, glyph_waiter);
+
+	if (!self->tobj)
+		return;
+
+	/* a shared run is refreshed by whichever of its labels gets here
+	 * first, so the others can't tell from their size whether it
+	 * changed. */
+	if (self->run)
+		rtb_text_run_refresh(self->run);
+	else if (self->tobj->pending)
+		rtb_text_object_update(self->tobj, self->font, self->text,
+				self->line_height_multiplier);
+
+	rtb_elem_trigger_reflow(self->parent, RTB_ELEMENT(self),
+			RTB_DIRECTION_ROOTWARD);
+	rtb_elem_mark_dirty(RTB_ELEMENT(self));
+
+	wait_for_glyphs(self);
+}
+
+/**
+ * element implementation
+ */
+
 static void
 draw(struct rtb_element *elem)
 {
 	SELF_FROM(elem);
-	struct rtb_render_context *ctx = rtb_render_get_context(elem);
 
-	rtb_text_object_render(self->tobj, ctx, self->x, self->y, self->color);
+	if (!self->tobj)
+		return;
+
+	rtb_text_object_draw_on_element(self->tobj, elem, self->x, self->y,
+			self->color);
 }
 
 static void
@@ -59,8 +168,6 @@ attached(struct rtb_element *elem,
 	super.attached(elem, parent, window);
 	self->type = rtb_type_ref(window, self->type,
 			"net.illest.rutabaga.widgets.label");
-
-	self->tobj = rtb_text_object_new(&window->font_manager);
 }
 
 static void
@@ -69,8 +176,13 @@ detached(struct rtb_element *elem,
 {
 	SELF_FROM(elem);
 
-	rtb_text_object_free(self->tobj);
-	self->tobj = NULL;
+	release_text(self);
+	wait_for_glyphs(self);
+
+	/* the text gets laid out again with the next font we're given. */
+	self->font = NULL;
+
+	super.detached(elem, parent, window);
 }
 
 static void
@@ -108,8 +220,9 @@ restyle(struct rtb_element *elem)
 	if (font != self->font) {
 		self->font = font;
 
-		rtb_text_object_update(self->tobj, self->font, self->text,
-				self->line_height_multiplier);
+		layout_text(self);
+		wait_for_glyphs(self);
+
 		rtb_elem_trigger_reflow(self->parent, RTB_ELEMENT(self),
 				RTB_DIRECTION_ROOTWARD);
 	}
@@ -123,6 +236,32 @@ restyle(struct rtb_element *elem)
  * public
  */
 
+static void
+get_text_size(struct rtb_label *self, struct rtb_size *size)
+{
+	if (self->tobj) {
+		size->w = self->tobj->w;
+		size->h = self->tobj->h;
+	} else {
+		size->w = 0.f;
+		size->h = 0.f;
+	}
+}
+
+static void
+text_changed(struct rtb_label *self, const struct rtb_size *old_size)
+{
+	struct rtb_size new_size;
+
+	get_text_size(self, &new_size);
+
+	if (new_size.w != old_size->w || new_size.h != old_size->h)
+		rtb_elem_trigger_reflow(self->parent, RTB_ELEMENT(self),
+				RTB_DIRECTION_ROOTWARD);
+	else
+		rtb_elem_mark_dirty(RTB_ELEMENT(self));
+}
+
 void
 rtb_label_set_text(struct rtb_label *self, const rtb_utf8_t *text)
 {
@@ -133,20 +272,66 @@ rtb_label_set_text(struct rtb_label *self, const rtb_utf8_t *text)
 
 	self->text = strdup(text);
 
-	if (!self->tobj)
+	/* not attached and styled yet. */
+	if (!self->font)
 		return;
 
-	old_size.w = self->tobj->w;
-	old_size.h = self->tobj->h;
+	get_text_size(self, &old_size);
+
+	if (unshare_text(self))
+		return;
 
 	rtb_text_object_update(self->tobj, self->font, self->text,
 			self->line_height_multiplier);
+	wait_for_glyphs(self);
+	text_changed(self, &old_size);
+}
 
-	if (self->tobj->w != old_size.w || self->tobj->h != old_size.h)
-		rtb_elem_trigger_reflow(self->parent, RTB_ELEMENT(self),
-				RTB_DIRECTION_ROOTWARD);
-	else
-		rtb_elem_mark_dirty(RTB_ELEMENT(self));
+void
+rtb_label_splice_text(struct rtb_label *self, int idx, int ndelete,
+		const rtb_utf8_t *text)
+{
+	size_t len, start, end, nbytes;
+	struct rtb_size old_size;
+	int fresh;
+	rtb_utf8_t *new_text;
+
+	if (!self->text) {
+		rtb_label_set_text(self, text);
+		return;
+	}
+
+	len    = strlen(self->text);
+	start  = u8offset(self->text, idx);
+	end    = start + u8offset(self->text + start, ndelete);
+	nbytes = strlen(text);
+
+	if (nbytes > end - start) {
+		new_text = realloc(self->text, len - (end - start) + nbytes + 1);
+		if (!new_text)
+			return;
+
+		self->text = new_text;
+	}
+
+	memmove(self->text + start + nbytes, self->text + end, len - end + 1);
+	memcpy(self->text + start, text, nbytes);
+
+	if (!self->font)
+		return;
+
+	get_text_size(self, &old_size);
+	fresh = !self->tobj || self->run;
+
+	if (unshare_text(self))
+		return;
+
+	if (fresh || rtb_text_object_splice(self->tobj, idx, ndelete, text))
+		rtb_text_object_update(self->tobj, self->font, self->text,
+				self->line_height_multiplier);
+
+	wait_for_glyphs(self);
+	text_changed(self, &old_size);
 }
 
 int
@@ -164,8 +349,12 @@ rtb_label_init(struct rtb_label *self)
 
 	self->text = NULL;
 	self->tobj = NULL;
+	self->run  = NULL;
 	self->font = NULL;
 
+	self->glyph_waiter.glyphs_landed = glyphs_landed;
+	self->glyph_waiter.waiting = 0;
+
 	self->line_height_multiplier = 1.f;
 
 	return 0;
@@ -177,8 +366,11 @@ rtb_label_fini(struct rtb_label *self)
 	if (self->text)
 		free(self->text);
 
-	if (self->tobj)
-		rtb_text_object_free(self->tobj);
+	release_text(self);
+
+	if (self->glyph_waiter.waiting)
+		rtb_font_manager_stop_waiting(&self->window->font_manager,
+				&self->glyph_waiter);
 
 	rtb_elem_fini(RTB_ELEMENT(self));
 }
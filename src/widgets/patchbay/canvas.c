@@ -99,31 +99,52 @@ init_shaders()
 }
 
 static void
-load_tile(const struct rtb_style_texture_definition *definition,
+load_tile(struct rtb_render_state *state,
+		const struct rtb_style_texture_definition *definition,
 		GLuint into_texture)
 {
-	if (!RTB_ASSET_IS_LOADED(RTB_ASSET(definition))) {
+	const void *data;
+	size_t size;
+
+	/* the tile is repeated across the canvas, so it has to be a texture
+	 * of its own. the style build leaves big images out of atlases. */
+	if (definition->atlas.w
+			|| !(data = rtb_asset_data(RTB_ASSET(definition), &size))) {
 		printf(" [!] couldn't load tile, aiee!\n");
 		return;
 	}
 
-	glBindTexture(GL_TEXTURE_2D, into_texture);
+	rtb_render_state_bind_texture(state, into_texture);
 
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
 			definition->w, definition->h,
-			0, GL_BGRA, GL_UNSIGNED_BYTE,
-			RTB_ASSET_DATA(RTB_ASSET(definition)));
+			0, GL_BGRA, GL_UNSIGNED_BYTE, data);
 
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 /**
  * drawing
  */
 
+/* done on attach rather than in init, so that the binds can go through
+ * the window's state tracker. attaching again just sets them up again. */
+static void
+init_vertex_arrays(struct rtb_patchbay *self, struct rtb_render_state *state)
+{
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		rtb_render_state_bind_vertex_array(state, self->bg_vao[i]);
+		rtb_render_state_bind_buffer(state, GL_ARRAY_BUFFER, self->bg_vbo[i]);
+
+		glEnableVertexAttribArray(RTB_ATTRIB_VERTEX);
+		glVertexAttribPointer(RTB_ATTRIB_VERTEX,
+				2, GL_FLOAT, GL_FALSE, 0, 0);
+	}
+}
+
 static void
 cache_to_vbo(struct rtb_patchbay *self)
 {
@@ -146,9 +167,9 @@ cache_to_vbo(struct rtb_patchbay *self)
 	box[3][0] = x;
 	box[3][1] = y + h;
 
-	glBindBuffer(GL_ARRAY_BUFFER, self->bg_vbo[0]);
+	rtb_render_state_bind_buffer(&self->window->render_state,
+			GL_ARRAY_BUFFER, self->bg_vbo[0]);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(box), box, GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 static void
@@ -163,14 +184,12 @@ draw_bg(struct rtb_patchbay *self)
 	rtb_render_set_position(ctx, 0, 0);
 
 	/* draw the background */
-	glBindBuffer(GL_ARRAY_BUFFER, self->bg_vbo[0]);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	rtb_render_state_bind_vertex_array(ctx->state, self->bg_vao[0]);
 
 	prop = rtb_style_query_prop(RTB_ELEMENT(self),
 			"background-image", RTB_STYLE_PROP_TEXTURE, 1);
 
-	glBindTexture(GL_TEXTURE_2D, self->bg_texture);
+	rtb_render_state_bind_texture(ctx->state, self->bg_texture);
 	glUniform1i(shader.uniform.texture, 0);
 	glUniform2f(shader.uniform.tx_size, prop->texture.w, prop->texture.h);
 	glUniform2f(shader.uniform.tx_offset,
@@ -198,14 +217,7 @@ draw_bg(struct rtb_patchbay *self)
 	glUniform2f(shader.uniform.win_size,
 			self->window->w, self->window->h);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
-			self->window->local_storage.ibo.quad.solid);
-	glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_BYTE, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
-	glDisableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
 }
 
 static void
@@ -213,10 +225,6 @@ draw_line(GLfloat line[2][2])
 {
 	glBufferData(GL_ARRAY_BUFFER,
 			sizeof(GLfloat[2][2]), line, GL_STREAM_DRAW);
-
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
-
 	glDrawArrays(GL_LINES, 0, 2);
 }
 
@@ -236,7 +244,8 @@ draw_patches(struct rtb_patchbay *self)
 
 	glEnable(GL_LINE_SMOOTH);
 	glLineWidth(3.5f);
-	glBindBuffer(GL_ARRAY_BUFFER, self->bg_vbo[1]);
+	rtb_render_state_bind_vertex_array(ctx->state, self->bg_vao[1]);
+	rtb_render_state_bind_buffer(ctx->state, GL_ARRAY_BUFFER, self->bg_vbo[1]);
 
 	TAILQ_FOREACH(iter, &self->patches, patchbay_patch) {
 		from = iter->from;
@@ -296,9 +305,6 @@ draw_patches(struct rtb_patchbay *self)
 
 		draw_line(line);
 	}
-
-	glDisableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 static void
@@ -398,6 +404,7 @@ attached(struct rtb_element *elem,
 	self->type = rtb_type_ref(window, self->type,
 			"net.illest.rutabaga.widgets.patchbay");
 
+	init_vertex_arrays(self, &window->render_state);
 	cache_to_vbo(self);
 }
 
@@ -415,7 +422,8 @@ restyle(struct rtb_element *elem)
 			"background-image", RTB_STYLE_PROP_TEXTURE, 0);
 
 	if (prop)
-		load_tile(&prop->texture, self->bg_texture);
+		load_tile(&self->window->render_state,
+				&prop->texture, self->bg_texture);
 
 	if (!old_style)
 		rtb_layout_vpack_top(elem);
@@ -459,6 +467,7 @@ rtb_patchbay_init(struct rtb_patchbay *self)
 
 	glGenTextures(1, &self->bg_texture);
 	glGenBuffers(2, self->bg_vbo);
+	glGenVertexArrays(2, self->bg_vao);
 
 	return 0;
 }
@@ -466,6 +475,8 @@ rtb_patchbay_init(struct rtb_patchbay *self)
 void
 rtb_patchbay_fini(struct rtb_patchbay *self)
 {
+	glDeleteVertexArrays(2, self->bg_vao);
+	glDeleteBuffers(2, self->bg_vbo);
 	glDeleteTextures(1, &self->bg_texture);
 	rtb_surface_fini(RTB_SURFACE(self));
 }
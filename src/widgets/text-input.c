@@ -28,6 +28,7 @@
 
 #include <rutabaga/rutabaga.h>
 #include <rutabaga/render.h>
+#include <rutabaga/shader.h>
 #include <rutabaga/window.h>
 #include <rutabaga/keyboard.h>
 #include <rutabaga/layout.h>
@@ -125,9 +126,7 @@ draw_cursor(struct rtb_text_input *self)
 	ctx = rtb_render_get_context(RTB_ELEMENT(self));
 	rtb_render_set_position(ctx, 0, 0);
 
-	glBindBuffer(GL_ARRAY_BUFFER, self->cursor_vbo);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	rtb_render_state_bind_vertex_array(ctx->state, self->cursor_vao);
 
 	glLineWidth(1.f);
 
@@ -151,20 +150,32 @@ draw(struct rtb_element *elem)
  * text buffer
  */
 
+/* the label gets the same edit as the buffer, so that it only has to lay
+ * out what changed. */
+
 static void
 push_u32(struct rtb_text_input *self, rtb_utf32_t c)
 {
+	rtb_utf8_t utf[7];
+
+	utf[u8enc(c, utf)] = '\0';
+
 	rtb_text_buffer_insert_u32(&self->text, self->cursor_position, c);
+	rtb_label_splice_text(&self->label, self->cursor_position, 0, utf);
+
 	self->cursor_position++;
 }
 
 static int
 pop_u32(struct rtb_text_input *self)
 {
-	if (rtb_text_buffer_erase_char(&self->text, self->cursor_position))
+	if (self->cursor_position <= 0
+			|| rtb_text_buffer_erase_char(&self->text, self->cursor_position))
 		return -1;
 
 	self->cursor_position--;
+	rtb_label_splice_text(&self->label, self->cursor_position, 1, "");
+
 	return 0;
 }
 
@@ -174,6 +185,7 @@ delete_u32(struct rtb_text_input *self)
 	if (rtb_text_buffer_erase_char(&self->text, self->cursor_position + 1))
 		return -1;
 
+	rtb_label_splice_text(&self->label, self->cursor_position, 1, "");
 	return 0;
 }
 
@@ -214,18 +226,15 @@ handle_key_press(struct rtb_text_input *self, const struct rtb_key_event *e)
 			return 0;
 
 		push_u32(self, e->character);
-		post_change(self);
 		break;
 
 	case RTB_KEY_BACKSPACE:
 		pop_u32(self);
-		post_change(self);
 		break;
 
 	case RTB_KEY_DELETE:
 	case RTB_KEY_NUMPAD_DELETE:
 		delete_u32(self);
-		post_change(self);
 		break;
 
 	case RTB_KEY_HOME:
@@ -296,7 +305,8 @@ reflow(struct rtb_element *elem, struct rtb_element *instigator,
 
 	self->outer_pad.y = self->label.outer_pad.y;
 
-	rtb_quad_set_vertices(&self->bg_quad, &self->rect);
+	rtb_quad_set_vertices(&self->bg_quad,
+			&self->window->render_state, &self->rect);
 	update_cursor(self);
 
 	return 1;
@@ -388,6 +398,14 @@ rtb_text_input_init(struct rutabaga *rtb, struct rtb_text_input *self)
 	rtb_text_buffer_init(rtb, &self->text);
 
 	glGenBuffers(1, &self->cursor_vbo);
+	glGenVertexArrays(1, &self->cursor_vao);
+
+	glBindVertexArray(self->cursor_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, self->cursor_vbo);
+	glEnableVertexAttribArray(RTB_ATTRIB_VERTEX);
+	glVertexAttribPointer(RTB_ATTRIB_VERTEX, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
 
 	self->label.align = RTB_ALIGN_MIDDLE;
 	self->label_offset = 0;
@@ -417,6 +435,7 @@ rtb_text_input_fini(struct rtb_text_input *self)
 	rtb_text_buffer_fini(&self->text);
 
 	rtb_quad_fini(&self->bg_quad);
+	glDeleteVertexArrays(1, &self->cursor_vao);
 	glDeleteBuffers(1, &self->cursor_vbo);
 
 	rtb_label_fini(&self->label);
@@ -27,6 +27,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <math.h>
 
 #include <rutabaga/rutabaga.h>
 #include <rutabaga/event.h>
@@ -42,10 +43,12 @@
 
 #include "rtb_private/util.h"
 #include "rtb_private/window_impl.h"
+#include "rtb_private/stylequad-indices.h"
 
 #include "shaders/default.glsl.h"
 #include "shaders/surface.glsl.h"
 #include "shaders/stylequad.glsl.h"
+#include "shaders/batch.glsl.h"
 
 #define ERR(...) fprintf(stderr, "rutabaga: " __VA_ARGS__)
 #define SELF_FROM(elem) \
@@ -60,42 +63,6 @@ static struct rtb_element_implementation super;
  *      of sharing and managing window-local variables.
  */
 
-static const GLubyte stylequad_border_indices[] = {
-	/**
-	 * +---+---+---+
-	 * | 1 | 2 | 3 |
-	 * +---+---+---+
-	 * | 4 | 5 | 6 |
-	 * +---+---+---+
-	 * | 7 | 8 | 9 |
-	 * +---+---+---+
-	 *
-	 * the middle section is not drawn because it's conditionally drawn
-	 * based on whether the texture has defined RTB_TEXTURE_FILL.
-	 * if it is, we'll just draw with solid_indices.
-	 */
-
-	/* 1 */  0,  2,  1,  3,  2,  0,
-	/* 2 */  1,  7,  4,  2,  7,  1,
-	/* 3 */  4,  6,  5,  7,  6,  4,
-
-	/* 4 */  3,  9,  2,  8,  9,  3,
-	/* 5 */
-	/* 6 */  7, 13,  6, 12, 13,  7,
-
-	/* 7 */  8, 10,  9, 11, 10,  8,
-	/* 8 */  9, 15, 12, 10, 15,  9,
-	/* 9 */ 12, 14, 13, 15, 14, 12
-};
-
-static const GLubyte stylequad_solid_indices[] = {
-	2, 7, 9, 12
-};
-
-static const GLubyte stylequad_outline_indices[] = {
-	2, 7, 12, 9
-};
-
 static const GLubyte quad_solid_indices[] = {
 	0, 1, 3, 2
 };
@@ -175,6 +142,28 @@ ibos_fini(struct rtb_window *self)
  * shaders
  */
 
+static int
+batch_shader_init(struct rtb_batch_shader *shader)
+{
+	struct rtb_shader_locations loc = {
+		.texture = "tx_sampler"
+	};
+
+	if (!rtb_shader_create_with_locations(RTB_SHADER(shader),
+				BATCH_VERT_SHADER, NULL, BATCH_FRAG_SHADER, &loc))
+		return -1;
+
+#define CACHE_ATTRIBUTE(ATTRIB) \
+	shader->ATTRIB = glGetAttribLocation(shader->program, #ATTRIB)
+	CACHE_ATTRIBUTE(vertex_color);
+	CACHE_ATTRIBUTE(clip_rect);
+	CACHE_ATTRIBUTE(textured);
+	CACHE_ATTRIBUTE(text_params);
+#undef CACHE_ATTRIBUTE
+
+	return 0;
+}
+
 static int
 shaders_init(struct rtb_window *self)
 {
@@ -190,8 +179,13 @@ shaders_init(struct rtb_window *self)
 				STYLEQUAD_VERT_SHADER, NULL, STYLEQUAD_FRAG_SHADER))
 		goto err_stylequad;
 
+	if (batch_shader_init(&self->local_storage.shader.batch))
+		goto err_batch;
+
 	return 0;
 
+err_batch:
+	rtb_shader_free(&self->local_storage.shader.stylequad);
 err_stylequad:
 	rtb_shader_free(&self->local_storage.shader.surface);
 err_surface:
@@ -203,6 +197,7 @@ err_dfault:
 static void
 shaders_fini(struct rtb_window *self)
 {
+	rtb_shader_free(RTB_SHADER(&self->local_storage.shader.batch));
 	rtb_shader_free(&self->local_storage.shader.stylequad);
 	rtb_shader_free(&self->local_storage.shader.surface);
 	rtb_shader_free(&self->local_storage.shader.dfault);
@@ -255,7 +250,9 @@ static void
 mark_dirty(struct rtb_element *elem)
 {
 	SELF_FROM(elem);
+
 	self->dirty = 1;
+	window_impl_schedule_frame(self);
 }
 
 /**
@@ -281,32 +278,106 @@ rtb_window_focus_element(struct rtb_window *self, struct rtb_element *focused)
 	self->focus = focused;
 }
 
+static void
+damage_to_scissor(struct rtb_window *self, const struct rtb_rect *damage,
+		GLint box[4])
+{
+	GLint x  = floorf(damage->x),  y  = floorf(damage->y);
+	GLint x2 = ceilf(damage->x2), y2 = ceilf(damage->y2);
+
+	box[0] = x - self->x;
+	box[1] = self->y + self->h - y2;
+	box[2] = x2 - x;
+	box[3] = y2 - y;
+}
+
 int
 rtb_window_draw(struct rtb_window *self, int force_redraw)
 {
 	const struct rtb_style_property_definition *prop;
+	struct rtb_render_context *ctx = &RTB_SURFACE(self)->render_ctx;
+	struct rtb_frame_timing *timing = &self->frame_timing;
 	struct rtb_window_event ev;
+	struct rtb_damage frame, region;
+	struct rtb_rect bounds;
+	GLint clip[4];
 
 	if (self->state == RTB_STATE_UNATTACHED
 			|| self->visibility == RTB_FULLY_OBSCURED)
 		return 0;
 
+	rtb_frame_timing_begin(timing, RTB_FRAME_STAGE_FRAME);
+	rtb_frame_watchdog_frame_begin(&self->watchdog);
+
 	ev.type = RTB_FRAME_START;
 	ev.source = RTB_EVENT_GENUINE;
 	ev.window = self;
+
+	rtb_frame_timing_begin(timing, RTB_FRAME_STAGE_UPDATE);
+
+	/* text laid out with placeholders gets laid out again, before
+	 * anyone else gets a look at it. */
+	rtb_font_manager_land_glyphs(&self->font_manager);
 	rtb_dispatch_raw(RTB_ELEMENT(self), RTB_EVENT(&ev));
+	rtb_frame_timing_end(timing, RTB_FRAME_STAGE_UPDATE);
+
+	/* a frame handler is an animation, and keeps the frames coming
+	 * until it's unregistered. */
+	if (rtb_find_handler(RTB_ELEMENT(self), RTB_FRAME_START))
+		rtb_window_request_frame(self);
 
-	if (!self->dirty || force_redraw)
+	if (!self->dirty || force_redraw) {
+		rtb_frame_timing_cancel(timing);
+		rtb_frame_watchdog_frame_cancel(&self->watchdog);
 		return 0;
+	}
+
+	/* if the window was dirtied without anything being queued for
+	 * redraw (an expose, say), we don't know what changed. */
+	frame = RTB_SURFACE(self)->damage;
+	if (rtb_damage_is_empty(&frame))
+		rtb_damage_add_all(&frame);
+
+	/* the overlay is redrawn every frame, and has to be painted over
+	 * again once it's gone. */
+	if (timing->overlay || self->frame_timing_overlay_drawn) {
+		rtb_frame_timing_overlay_rect(timing, &bounds);
+		rtb_damage_add_rect(&frame, &bounds);
+	}
 
-	glViewport(0, 0, self->w, self->h);
+	/* the back buffer also has to catch up on every frame that was
+	 * presented since it was last on screen. */
+	region = frame;
+	rtb_damage_history_repair(&self->damage_history,
+			self->buffer_age, &region);
+	rtb_damage_history_push(&self->damage_history, &frame);
+
+	/* anything could have happened to the GL state in between frames
+	 * (texture uploads, buffer swaps, event handlers). */
+	rtb_render_state_invalidate(&self->render_state, RTB_RENDER_STATE_ALL);
+
+	rtb_render_state_bind_framebuffer(&self->render_state, 0);
+	rtb_render_state_viewport(&self->render_state, 0, 0, self->w, self->h);
 
 	prop = rtb_style_query_prop(RTB_ELEMENT(self),
 			"background-color", RTB_STYLE_PROP_COLOR, 1);
 
 	glEnable(GL_DITHER);
 	glEnable(GL_BLEND);
-	glEnable(GL_SCISSOR_TEST);
+	rtb_render_state_scissor_test(&self->render_state, 1);
+
+	if (!rtb_damage_get_bounds(&region, &bounds)) {
+		damage_to_scissor(self, &bounds, clip);
+		rtb_render_set_clip(ctx, clip);
+	} else {
+		clip[0] = clip[1] = 0;
+		clip[2] = self->w;
+		clip[3] = self->h;
+		rtb_render_set_clip(ctx, NULL);
+	}
+
+	rtb_render_state_scissor(&self->render_state,
+			clip[0], clip[1], clip[2], clip[3]);
 
 	glClearColor(
 			prop->color.r,
@@ -315,18 +386,35 @@ rtb_window_draw(struct rtb_window *self, int force_redraw)
 			prop->color.a);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+	rtb_frame_timing_begin(timing, RTB_FRAME_STAGE_DRAW);
+
 	rtb_render_push(RTB_ELEMENT(self));
 	self->draw(RTB_ELEMENT(self));
 	rtb_render_pop(RTB_ELEMENT(self));
 
+	rtb_frame_timing_draw_overlay(timing, self);
+	self->frame_timing_overlay_drawn = timing->overlay;
+
+	rtb_frame_timing_end(timing, RTB_FRAME_STAGE_DRAW);
+
+	rtb_render_set_clip(ctx, NULL);
 	self->dirty = 0;
 
 	ev.type = RTB_FRAME_END;
 	rtb_dispatch_raw(RTB_ELEMENT(self), RTB_EVENT(&ev));
 
+	rtb_frame_timing_end(timing, RTB_FRAME_STAGE_FRAME);
+	rtb_frame_watchdog_frame_end(&self->watchdog, self);
+
 	return 1;
 }
 
+void
+rtb_window_request_frame(struct rtb_window *self)
+{
+	window_impl_schedule_frame(self);
+}
+
 void
 rtb_window_reinit(struct rtb_window *self)
 {
@@ -391,6 +479,11 @@ rtb_window_open_under(struct rutabaga *r, intptr_t parent,
 	stdata = rtb_style_get_defaults();
 	self->style_list = stdata.style;
 	self->style_fonts = calloc(stdata.nfonts, sizeof(*self->style_fonts));
+	self->style_fonts_failed = calloc(stdata.nfonts,
+			sizeof(*self->style_fonts_failed));
+	self->style_textures = calloc(stdata.ntextures,
+			sizeof(*self->style_textures));
+	self->nstyle_textures = stdata.ntextures;
 
 	if (shaders_init(self))
 		goto err_shaders;
@@ -402,6 +495,8 @@ rtb_window_open_under(struct rutabaga *r, intptr_t parent,
 				self->dpi.x, self->dpi.y))
 		goto err_font;
 
+	self->font_manager.window = self;
+
 	rtb_elem_set_layout(RTB_ELEMENT(self), rtb_layout_vpack_top);
 
 	self->on_event   = win_event;
@@ -410,6 +505,16 @@ rtb_window_open_under(struct rutabaga *r, intptr_t parent,
 
 	self->flags = RTB_ELEM_CLICK_FOCUS;
 
+	rtb_render_state_init(&self->render_state);
+	rtb_damage_history_init(&self->damage_history);
+	self->buffer_age = 0;
+
+	rtb_frame_timing_init(&self->frame_timing);
+	self->frame_timing_overlay_drawn = 0;
+
+	rtb_frame_watchdog_init(&self->watchdog);
+	rtb_quad_init(&self->layout_debug_quad);
+
 	/* for core profiles */
 	glGenVertexArrays(1, &self->vao);
 	glBindVertexArray(self->vao);
@@ -447,11 +552,19 @@ rtb_window_close(struct rtb_window *self)
 	glBindVertexArray(0);
 	glDeleteVertexArrays(1, &self->vao);
 
+	rtb_quad_fini(&self->layout_debug_quad);
+	rtb_frame_watchdog_fini(&self->watchdog);
+	rtb_frame_timing_fini(&self->frame_timing);
 	rtb_font_manager_fini(&self->font_manager);
 
 	ibos_fini(self);
 	shaders_fini(self);
 
+	rtb_style_unresolve_list(self, self->style_list);
+	rtb_style_textures_fini(self);
+
+	free(self->style_textures);
+	free(self->style_fonts_failed);
 	free(self->style_fonts);
 	free(self->style_list);
 
@@ -0,0 +1,194 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "distance-field.h"
+
+// Stands in for infinity, so that sums and differences stay finite.
+#define FAR 1e20f
+
+
+// ------------------------------------------------------------------ edt_1d ---
+// Squared distance from every sample to the nearest zero in f, where f is
+// 0 at the samples being measured to and FAR everywhere else. d, v and z
+// are scratch space for n, n and n + 1 elements.
+static void
+edt_1d( const float *f, float *d, int *v, float *z, int n )
+{
+    int q, k = 0;
+    float s;
+
+    v[0] = 0;
+    z[0] = -FAR;
+    z[1] = FAR;
+
+    for( q = 1; q < n; q++ )
+    {
+        for( ;; )
+        {
+            s = ((f[q] + q*q) - (f[v[k]] + v[k]*v[k])) / (2*q - 2*v[k]);
+            if( s > z[k] || k == 0 )
+                break;
+            k--;
+        }
+
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k+1] = FAR;
+    }
+
+    for( k = 0, q = 0; q < n; q++ )
+    {
+        while( z[k+1] < q )
+            k++;
+
+        d[q] = (q - v[k])*(q - v[k]) + f[v[k]];
+    }
+}
+
+
+// ------------------------------------------------------------------ edt_2d ---
+// In place, columns and then rows.
+static void
+edt_2d( float *grid, int width, int height,
+        float *f, float *d, int *v, float *z )
+{
+    int x, y;
+
+    for( x = 0; x < width; x++ )
+    {
+        for( y = 0; y < height; y++ )
+            f[y] = grid[y*width + x];
+
+        edt_1d( f, d, v, z, height );
+
+        for( y = 0; y < height; y++ )
+            grid[y*width + x] = d[y];
+    }
+
+    for( y = 0; y < height; y++ )
+    {
+        edt_1d( grid + y*width, d, v, z, width );
+
+        for( x = 0; x < width; x++ )
+            grid[y*width + x] = d[x];
+    }
+}
+
+
+// ----------------------------------------------------- make_distance_field ---
+int
+make_distance_field( unsigned char * field,
+                     const unsigned char * coverage,
+                     size_t width,
+                     size_t height,
+                     size_t pitch,
+                     size_t spread )
+{
+    int w = width + 2*spread, h = height + 2*spread, n = (w > h) ? w : h;
+    float *to_inside, *to_outside, *f, *d, *z, distance, value;
+    int x, y, i, *v;
+    unsigned char c;
+
+    to_inside  = (float *) malloc( w*h * sizeof(float) );
+    to_outside = (float *) malloc( w*h * sizeof(float) );
+    f = (float *) malloc( n * sizeof(float) );
+    d = (float *) malloc( n * sizeof(float) );
+    z = (float *) malloc( (n + 1) * sizeof(float) );
+    v = (int *) malloc( n * sizeof(int) );
+
+    if( !to_inside || !to_outside || !f || !d || !z || !v )
+    {
+        free( to_inside );
+        free( to_outside );
+        free( f );
+        free( d );
+        free( z );
+        free( v );
+        return -1;
+    }
+
+    // Pixels that are at least half covered count as inside.
+    for( y = 0, i = 0; y < h; y++ )
+    {
+        for( x = 0; x < w; x++, i++ )
+        {
+            c = 0;
+            if( x >= (int) spread && x < (int) (spread + width)
+                && y >= (int) spread && y < (int) (spread + height) )
+                c = coverage[(y - spread)*pitch + (x - spread)];
+
+            to_inside[i]  = (c >= 128) ? 0.f : FAR;
+            to_outside[i] = (c >= 128) ? FAR : 0.f;
+        }
+    }
+
+    edt_2d( to_inside, w, h, f, d, v, z );
+    edt_2d( to_outside, w, h, f, d, v, z );
+
+    // Distances are to pixel centres, so the edge is half a pixel short of
+    // them. Right next to the edge, the coverage says better where it is.
+    for( y = 0, i = 0; y < h; y++ )
+    {
+        for( x = 0; x < w; x++, i++ )
+        {
+            c = 0;
+            if( x >= (int) spread && x < (int) (spread + width)
+                && y >= (int) spread && y < (int) (spread + height) )
+                c = coverage[(y - spread)*pitch + (x - spread)];
+
+            if( to_inside[i] == 0.f )
+                distance = sqrtf( to_outside[i] ) - .5f;
+            else
+                distance = .5f - sqrtf( to_inside[i] );
+
+            if( c > 0 && c < 255 && fabsf( distance ) <= .5f )
+                distance = c / 255.f - .5f;
+
+            value = .5f + distance / (2.f * spread);
+            if( value < 0.f )
+                value = 0.f;
+            else if( value > 1.f )
+                value = 1.f;
+
+            field[i] = (unsigned char) (value * 255.f + .5f);
+        }
+    }
+
+    free( to_inside );
+    free( to_outside );
+    free( f );
+    free( d );
+    free( z );
+    free( v );
+    return 0;
+}
+
+/* vim: set expandtab sw=4 ts=4 :*/
@@ -0,0 +1,71 @@
+/**
+ * rutabaga: an OpenGL widget toolkit
+ * Copyright (c) 2013-2018 William Light.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/**
+ * Signed distance fields from rasterised glyphs, using the exact Euclidean
+ * distance transform from Felzenszwalb and Huttenlocher, "Distance
+ * Transforms of Sampled Functions", 2012.
+ */
+
+#ifndef __DISTANCE_FIELD_H__
+#define __DISTANCE_FIELD_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Makes a signed distance field out of an 8-bit coverage bitmap. The field
+ * is `spread` pixels bigger than the bitmap on every side, and maps the
+ * glyph's edge to 128, with 255 being `spread` pixels inside the glyph and
+ * 0 being `spread` pixels outside it.
+ *
+ * @param field    (width + 2*spread) * (height + 2*spread) bytes to fill in
+ * @param coverage the bitmap, as from FT_RENDER_MODE_NORMAL
+ * @param width    width of the bitmap
+ * @param height   height of the bitmap
+ * @param pitch    bytes between the starts of the bitmap's rows
+ * @param spread   distance (in pixels) the field covers on either side of
+ *                 the edge
+ *
+ * @return 0 on success, -1 if there wasn't enough memory
+ */
+  int
+  make_distance_field( unsigned char * field,
+                       const unsigned char * coverage,
+                       size_t width,
+                       size_t height,
+                       size_t pitch,
+                       size_t spread );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DISTANCE_FIELD_H__ */
@@ -40,6 +40,78 @@
 #include <rutabaga/rutabaga.h>
 #include "texture-atlas.h"
 
+#define DEFAULT_MAX_SIZE 4096
+
+
+// ------------------------------------------------------------ shelf_class ---
+// Heights up to 16 get a class each. Past that, every power of two is split
+// into 8 classes, so a region wastes at most an eighth of its height to the
+// rounding. Returns the class, and the height of its shelves in *rounded.
+static int
+shelf_class( size_t height, size_t *rounded )
+{
+    size_t octave, step, base;
+    int sub;
+
+    if( height <= 16 )
+    {
+        *rounded = height;
+        return height;
+    }
+
+    for( octave = 4; ((size_t) 2 << octave) < height; octave++ );
+
+    base = (size_t) 1 << octave;
+    step = base >> 3;
+    sub = (height - base + step - 1) / step;
+
+    *rounded = base + sub*step;
+    return 16 + (octave - 4)*8 + sub;
+}
+
+
+// ---------------------------------------------------------- reset_shelves ---
+static void
+reset_shelves( texture_atlas_t * self )
+{
+    size_t i;
+
+    vector_clear( self->shelves );
+
+    for( i = 0; i < TEXTURE_ATLAS_SHELF_CLASSES; i++ )
+        self->open_shelves[i] = -1;
+
+    // We want a one pixel border around the whole atlas to avoid any
+    // artefact when sampling texture
+    self->shelf_top = 1;
+    self->used = 0;
+}
+
+
+// ------------------------------------------------------------- mark_dirty ---
+static void
+mark_dirty( texture_atlas_t * self,
+            size_t x, size_t y, size_t width, size_t height )
+{
+    if( self->dirty.x0 >= self->dirty.x1 )
+    {
+        self->dirty.x0 = x;
+        self->dirty.y0 = y;
+        self->dirty.x1 = x + width;
+        self->dirty.y1 = y + height;
+        return;
+    }
+
+    if( x < self->dirty.x0 )
+        self->dirty.x0 = x;
+    if( y < self->dirty.y0 )
+        self->dirty.y0 = y;
+    if( x + width > self->dirty.x1 )
+        self->dirty.x1 = x + width;
+    if( y + height > self->dirty.y1 )
+        self->dirty.y1 = y + height;
+}
+
 
 // ------------------------------------------------------ texture_atlas_new ---
 texture_atlas_t *
@@ -51,10 +123,6 @@ texture_atlas_new( const size_t width,
 {
     texture_atlas_t *self = (texture_atlas_t *) malloc( sizeof(texture_atlas_t) );
 
-    // We want a one pixel border around the whole atlas to avoid any artefact when
-    // sampling texture
-    ivec3 node = {{1,1,width-2}};
-
     assert( (depth == 1) || (depth == 3) || (depth == 4) );
     if( self == NULL)
     {
@@ -62,17 +130,26 @@ texture_atlas_new( const size_t width,
                  "line %d: No more memory for allocating data\n", __LINE__ );
         exit( EXIT_FAILURE );
     }
-    self->nodes = vector_new( sizeof(ivec3) );
-    self->used = 0;
+    self->shelves = vector_new( sizeof(ivec3) );
+    reset_shelves( self );
     self->width = width;
     self->height = height;
     self->depth = depth;
     self->id = 0;
+    self->filter = GL_NEAREST;
 
     self->dpi.x = x_dpi;
     self->dpi.y = y_dpi;
 
-    vector_push_back( self->nodes, &node );
+    self->max_size = DEFAULT_MAX_SIZE;
+    self->gpu_width = 0;
+    self->gpu_height = 0;
+    self->uploaded = 0;
+
+    // Nothing to track until the first upload, which sends everything.
+    self->dirty.x0 = self->dirty.x1 = 0;
+    self->dirty.y0 = self->dirty.y1 = 0;
+
     self->data = (unsigned char *)
         calloc( width*height*depth, sizeof(unsigned char) );
 
@@ -92,7 +169,7 @@ void
 texture_atlas_delete( texture_atlas_t *self )
 {
     assert( self );
-    vector_delete( self->nodes );
+    vector_delete( self->shelves );
     if( self->data )
     {
         free( self->data );
@@ -134,71 +211,152 @@ texture_atlas_set_region( texture_atlas_t * self,
         memcpy( self->data+((y+i)*self->width + x ) * charsize * depth,
                 data + (i*stride) * charsize, width * charsize * depth  );
     }
+
+    mark_dirty( self, x, y, width, height );
 }
 
 
-// ------------------------------------------------------ texture_atlas_fit ---
-int
-texture_atlas_fit( texture_atlas_t * self,
-                   const size_t index,
-                   const size_t width,
-                   const size_t height )
+// ------------------------------------------------- texture_atlas_max_size ---
+// The biggest the atlas is allowed to get, which is also capped by what the
+// GL can handle.
+static size_t
+texture_atlas_max_size( texture_atlas_t * self )
 {
-    ivec3 *node;
-    int x, y, width_left;
-	size_t i;
+    size_t max = self->max_size;
+    GLint gl_max = 0;
 
-    assert( self );
+    glGetIntegerv( GL_MAX_TEXTURE_SIZE, &gl_max );
+    if( gl_max > 0 && (size_t) gl_max < max )
+        max = gl_max;
 
-    node = (ivec3 *) (vector_get( self->nodes, index ));
-    x = node->x;
-	y = node->y;
-    width_left = width;
-	i = index;
+    return max;
+}
 
-	if ( (x + width) > (self->width-1) )
-    {
-		return -1;
-    }
-	y = node->y;
-	while( width_left > 0 )
-	{
-        node = (ivec3 *) (vector_get( self->nodes, i ));
-        if( node->y > y )
-        {
-            y = node->y;
-        }
-		if( (y + height) > (self->height-1) )
-        {
-			return -1;
-        }
-		width_left -= node->z;
-		++i;
-	}
-	return y;
+
+// ----------------------------------------------------- texture_atlas_grow ---
+// Doubles the smaller of the atlas' width and height. Everything already in
+// the atlas stays where it is. Shelves span the whole width, so they get
+// longer when the atlas gets wider.
+static int
+texture_atlas_grow( texture_atlas_t * self, size_t max )
+{
+    size_t width = self->width, height = self->height;
+    unsigned char *data;
+    size_t y;
+
+    if( height < width )
+        height *= 2;
+    else
+        width *= 2;
+
+    if( width > max || height > max )
+        return -1;
+
+    data = (unsigned char *) calloc( width*height*self->depth, 1 );
+    if( !data )
+        return -1;
+
+    for( y = 0; y < self->height; y++ )
+        memcpy( data + y*width*self->depth,
+                self->data + y*self->width*self->depth,
+                self->width*self->depth );
+
+    free( self->data );
+    self->data = data;
+    self->width = width;
+    self->height = height;
+
+    mark_dirty( self, 0, 0, width, height );
+    return 0;
 }
 
 
-// ---------------------------------------------------- texture_atlas_merge ---
-void
-texture_atlas_merge( texture_atlas_t * self )
+// -------------------------------------------------------- allocate_region ---
+// Regions go at the end of the shelf for their height class. Once that's
+// full, a new shelf is started on top of the others and the old one is left
+// with whatever it has, which keeps this constant time.
+static ivec4
+allocate_region( texture_atlas_t * self,
+                 const size_t width,
+                 const size_t height )
 {
-    ivec3 *node, *next;
-    size_t i;
+    ivec4 region = {{-1,-1,0,0}};
+    size_t rounded;
+    ivec3 *shelf;
+    int class;
 
     assert( self );
 
-	for( i=0; i< self->nodes->size-1; ++i )
+    class = shelf_class( height, &rounded );
+    if( class >= TEXTURE_ATLAS_SHELF_CLASSES || width + 2 > self->width )
+        return region;
+
+    shelf = NULL;
+    if( self->open_shelves[class] >= 0 )
     {
-        node = (ivec3 *) (vector_get( self->nodes, i ));
-        next = (ivec3 *) (vector_get( self->nodes, i+1 ));
-		if( node->y == next->y )
-		{
-			node->z += next->z;
-            vector_erase( self->nodes, i+1 );
-			--i;
-		}
+        shelf = (ivec3 *) vector_get( self->shelves,
+                                      self->open_shelves[class] );
+        if( shelf->x + width > self->width - 1 )
+            shelf = NULL;
+    }
+
+    if( !shelf )
+    {
+        ivec3 new_shelf = {{1, self->shelf_top, rounded}};
+
+        if( self->shelf_top + rounded > self->height - 1 )
+            return region;
+
+        self->open_shelves[class] = self->shelves->size;
+        self->shelf_top += rounded;
+        vector_push_back( self->shelves, &new_shelf );
+        shelf = (ivec3 *) vector_back( self->shelves );
     }
+
+    region.x = shelf->x;
+    region.y = shelf->y;
+    region.width = width;
+    region.height = height;
+
+    shelf->x += width;
+    self->used += width * height;
+    return region;
+}
+
+
+// -------------------------------------------------------- fits_when_grown ---
+// Whether a region would find room once the atlas has grown as far as it
+// can, in which case it's worth growing. A region that's too wide or too
+// tall for the biggest atlas would otherwise have it doubled all the way to
+// `max` for nothing.
+static int
+fits_when_grown( texture_atlas_t * self, size_t max,
+                 const size_t width, const size_t height )
+{
+    size_t grown_width = self->width, grown_height = self->height;
+    size_t rounded;
+    ivec3 *shelf;
+    int class;
+
+    while( grown_width * 2 <= max )
+        grown_width *= 2;
+    while( grown_height * 2 <= max )
+        grown_height *= 2;
+
+    class = shelf_class( height, &rounded );
+    if( class >= TEXTURE_ATLAS_SHELF_CLASSES || width + 2 > grown_width )
+        return 0;
+
+    // Shelves never move, so the open one for this class just gets longer.
+    if( self->open_shelves[class] >= 0 )
+    {
+        shelf = (ivec3 *) vector_get( self->shelves,
+                                      self->open_shelves[class] );
+        if( shelf->x + width <= grown_width - 1 )
+            return 1;
+    }
+
+    return self->shelf_top + rounded <= grown_height - 1;
 }
 
 
@@ -208,84 +366,19 @@ texture_atlas_get_region( texture_atlas_t * self,
                           const size_t width,
                           const size_t height )
 {
+    ivec4 region = allocate_region( self, width, height );
+    size_t max;
 
-	int y, best_height, best_width, best_index;
-    ivec3 *node, *prev;
-    ivec4 region = {{0,0,width,height}};
-    size_t i;
-
-    assert( self );
-
-    best_height = INT_MAX;
-    best_index  = -1;
-    best_width = INT_MAX;
-	for( i=0; i<self->nodes->size; ++i )
-	{
-        y = texture_atlas_fit( self, i, width, height );
-		if( y >= 0 )
-		{
-            node = (ivec3 *) vector_get( self->nodes, i );
-			if( ( (y + (int) height) < best_height ) ||
-                ( ((y + (int) height) == best_height) && (node->z < best_width)) )
-			{
-				best_height = y + height;
-				best_index = i;
-				best_width = node->z;
-				region.x = node->x;
-				region.y = y;
-			}
-        }
-    }
+    if( region.x >= 0 )
+        return region;
 
-	if( best_index == -1 )
-    {
-        region.x = -1;
-        region.y = -1;
-        region.width = 0;
-        region.height = 0;
+    max = texture_atlas_max_size( self );
+    if( !fits_when_grown( self, max, width, height ) )
         return region;
-    }
 
-    node = (ivec3 *) malloc( sizeof(ivec3) );
-    if( node == NULL)
-    {
-        fprintf( stderr,
-                 "line %d: No more memory for allocating data\n", __LINE__ );
-        exit( EXIT_FAILURE );
-    }
-    node->x = region.x;
-    node->y = region.y + height;
-    node->z = width;
-    vector_insert( self->nodes, best_index, node );
-    free( node );
+    while( region.x < 0 && !texture_atlas_grow( self, max ) )
+        region = allocate_region( self, width, height );
 
-    for(i = best_index+1; i < self->nodes->size; ++i)
-    {
-        node = (ivec3 *) vector_get( self->nodes, i );
-        prev = (ivec3 *) vector_get( self->nodes, i-1 );
-
-        if (node->x < (prev->x + prev->z) )
-        {
-            int shrink = prev->x + prev->z - node->x;
-            node->x += shrink;
-            node->z -= shrink;
-            if (node->z <= 0)
-            {
-                vector_erase( self->nodes, i );
-                --i;
-            }
-            else
-            {
-                break;
-            }
-        }
-        else
-        {
-            break;
-        }
-    }
-    texture_atlas_merge( self );
-    self->used += width * height;
     return region;
 }
 
@@ -294,19 +387,12 @@ texture_atlas_get_region( texture_atlas_t * self,
 void
 texture_atlas_clear( texture_atlas_t * self )
 {
-    ivec3 node = {{1,1,1}};
-
     assert( self );
     assert( self->data );
 
-    vector_clear( self->nodes );
-    self->used = 0;
-    // We want a one pixel border around the whole atlas to avoid any artefact when
-    // sampling texture
-    node.z = self->width-2;
-
-    vector_push_back( self->nodes, &node );
+    reset_shelves( self );
     memset( self->data, 0, self->width*self->height*self->depth );
+    mark_dirty( self, 0, 0, self->width, self->height );
 }
 
 
@@ -314,39 +400,79 @@ texture_atlas_clear( texture_atlas_t * self )
 void
 texture_atlas_upload( texture_atlas_t * self )
 {
+    GLenum internal_format, format, type;
+    size_t x, y, width, height;
+
     assert( self );
     assert( self->data );
 
-    if( !self->id )
-    {
-        glGenTextures( 1, &self->id );
-    }
-
-    glBindTexture( GL_TEXTURE_2D, self->id );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
     if( self->depth == 4 )
     {
+        internal_format = GL_RGBA;
 #ifdef GL_UNSIGNED_INT_8_8_8_8_REV
-        glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, self->width, self->height,
-                      0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, self->data );
+        format = GL_BGRA;
+        type = GL_UNSIGNED_INT_8_8_8_8_REV;
 #else
-        glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, self->width, self->height,
-                      0, GL_RGBA, GL_UNSIGNED_BYTE, self->data );
+        format = GL_RGBA;
+        type = GL_UNSIGNED_BYTE;
 #endif
     }
     else if( self->depth == 3 )
     {
-        glTexImage2D( GL_TEXTURE_2D, 0, GL_RGB, self->width, self->height,
-                      0, GL_RGB, GL_UNSIGNED_BYTE, self->data );
+        internal_format = format = GL_RGB;
+        type = GL_UNSIGNED_BYTE;
     }
     else
     {
-        glTexImage2D( GL_TEXTURE_2D, 0, GL_RED, self->width, self->height,
-                      0, GL_RED, GL_UNSIGNED_BYTE, self->data );
+        internal_format = format = GL_RED;
+        type = GL_UNSIGNED_BYTE;
     }
+
+    if( !self->id )
+    {
+        glGenTextures( 1, &self->id );
+        glBindTexture( GL_TEXTURE_2D, self->id );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, self->filter );
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, self->filter );
+    }
+    else
+    {
+        glBindTexture( GL_TEXTURE_2D, self->id );
+    }
+
+    // Rows of RGB and single-channel data aren't 4-byte aligned.
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+    if( self->gpu_width != self->width || self->gpu_height != self->height )
+    {
+        glTexImage2D( GL_TEXTURE_2D, 0, internal_format,
+                      self->width, self->height, 0, format, type, self->data );
+
+        self->gpu_width = self->width;
+        self->gpu_height = self->height;
+        self->uploaded += self->width*self->height*self->depth;
+    }
+    else if( self->dirty.x0 < self->dirty.x1 )
+    {
+        x = self->dirty.x0;
+        y = self->dirty.y0;
+        width = self->dirty.x1 - x;
+        height = self->dirty.y1 - y;
+
+        glPixelStorei( GL_UNPACK_ROW_LENGTH, self->width );
+        glTexSubImage2D( GL_TEXTURE_2D, 0, x, y, width, height, format, type,
+                         self->data + (y*self->width + x)*self->depth );
+        glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+
+        self->uploaded += width*height*self->depth;
+    }
+
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+
+    self->dirty.x0 = self->dirty.x1 = 0;
+    self->dirty.y0 = self->dirty.y1 = 0;
 }
 
 /* vim: set expandtab sw=4 ts=4 :*/
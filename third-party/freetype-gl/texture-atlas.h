@@ -35,9 +35,9 @@
  * "A Thousand Ways to Pack the Bin - A Practical Approach to
  * Two-Dimensional Rectangle Bin Packing", February 27, 2010.
  *
- * More precisely, this is an implementation of the Skyline Bottom-Left
- * algorithm based on C++ sources provided by Jukka Jylänki at:
- * http://clb.demon.fi/files/RectangleBinPack/
+ * More precisely, this is an implementation of the Shelf Next Fit
+ * algorithm, with a shelf per height class so that looking for a spot
+ * doesn't depend on how many regions there are already.
  *
  *  ============================================================================
  */
@@ -62,9 +62,8 @@ extern "C" {
  * The actual implementation is based on the article by Jukka Jylänki : "A
  * Thousand Ways to Pack the Bin - A Practical Approach to Two-Dimensional
  * Rectangle Bin Packing", February 27, 2010.
- * More precisely, this is an implementation of the Skyline Bottom-Left
- * algorithm based on C++ sources provided by Jukka Jylänki at:
- * http://clb.demon.fi/files/RectangleBinPack/
+ * More precisely, this is an implementation of the Shelf Next Fit
+ * algorithm, with the shelves bucketed by height.
  *
  *
  * Example Usage:
@@ -90,15 +89,32 @@ extern "C" {
  */
 
 
+/**
+ * Number of shelf height classes, enough for regions up to 4096 pixels high.
+ */
+#define TEXTURE_ATLAS_SHELF_CLASSES 81
+
 /**
  * A texture atlas is used to pack several small regions into a single texture.
  */
 typedef struct
 {
     /**
-     * Allocated nodes
+     * Shelves, as (x, y, height). Each is a row across the atlas that gets
+     * filled left to right, and x is where its next region goes.
      */
-    vector_t * nodes;
+    vector_t * shelves;
+
+    /**
+     * For each height class, the index of the shelf that's being filled,
+     * or -1 if there isn't one yet.
+     */
+    int open_shelves[TEXTURE_ATLAS_SHELF_CLASSES];
+
+    /**
+     * Where the next shelf starts
+     */
+    size_t shelf_top;
 
     /**
      *  Width (in pixels) of the underlying texture
@@ -133,11 +149,42 @@ typedef struct
      */
     unsigned int id;
 
+    /**
+     * Texture filtering (OpenGL), GL_NEAREST unless it's changed before the
+     * first upload
+     */
+    unsigned int filter;
+
     /**
      * Atlas data
      */
     unsigned char * data;
 
+    /**
+     * Largest width or height the atlas grows to when it runs out of
+     * room. It never grows past GL_MAX_TEXTURE_SIZE either.
+     */
+    size_t max_size;
+
+    /**
+     * Region of `data` that has changed since the last upload, as
+     * [x0, x1) by [y0, y1). Empty when x0 >= x1.
+     */
+    struct {
+        size_t x0, y0, x1, y1;
+    } dirty;
+
+    /**
+     * Size of the texture in video memory, 0 before the first upload.
+     */
+    size_t gpu_width;
+    size_t gpu_height;
+
+    /**
+     * Bytes sent to video memory, over the atlas' lifetime.
+     */
+    size_t uploaded;
+
 } texture_atlas_t;
 
 
@@ -170,7 +217,8 @@ typedef struct
 
 
 /**
- *  Upload atlas to video memory.
+ *  Upload atlas to video memory. Only the region that changed since the
+ *  last upload is sent, unless the atlas has grown in the meantime.
  *
  *  @param self a texture atlas structure
  *
@@ -180,12 +228,17 @@ typedef struct
 
 
 /**
- *  Allocate a new region in the atlas.
+ *  Allocate a new region in the atlas. If there's no room left, the atlas
+ *  doubles in width or height (whichever is smaller) until the region
+ *  fits or it reaches `max_size`. A region that wouldn't fit even then
+ *  fails without growing the atlas. Regions keep their pixel coordinates
+ *  when the atlas grows, but not their normalized ones.
  *
  *  @param self   a texture atlas structure
  *  @param width  width of the region to allocate
  *  @param height height of the region to allocate
- *  @return       Coordinates of the allocated region
+ *  @return       Coordinates of the allocated region, or x = -1 if it
+ *                doesn't fit
  *
  */
   ivec4
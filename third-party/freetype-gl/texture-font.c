@@ -39,9 +39,11 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 #include "texture-font.h"
+#include "distance-field.h"
 
 #define HRES  64
 #define HRESf 64.f
@@ -56,8 +58,43 @@ const struct {
 } FT_Errors[] =
 #include FT_ERRORS_H
 
+/* where a font's faces come from. batches keep a copy, so that they can
+ * be rendered without touching the font. */
+typedef struct
+{
+    int location;
+    const char * filename;
+    const void * memory_base;
+    size_t memory_size;
+
+    int dpi_x;
+    int dpi_y;
+} face_source_t;
+
+static face_source_t
+font_source( const texture_font_t *self )
+{
+    face_source_t source = {
+        .location = self->location,
+        .dpi_x    = self->atlas->dpi.x,
+        .dpi_y    = self->atlas->dpi.y
+    };
+
+    if( self->location == TEXTURE_FONT_FILE )
+    {
+        source.filename = self->filename;
+    }
+    else
+    {
+        source.memory_base = self->memory.base;
+        source.memory_size = self->memory.size;
+    }
+
+    return source;
+}
+
 static int
-texture_font_load_face(texture_font_t *self, float size,
+load_face(const face_source_t *source, float size,
 		FT_Library *library, FT_Face *face)
 {
 	FT_Error error;
@@ -79,14 +116,14 @@ texture_font_load_face(texture_font_t *self, float size,
 	}
 
 	/* Load face */
-	switch (self->location) {
+	switch (source->location) {
 	case TEXTURE_FONT_FILE:
-		error = FT_New_Face(*library, self->filename, 0, face);
+		error = FT_New_Face(*library, source->filename, 0, face);
 		break;
 
 	case TEXTURE_FONT_MEMORY:
 		error = FT_New_Memory_Face(*library,
-			self->memory.base, self->memory.size, 0, face);
+			source->memory_base, source->memory_size, 0, face);
 		break;
 	}
 
@@ -110,7 +147,7 @@ texture_font_load_face(texture_font_t *self, float size,
     /* Set char size */
     error = FT_Set_Char_Size(*face,
             (int)(size * HRES), 0,
-            self->atlas->dpi.x * HRES, self->atlas->dpi.y);
+            source->dpi_x * HRES, source->dpi_y);
 
 	if(error) {
 		fprintf(stderr, "FT_Error (line %d, code 0x%02x) : %s\n",
@@ -126,26 +163,12 @@ texture_font_load_face(texture_font_t *self, float size,
 	return 1;
 }
 
-static int
-texture_font_get_face_with_size(texture_font_t *self, float size,
-		FT_Library *library, FT_Face *face)
-{
-	return texture_font_load_face(self, size, library, face);
-}
-
-static int
-texture_font_get_face(texture_font_t *self,
-		FT_Library *library, FT_Face *face)
-{
-	return texture_font_get_face_with_size(self, self->size, library, face);
-}
-
 static int
 texture_font_get_hires_face(texture_font_t *self,
 		FT_Library *library, FT_Face *face)
 {
-	return texture_font_get_face_with_size(self,
-			self->size * 100.f, library, face);
+	face_source_t source = font_source(self);
+	return load_face(&source, self->size * 100.f, library, face);
 }
 
 // ------------------------------------------------------ texture_glyph_new ---
@@ -172,7 +195,7 @@ texture_glyph_new(void)
 	self->t0        = 0.0;
 	self->s1        = 0.0;
 	self->t1        = 0.0;
-	self->kerning   = vector_new( sizeof(kerning_t) );
+	self->pending   = 0;
 	return self;
 }
 
@@ -182,73 +205,176 @@ void
 texture_glyph_delete( texture_glyph_t *self )
 {
     assert( self );
-    vector_delete( self->kerning );
     free( self );
 }
 
-// ---------------------------------------------- texture_glyph_get_kerning ---
-float
-texture_glyph_get_kerning( const texture_glyph_t * self,
-                           const int32_t charcode )
+// ------------------------------------------------------------ glyph index ---
+
+#define INDEX_MIN_SIZE 256
+
+static size_t
+glyph_hash( int32_t charcode, int outline_type, float outline_thickness )
 {
-    size_t i;
+    uint32_t thickness = 0;
 
-    assert( self );
-    for( i=0; i<vector_size(self->kerning); ++i )
+    /* 0.f and -0.f compare equal, so they have to hash the same. */
+    if( outline_thickness != 0.f )
+        memcpy( &thickness, &outline_thickness, sizeof(thickness) );
+
+    return ((uint32_t) charcode * 2654435761u)
+        ^ ((thickness + (uint32_t) outline_type) * 40503u);
+}
+
+static int
+glyph_matches( const texture_glyph_t *glyph, int32_t charcode,
+               int outline_type, float outline_thickness )
+{
+    return glyph->charcode == charcode
+        && glyph->outline_type == outline_type
+        && glyph->outline_thickness == outline_thickness;
+}
+
+static texture_glyph_t *
+index_lookup( const texture_font_t *self, int32_t charcode,
+              int outline_type, float outline_thickness )
+{
+    texture_glyph_t *glyph;
+    size_t i, mask;
+
+    if( !self->index.size )
+        return NULL;
+
+    mask = self->index.size - 1;
+    i = glyph_hash( charcode, outline_type, outline_thickness ) & mask;
+
+    for( ; (glyph = self->index.slots[i]); i = (i + 1) & mask )
+        if( glyph_matches( glyph, charcode, outline_type, outline_thickness ) )
+            return glyph;
+
+    return NULL;
+}
+
+static void
+index_place( texture_glyph_t **slots, size_t size, texture_glyph_t *glyph )
+{
+    size_t i, mask = size - 1;
+
+    i = glyph_hash( glyph->charcode,
+                    glyph->outline_type, glyph->outline_thickness ) & mask;
+
+    while( slots[i] )
+        i = (i + 1) & mask;
+
+    slots[i] = glyph;
+}
+
+static int
+index_insert( texture_font_t *self, texture_glyph_t *glyph )
+{
+    texture_glyph_t **slots;
+    size_t i, size;
+
+    /* keep the table at most half full, so probe runs stay short. */
+    if( (self->index.used + 1) * 2 > self->index.size )
     {
-        kerning_t * kerning = (kerning_t *) vector_get( self->kerning, i );
-        if( kerning->charcode == charcode )
-        {
-            return kerning->kerning;
-        }
+        size = self->index.size ? self->index.size * 2 : INDEX_MIN_SIZE;
+
+        if( !(slots = calloc( size, sizeof(*slots) )) )
+            return -1;
+
+        for( i = 0; i < self->index.size; i++ )
+            if( self->index.slots[i] )
+                index_place( slots, size, self->index.slots[i] );
+
+        free( self->index.slots );
+        self->index.slots = slots;
+        self->index.size = size;
     }
+
+    index_place( self->index.slots, self->index.size, glyph );
+    self->index.used++;
     return 0;
 }
 
+static void
+add_glyph( texture_font_t *self, texture_glyph_t *glyph )
+{
+    vector_push_back( self->glyphs, &glyph );
 
-// ------------------------------------------ texture_font_generate_kerning ---
-void
-texture_font_generate_kerning(texture_font_t *self)
+    /* if this fails, lookups for the glyph miss and it gets loaded
+     * again, which is slow but not wrong. */
+    index_insert( self, glyph );
+}
+
+// ------------------------------------------------------------ kerning ---
+
+static size_t
+kerning_hash( int32_t left, int32_t right )
 {
-    size_t i, j;
-    FT_Library library;
-    FT_Face face;
-    FT_UInt glyph_index, prev_index;
-    texture_glyph_t *glyph, *prev_glyph;
-    FT_Vector kerning;
+    return ((uint32_t) left * 2654435761u) ^ ((uint32_t) right * 40503u);
+}
 
-    assert( self );
+static kerning_t *
+kerning_slot( kerning_t *pairs, size_t size, int32_t left, int32_t right )
+{
+    size_t i, mask = size - 1;
 
-    /* Load font */
-    if(!texture_font_get_face(self, &library, &face))
-        return;
+    for( i = kerning_hash( left, right ) & mask; pairs[i].left;
+         i = (i + 1) & mask )
+        if( pairs[i].left == left && pairs[i].right == right )
+            break;
+
+    return &pairs[i];
+}
+
+static int
+kerning_insert( texture_font_t *self, int32_t left, int32_t right,
+                float kerning )
+{
+    kerning_t *pairs, *slot;
+    size_t i, size;
 
-    /* For each glyph couple combination, check if kerning is necessary */
-    /* Starts at index 1 since 0 is for the special backgroudn glyph */
-    for( i=1; i<self->glyphs->size; ++i )
+    if( (self->kerns.used + 1) * 2 > self->kerns.size )
     {
-        glyph = *(texture_glyph_t **) vector_get( self->glyphs, i );
-        glyph_index = FT_Get_Char_Index( face, glyph->charcode );
-        vector_clear( glyph->kerning );
+        size = self->kerns.size ? self->kerns.size * 2 : INDEX_MIN_SIZE;
 
-        for( j=1; j<self->glyphs->size; ++j )
-        {
-            prev_glyph = *(texture_glyph_t **) vector_get( self->glyphs, j );
-            prev_index = FT_Get_Char_Index( face, prev_glyph->charcode );
-            FT_Get_Kerning( face, prev_index, glyph_index, FT_KERNING_UNFITTED, &kerning );
-            // printf("%c(%d)-%c(%d): %ld\n",
-            //       prev_glyph->charcode, prev_glyph->charcode,
-            //       glyph_index, glyph_index, kerning.x);
-            if( kerning.x )
-            {
-                kerning_t k = {prev_glyph->charcode, kerning.x / (float)(HRESf*HRESf)};
-                vector_push_back( glyph->kerning, &k );
-            }
-        }
+        if( !(pairs = calloc( size, sizeof(*pairs) )) )
+            return -1;
+
+        for( i = 0; i < self->kerns.size; i++ )
+            if( self->kerns.pairs[i].left )
+                *kerning_slot( pairs, size, self->kerns.pairs[i].left,
+                               self->kerns.pairs[i].right ) = self->kerns.pairs[i];
+
+        free( self->kerns.pairs );
+        self->kerns.pairs = pairs;
+        self->kerns.size = size;
     }
 
-    FT_Done_Face( face );
-    FT_Done_FreeType( library );
+    slot = kerning_slot( self->kerns.pairs, self->kerns.size, left, right );
+
+    if( !slot->left )
+    {
+        slot->left = left;
+        slot->right = right;
+        self->kerns.used++;
+    }
+
+    slot->kerning = kerning;
+    return 0;
+}
+
+float
+texture_font_get_kerning( const texture_font_t *self,
+                          int32_t left, int32_t right )
+{
+    const kerning_t *slot;
+
+    if( !self->kerns.size )
+        return 0.f;
+
+    slot = kerning_slot( self->kerns.pairs, self->kerns.size, left, right );
+    return slot->left ? slot->kerning : 0.f;
 }
 
 // ------------------------------------------------------ texture_font_init ---
@@ -267,6 +393,8 @@ texture_font_init(texture_font_t *self)
 			&& self->memory.base && self->memory.size));
 
 	self->glyphs = vector_new(sizeof(texture_glyph_t *));
+	self->queued = vector_new(sizeof(int32_t));
+	self->pending = 0;
 	self->height = 0;
 	self->ascender = 0;
 	self->descender = 0;
@@ -275,6 +403,7 @@ texture_font_init(texture_font_t *self)
 	self->hinting = 1;
 	self->kerning = 1;
 	self->filtering = 1;
+	self->rendermode = RENDER_NORMAL;
 
 	// FT_LCD_FILTER_LIGHT   is (0x00, 0x55, 0x56, 0x55, 0x00)
 	// FT_LCD_FILTER_DEFAULT is (0x10, 0x40, 0x70, 0x40, 0x10)
@@ -394,10 +523,59 @@ texture_font_delete(texture_font_t *self)
     }
 
     vector_delete(self->glyphs);
+    vector_delete(self->queued);
+    free(self->index.slots);
+    free(self->kerns.pairs);
     free(self);
 }
 
-// ----------------------------------------------- texture_font_load_glyphs ---
+// ---------------------------------------------------------- glyph batches ---
+
+/* a glyph as a batch rendered it, before it's put in the atlas. */
+typedef struct
+{
+    size_t width;
+    size_t height;
+    int offset_x;
+    int offset_y;
+    float advance_x;
+    float advance_y;
+
+    /* `width` texels to a row, with no padding between rows. NULL if the
+     * glyph is empty. */
+    unsigned char *buffer;
+    int failed;
+} glyph_bitmap_t;
+
+struct texture_glyph_batch_t
+{
+    /* what the font's glyphs are rendered with, copied so that rendering
+     * the batch doesn't have to look at the font. */
+    face_source_t source;
+    char *filename;
+    float size;
+    size_t depth;
+
+    int hinting;
+    int filtering;
+    int outline_type;
+    float outline_thickness;
+    unsigned char lcd_weights[5];
+    rendermode_t rendermode;
+
+    int32_t *charcodes;
+    glyph_bitmap_t *bitmaps;
+    size_t count;
+
+    /* every charcode in the font when the batch was made, the batch's own
+     * included. the batch works out the kerning between its glyphs and
+     * these, in both directions. */
+    int32_t *known;
+    size_t nknown;
+
+    vector_t *kerns;
+};
+
 static size_t
 i32len(const int32_t *s)
 {
@@ -407,236 +585,686 @@ i32len(const int32_t *s)
 	return len;
 }
 
-size_t
-texture_font_load_glyphs( texture_font_t * self,
-                          const int32_t * charcodes )
+/* stands in for a glyph until its batch is added. it's empty, with an
+ * advance of about half an em. */
+static texture_glyph_t *
+add_placeholder( texture_font_t *self, int32_t charcode )
 {
-    size_t i, x, y, width, height, depth, w, h;
-    FT_Library library;
-    FT_Error error;
-    FT_Face face;
-    FT_Glyph ft_glyph;
-    FT_GlyphSlot slot;
-    FT_Bitmap ft_bitmap;
+    texture_glyph_t *glyph;
+
+    if( !(glyph = texture_glyph_new()) )
+        return NULL;
+
+    glyph->charcode  = charcode;
+    glyph->outline_type = self->outline_type;
+    glyph->outline_thickness = self->outline_thickness;
+    glyph->advance_x = roundf( (self->ascender - self->descender) / 2.f );
+    glyph->pending   = 1;
+
+    add_glyph( self, glyph );
+    self->pending++;
+    return glyph;
+}
+
+void
+texture_glyph_batch_delete( texture_glyph_batch_t *batch )
+{
+    size_t i;
+
+    if( batch->bitmaps )
+        for( i = 0; i < batch->count; ++i )
+            free( batch->bitmaps[i].buffer );
+
+    if( batch->kerns )
+        vector_delete( batch->kerns );
+
+    free( batch->bitmaps );
+    free( batch->charcodes );
+    free( batch->known );
+    free( batch->filename );
+    free( batch );
+}
+
+/* a batch of the glyphs in `charcodes` which haven't been rendered yet,
+ * with placeholders added to the font for any it didn't have. */
+static texture_glyph_batch_t *
+batch_new( texture_font_t *self, const int32_t *charcodes, size_t count )
+{
+    texture_glyph_batch_t *batch;
+    texture_glyph_t *glyph, **glyphs;
+    size_t i;
+
+    if( !(batch = calloc( 1, sizeof(*batch) )) )
+        return NULL;
+
+    batch->source = font_source( self );
+    if( self->location == TEXTURE_FONT_FILE )
+    {
+        if( !(batch->filename = strdup( self->filename )) )
+            goto err;
+
+        batch->source.filename = batch->filename;
+    }
+
+    batch->size     = self->size;
+    batch->depth    = self->atlas->depth;
+    batch->hinting  = self->hinting;
+    batch->filtering = self->filtering;
+    batch->outline_type = self->outline_type;
+    batch->outline_thickness = self->outline_thickness;
+    batch->rendermode = self->rendermode;
+    memcpy( batch->lcd_weights, self->lcd_weights, sizeof(self->lcd_weights) );
+
+    assert( batch->rendermode != RENDER_SIGNED_DISTANCE_FIELD
+            || batch->depth == 1 );
+
+    batch->charcodes = malloc( count * sizeof(*batch->charcodes) );
+    batch->kerns = vector_new( sizeof(kerning_t) );
+    if( !batch->charcodes || !batch->kerns )
+        goto err;
+
+    for( i = 0; i < count; ++i )
+    {
+        glyph = index_lookup( self, charcodes[i],
+                self->outline_type, self->outline_thickness );
+
+        if( !glyph && !add_placeholder( self, charcodes[i] ) )
+            goto err;
+        else if( glyph && !glyph->pending )
+            continue;
+
+        batch->charcodes[batch->count++] = charcodes[i];
+    }
+
+    if( !batch->count )
+        return batch;
+
+    batch->bitmaps = calloc( batch->count, sizeof(*batch->bitmaps) );
+    batch->nknown  = vector_size( self->glyphs );
+    batch->known   = malloc( batch->nknown * sizeof(*batch->known) );
+    if( !batch->bitmaps || !batch->known )
+        goto err;
+
+    glyphs = self->glyphs->items;
+    for( i = 0; i < batch->nknown; ++i )
+        batch->known[i] = glyphs[i]->charcode;
 
+    return batch;
+
+err:
+    fprintf( stderr, "line %d: No more memory for allocating data\n",
+             __LINE__ );
+    texture_glyph_batch_delete( batch );
+    return NULL;
+}
+
+static int
+render_glyph( texture_glyph_batch_t *batch, FT_Library library,
+              FT_Face face, int32_t charcode, glyph_bitmap_t *bitmap )
+{
+    size_t w, h, row, depth = batch->depth;
+    size_t spread = TEXTURE_FONT_SDF_SPREAD;
+    FT_Stroker stroker = NULL;
+    FT_Glyph ft_glyph = NULL;
+    FT_Bitmap ft_bitmap;
     FT_UInt glyph_index;
-    texture_glyph_t *glyph;
-    ivec4 region;
-    size_t missed = 0, len;
+    FT_Int32 flags = 0;
+    FT_Error error;
+    int top, left, sdf;
 
-    assert( self );
-    assert( charcodes );
+    sdf = (batch->rendermode == RENDER_SIGNED_DISTANCE_FIELD);
+    glyph_index = FT_Get_Char_Index( face, charcode );
+    // WARNING: We use texture-atlas depth to guess if user wants
+    //          LCD subpixel rendering
 
+    if( batch->outline_type > 0 )
+        flags |= FT_LOAD_NO_BITMAP;
+    else
+        flags |= FT_LOAD_RENDER;
 
-    width  = self->atlas->width;
-    height = self->atlas->height;
-    depth  = self->atlas->depth;
-	len = i32len(charcodes);
+    // Hinting is for one size, and distance fields are for all of them.
+    if( !batch->hinting || sdf )
+        flags |= FT_LOAD_NO_HINTING | FT_LOAD_NO_AUTOHINT;
+    else
+        flags |= FT_LOAD_FORCE_AUTOHINT;
 
-	if (!texture_font_get_face(self, &library, &face))
-		return len;
+    if( depth == 3 )
+    {
+        FT_Library_SetLcdFilter( library, FT_LCD_FILTER_LIGHT );
+        flags |= FT_LOAD_TARGET_LCD;
+
+        if( batch->filtering )
+            FT_Library_SetLcdFilterWeights( library, batch->lcd_weights );
+    }
 
-    /* Load each glyph */
-    for( i=0; charcodes[i]; ++i )
+    error = FT_Load_Glyph( face, glyph_index, flags );
+    if( error )
+        goto ft_error;
+
+    if( batch->outline_type == 0 )
     {
-        FT_Int32 flags = 0;
-        int ft_bitmap_width = 0;
-        int ft_bitmap_rows = 0;
-        int ft_bitmap_pitch = 0;
-        int ft_glyph_top = 0;
-        int ft_glyph_left = 0;
-        glyph_index = FT_Get_Char_Index( face, charcodes[i] );
-        // WARNING: We use texture-atlas depth to guess if user wants
-        //          LCD subpixel rendering
-
-        if( self->outline_type > 0 )
-            flags |= FT_LOAD_NO_BITMAP;
-        else
-            flags |= FT_LOAD_RENDER;
-
-        if (!self->hinting)
-            flags |= FT_LOAD_NO_HINTING | FT_LOAD_NO_AUTOHINT;
-		else
-			flags |= FT_LOAD_FORCE_AUTOHINT;
-
-        if( depth == 3 )
-        {
-            FT_Library_SetLcdFilter( library, FT_LCD_FILTER_LIGHT );
-            flags |= FT_LOAD_TARGET_LCD;
+        ft_bitmap = face->glyph->bitmap;
+        top       = face->glyph->bitmap_top;
+        left      = face->glyph->bitmap_left;
+    }
+    else
+    {
+        FT_BitmapGlyph ft_bitmap_glyph;
 
-            if( self->filtering )
-            {
-                FT_Library_SetLcdFilterWeights( library, self->lcd_weights );
-            }
-        }
+        error = FT_Stroker_New( library, &stroker );
+        if( error )
+            goto ft_error;
+
+        FT_Stroker_Set( stroker,
+                        (int)(batch->outline_thickness * 64),
+                        FT_STROKER_LINECAP_ROUND,
+                        FT_STROKER_LINEJOIN_ROUND,
+                        0 );
 
-        error = FT_Load_Glyph( face, glyph_index, flags );
+        error = FT_Get_Glyph( face->glyph, &ft_glyph );
         if( error )
-        {
-            fprintf( stderr, "FT_Error (line %d, code 0x%02x) : %s\n",
-                     __LINE__, FT_Errors[error].code, FT_Errors[error].message );
-            FT_Done_Face( face );
-            FT_Done_FreeType( library );
-            return len - i;
-        }
+            goto ft_error;
+
+        if( batch->outline_type == 1 )
+            error = FT_Glyph_Stroke( &ft_glyph, stroker, 1 );
+        else if( batch->outline_type == 2 )
+            error = FT_Glyph_StrokeBorder( &ft_glyph, stroker, 0, 1 );
+        else if( batch->outline_type == 3 )
+            error = FT_Glyph_StrokeBorder( &ft_glyph, stroker, 1, 1 );
+
+        if( error )
+            goto ft_error;
+
+        error = FT_Glyph_To_Bitmap( &ft_glyph, (depth == 1)
+                ? FT_RENDER_MODE_NORMAL : FT_RENDER_MODE_LCD, 0, 1 );
+        if( error )
+            goto ft_error;
+
+        ft_bitmap_glyph = (FT_BitmapGlyph) ft_glyph;
+        ft_bitmap       = ft_bitmap_glyph->bitmap;
+        top             = ft_bitmap_glyph->top;
+        left            = ft_bitmap_glyph->left;
+    }
 
+    w = ft_bitmap.width / depth;
+    h = ft_bitmap.rows;
 
-        if( self->outline_type == 0 )
+    if( w && h && sdf )
+    {
+        // The field is bigger than the glyph by its spread on every side,
+        // and the glyph's bearings move out to match.
+        bitmap->buffer = malloc( (w + 2*spread) * (h + 2*spread) );
+        if( !bitmap->buffer || make_distance_field( bitmap->buffer,
+                    ft_bitmap.buffer, w, h, ft_bitmap.pitch, spread ) )
+            goto nomem;
+
+        w    += 2*spread;
+        h    += 2*spread;
+        left -= spread;
+        top  += spread;
+    }
+    else if( w && h )
+    {
+        // FreeType reuses its bitmap for the next glyph.
+        bitmap->buffer = malloc( w * depth * h );
+        if( !bitmap->buffer )
+            goto nomem;
+
+        for( row = 0; row < h; ++row )
+            memcpy( bitmap->buffer + row * w * depth,
+                    ft_bitmap.buffer + row * ft_bitmap.pitch, w * depth );
+    }
+
+    bitmap->width    = w;
+    bitmap->height   = h;
+    bitmap->offset_x = left;
+    bitmap->offset_y = top;
+
+    // Discard hinting to get advance
+    FT_Load_Glyph( face, glyph_index, FT_LOAD_NO_HINTING );
+    bitmap->advance_x = face->glyph->advance.x / HRESf;
+    bitmap->advance_y = face->glyph->advance.y / HRESf;
+
+    if( ft_glyph )
+        FT_Done_Glyph( ft_glyph );
+    if( stroker )
+        FT_Stroker_Done( stroker );
+    return 0;
+
+ft_error:
+    fprintf( stderr, "FT_Error (line %d, code 0x%02x) : %s\n",
+             __LINE__, FT_Errors[error].code, FT_Errors[error].message );
+    goto err;
+
+nomem:
+    fprintf( stderr, "line %d: No more memory for allocating data\n",
+             __LINE__ );
+    free( bitmap->buffer );
+    bitmap->buffer = NULL;
+
+err:
+    if( ft_glyph )
+        FT_Done_Glyph( ft_glyph );
+    if( stroker )
+        FT_Stroker_Done( stroker );
+    return -1;
+}
+
+static void
+kern_pair( texture_glyph_batch_t *batch, FT_Face face,
+           int32_t left, FT_UInt left_index,
+           int32_t right, FT_UInt right_index )
+{
+    FT_Vector kerning;
+    kerning_t pair;
+
+    FT_Get_Kerning( face, left_index, right_index,
+                    FT_KERNING_UNFITTED, &kerning );
+
+    if( !kerning.x )
+        return;
+
+    pair.left    = left;
+    pair.right   = right;
+    pair.kerning = kerning.x / (float)(HRESf*HRESf);
+    vector_push_back( batch->kerns, &pair );
+}
+
+static void
+kern_batch( texture_glyph_batch_t *batch, FT_Face face )
+{
+    FT_UInt *known, index;
+    size_t i, j;
+
+    if( !FT_HAS_KERNING( face ) )
+        return;
+
+    if( !(known = malloc( batch->nknown * sizeof(*known) )) )
+        return;
+
+    /* the background glyph doesn't have a character, and gets index 0
+     * (which never has kerning). */
+    for( j = 0; j < batch->nknown; ++j )
+        known[j] = (batch->known[j] == -1)
+            ? 0 : FT_Get_Char_Index( face, batch->known[j] );
+
+    for( i = 0; i < batch->count; ++i )
+    {
+        if( !(index = FT_Get_Char_Index( face, batch->charcodes[i] )) )
+            continue;
+
+        for( j = 0; j < batch->nknown; ++j )
         {
-            slot            = face->glyph;
-            ft_bitmap       = slot->bitmap;
-            ft_bitmap_width = slot->bitmap.width;
-            ft_bitmap_rows  = slot->bitmap.rows;
-            ft_bitmap_pitch = slot->bitmap.pitch;
-            ft_glyph_top    = slot->bitmap_top;
-            ft_glyph_left   = slot->bitmap_left;
+            if( !known[j] )
+                continue;
+
+            kern_pair( batch, face, batch->known[j], known[j],
+                       batch->charcodes[i], index );
+            kern_pair( batch, face, batch->charcodes[i], index,
+                       batch->known[j], known[j] );
         }
-        else
+    }
+
+    free( known );
+}
+
+void
+texture_glyph_batch_render( texture_glyph_batch_t *batch )
+{
+    FT_Library library;
+    FT_Face face;
+    size_t i;
+
+    if( !batch->count )
+        return;
+
+    if( !load_face( &batch->source, batch->size, &library, &face ) )
+    {
+        for( i = 0; i < batch->count; ++i )
+            batch->bitmaps[i].failed = 1;
+        return;
+    }
+
+    for( i = 0; i < batch->count; ++i )
+        if( render_glyph( batch, library, face,
+                    batch->charcodes[i], &batch->bitmaps[i] ) )
+            batch->bitmaps[i].failed = 1;
+
+    kern_batch( batch, face );
+
+    FT_Done_Face( face );
+    FT_Done_FreeType( library );
+}
+
+/* fills in a placeholder with a rendered glyph. returns -1 if the glyph
+ * couldn't be rendered or doesn't fit in the atlas, and is left empty. */
+static int
+place_glyph( texture_font_t *self, texture_glyph_t *glyph,
+             const glyph_bitmap_t *bitmap, size_t depth )
+{
+    ivec4 region;
+
+    glyph->pending = 0;
+    self->pending--;
+
+    /* glyphs that couldn't be rendered stay empty, and take up no
+     * space. */
+    if( bitmap->failed )
+    {
+        glyph->advance_x = 0.f;
+        return -1;
+    }
+
+    glyph->offset_x  = bitmap->offset_x;
+    glyph->offset_y  = bitmap->offset_y;
+    glyph->advance_x = bitmap->advance_x;
+    glyph->advance_y = bitmap->advance_y;
+
+    if( !bitmap->buffer )
+        return 0;
+
+    // We want each glyph to be separated by at least one black pixel
+    // (for example for shader used in demo-subpixel.c)
+    region = texture_atlas_get_region( self->atlas,
+            bitmap->width + 1, bitmap->height + 1 );
+    if( region.x < 0 )
+    {
+        fprintf( stderr, "Texture atlas is full (line %d)\n",  __LINE__ );
+        return -1;
+    }
+
+    texture_atlas_set_region( self->atlas, region.x, region.y,
+                              bitmap->width, bitmap->height,
+                              bitmap->buffer, bitmap->width * depth );
+
+    glyph->width  = bitmap->width;
+    glyph->height = bitmap->height;
+    glyph->s0     = region.x;
+    glyph->t0     = region.y;
+    glyph->s1     = region.x + glyph->width;
+    glyph->t1     = region.y + glyph->height;
+    return 0;
+}
+
+size_t
+texture_font_add_batch( texture_font_t *self, texture_glyph_batch_t *batch )
+{
+    texture_glyph_t *glyph;
+    kerning_t *pair;
+    size_t i, missed = 0;
+
+    for( i = 0; i < batch->count; ++i )
+    {
+        glyph = index_lookup( self, batch->charcodes[i],
+                batch->outline_type, batch->outline_thickness );
+
+        /* loaded some other way in the meantime. */
+        if( !glyph || !glyph->pending )
+            continue;
+
+        if( place_glyph( self, glyph, &batch->bitmaps[i], batch->depth ) )
+            missed++;
+    }
+
+    for( i = 0; i < vector_size( batch->kerns ); ++i )
+    {
+        pair = (kerning_t *) vector_get( batch->kerns, i );
+        kerning_insert( self, pair->left, pair->right, pair->kerning );
+    }
+
+    texture_atlas_upload( self->atlas );
+    return missed;
+}
+
+size_t
+texture_glyph_batch_count( const texture_glyph_batch_t *batch )
+{
+    return batch->count;
+}
+
+texture_glyph_t *
+texture_font_queue_glyph( texture_font_t *self, int32_t charcode )
+{
+    texture_glyph_t *glyph;
+
+    if( charcode == (int32_t)(-1) )
+        return texture_font_get_glyph( self, charcode );
+
+    if( charcode >= 0 && charcode < 256 )
+    {
+        glyph = self->latin1[charcode];
+
+        if( glyph && glyph_matches( glyph, charcode,
+                    self->outline_type, self->outline_thickness ) )
+            return glyph;
+    }
+
+    glyph = index_lookup( self, charcode,
+            self->outline_type, self->outline_thickness );
+    if( glyph )
+        return glyph;
+
+    if( !(glyph = add_placeholder( self, charcode )) )
+        return NULL;
+
+    vector_push_back( self->queued, &charcode );
+    return glyph;
+}
+
+texture_glyph_batch_t *
+texture_font_take_queued( texture_font_t *self )
+{
+    texture_glyph_batch_t *batch;
+
+    if( !vector_size( self->queued ) )
+        return NULL;
+
+    /* if this fails, the glyphs stay queued for next time. */
+    batch = batch_new( self, self->queued->items,
+                       vector_size( self->queued ) );
+    if( batch )
+        vector_clear( self->queued );
+
+    return batch;
+}
+
+texture_glyph_batch_t *
+texture_font_new_batch( texture_font_t *self, const int32_t *charcodes )
+{
+    return batch_new( self, charcodes, i32len( charcodes ) );
+}
+
+// ---------------------------------------------------------- packed glyphs ---
+
+/* a packed batch is a header, then the glyphs, then the kerning pairs,
+ * then the bitmaps. everything is in the machine's own byte order, and
+ * aligned to four bytes, so that it can be used straight out of a mapped
+ * file. */
+typedef struct
+{
+    uint32_t depth;
+    uint32_t count;
+    uint32_t nkerns;
+    uint32_t bitmap_bytes;
+} packed_header_t;
+
+typedef struct
+{
+    int32_t charcode;
+    uint32_t width;
+    uint32_t height;
+    int32_t offset_x;
+    int32_t offset_y;
+    float advance_x;
+    float advance_y;
+
+    /* where the bitmap starts, from the start of the bitmaps. */
+    uint32_t bitmap;
+} packed_glyph_t;
+
+void *
+texture_glyph_batch_pack( const texture_glyph_batch_t *batch, size_t *size )
+{
+    const glyph_bitmap_t *bitmap;
+    packed_header_t *header;
+    packed_glyph_t *glyphs;
+    unsigned char *bitmaps;
+    size_t i, bytes, nkerns;
+    void *data;
+
+    nkerns = vector_size( batch->kerns );
+
+    /* glyphs which failed might not fail next time. */
+    for( i = 0, bytes = 0; i < batch->count; ++i )
+    {
+        bitmap = &batch->bitmaps[i];
+
+        if( bitmap->failed )
+            return NULL;
+
+        if( bitmap->buffer )
+            bytes += bitmap->width * bitmap->height * batch->depth;
+    }
+
+    *size = sizeof(*header) + batch->count * sizeof(*glyphs)
+        + nkerns * sizeof(kerning_t) + bytes;
+
+    if( !(data = malloc( *size )) )
+        return NULL;
+
+    header  = data;
+    glyphs  = (packed_glyph_t *) (header + 1);
+    bitmaps = (unsigned char *) (glyphs + batch->count)
+        + nkerns * sizeof(kerning_t);
+
+    header->depth  = batch->depth;
+    header->count  = batch->count;
+    header->nkerns = nkerns;
+    header->bitmap_bytes = bytes;
+
+    if( nkerns )
+        memcpy( glyphs + batch->count, batch->kerns->items,
+                nkerns * sizeof(kerning_t) );
+
+    for( i = 0, bytes = 0; i < batch->count; ++i )
+    {
+        bitmap = &batch->bitmaps[i];
+
+        glyphs[i].charcode  = batch->charcodes[i];
+        glyphs[i].width     = bitmap->width;
+        glyphs[i].height    = bitmap->height;
+        glyphs[i].offset_x  = bitmap->offset_x;
+        glyphs[i].offset_y  = bitmap->offset_y;
+        glyphs[i].advance_x = bitmap->advance_x;
+        glyphs[i].advance_y = bitmap->advance_y;
+        glyphs[i].bitmap    = bytes;
+
+        if( !bitmap->buffer )
         {
-            FT_Stroker stroker;
-            FT_BitmapGlyph ft_bitmap_glyph;
-            error = FT_Stroker_New( library, &stroker );
-            if( error )
-            {
-                fprintf(stderr, "FT_Error (0x%02x) : %s\n",
-                        FT_Errors[error].code, FT_Errors[error].message);
-                FT_Done_Face( face );
-                FT_Stroker_Done( stroker );
-                FT_Done_FreeType( library );
-                return 0;
-            }
-            FT_Stroker_Set(stroker,
-                            (int)(self->outline_thickness * 64),
-                            FT_STROKER_LINECAP_ROUND,
-                            FT_STROKER_LINEJOIN_ROUND,
-                            0);
-            error = FT_Get_Glyph( face->glyph, &ft_glyph);
-            if( error )
-            {
-                fprintf(stderr, "FT_Error (0x%02x) : %s\n",
-                        FT_Errors[error].code, FT_Errors[error].message);
-                FT_Done_Face( face );
-                FT_Stroker_Done( stroker );
-                FT_Done_FreeType( library );
-                return 0;
-            }
-
-            if( self->outline_type == 1 )
-            {
-                error = FT_Glyph_Stroke( &ft_glyph, stroker, 1 );
-            }
-            else if ( self->outline_type == 2 )
-            {
-                error = FT_Glyph_StrokeBorder( &ft_glyph, stroker, 0, 1 );
-            }
-            else if ( self->outline_type == 3 )
-            {
-                error = FT_Glyph_StrokeBorder( &ft_glyph, stroker, 1, 1 );
-            }
-            if( error )
-            {
-                fprintf(stderr, "FT_Error (0x%02x) : %s\n",
-                        FT_Errors[error].code, FT_Errors[error].message);
-                FT_Done_Face( face );
-                FT_Stroker_Done( stroker );
-                FT_Done_FreeType( library );
-                return 0;
-            }
-
-            if( depth == 1)
-            {
-                error = FT_Glyph_To_Bitmap( &ft_glyph, FT_RENDER_MODE_NORMAL, 0, 1);
-                if( error )
-                {
-                    fprintf(stderr, "FT_Error (0x%02x) : %s\n",
-                            FT_Errors[error].code, FT_Errors[error].message);
-                    FT_Done_Face( face );
-                    FT_Stroker_Done( stroker );
-                    FT_Done_FreeType( library );
-                    return 0;
-                }
-            }
-            else
-            {
-                error = FT_Glyph_To_Bitmap( &ft_glyph, FT_RENDER_MODE_LCD, 0, 1);
-                if( error )
-                {
-                    fprintf(stderr, "FT_Error (0x%02x) : %s\n",
-                            FT_Errors[error].code, FT_Errors[error].message);
-                    FT_Done_Face( face );
-                    FT_Stroker_Done( stroker );
-                    FT_Done_FreeType( library );
-                    return 0;
-                }
-            }
-            ft_bitmap_glyph = (FT_BitmapGlyph) ft_glyph;
-            ft_bitmap       = ft_bitmap_glyph->bitmap;
-            ft_bitmap_width = ft_bitmap.width;
-            ft_bitmap_rows  = ft_bitmap.rows;
-            ft_bitmap_pitch = ft_bitmap.pitch;
-            ft_glyph_top    = ft_bitmap_glyph->top;
-            ft_glyph_left   = ft_bitmap_glyph->left;
-            FT_Stroker_Done(stroker);
+            glyphs[i].width = glyphs[i].height = 0;
+            continue;
         }
 
+        memcpy( bitmaps + bytes, bitmap->buffer,
+                bitmap->width * bitmap->height * batch->depth );
+        bytes += bitmap->width * bitmap->height * batch->depth;
+    }
 
-        // We want each glyph to be separated by at least one black pixel
-        // (for example for shader used in demo-subpixel.c)
-        w = ft_bitmap_width/depth + 1;
-        h = ft_bitmap_rows + 1;
-        region = texture_atlas_get_region( self->atlas, w, h );
-        if ( region.x < 0 )
+    return data;
+}
+
+int
+texture_font_load_packed( texture_font_t *self, const void *data,
+                          size_t size )
+{
+    const packed_header_t *header = data;
+    const packed_glyph_t *glyphs;
+    const unsigned char *bitmaps;
+    const kerning_t *kerns;
+    texture_glyph_t *glyph;
+    glyph_bitmap_t bitmap;
+    size_t i, bytes;
+    int missed = 0;
+
+    if( size < sizeof(*header) || header->depth != self->atlas->depth
+            || header->count > size / sizeof(*glyphs)
+            || header->nkerns > size / sizeof(*kerns) )
+        return -1;
+
+    glyphs  = (const packed_glyph_t *) (header + 1);
+    kerns   = (const kerning_t *) (glyphs + header->count);
+    bitmaps = (const unsigned char *) (kerns + header->nkerns);
+
+    if( sizeof(*header) + header->count * sizeof(*glyphs)
+            + header->nkerns * sizeof(*kerns)
+            + (size_t) header->bitmap_bytes != size )
+        return -1;
+
+    /* everything's checked before the font is touched, so that a bad
+     * file doesn't leave it half loaded. */
+    for( i = 0; i < header->count; ++i )
+    {
+        bytes = (size_t) glyphs[i].width * glyphs[i].height * header->depth;
+
+        if( glyphs[i].bitmap > header->bitmap_bytes
+                || bytes > header->bitmap_bytes - glyphs[i].bitmap )
+            return -1;
+    }
+
+    for( i = 0; i < header->count; ++i )
+    {
+        glyph = index_lookup( self, glyphs[i].charcode,
+                self->outline_type, self->outline_thickness );
+
+        if( glyph && !glyph->pending )
+            continue;
+        else if( !glyph && !(glyph = add_placeholder( self,
+                        glyphs[i].charcode )) )
         {
             missed++;
-            fprintf( stderr, "Texture atlas is full (line %d)\n",  __LINE__ );
             continue;
         }
-        w = w - 1;
-        h = h - 1;
-        x = region.x;
-        y = region.y;
-        texture_atlas_set_region( self->atlas, x, y, w, h,
-                                  ft_bitmap.buffer, ft_bitmap.pitch );
-
-        glyph = texture_glyph_new();
-
-		if (!glyph) {
-			missed = len - i;
-			break;
-		}
-
-        glyph->charcode = charcodes[i];
-        glyph->width    = w;
-        glyph->height   = h;
-        glyph->outline_type = self->outline_type;
-        glyph->outline_thickness = self->outline_thickness;
-        glyph->offset_x = ft_glyph_left;
-        glyph->offset_y = ft_glyph_top;
-        glyph->s0       = x/(float)width;
-        glyph->t0       = y/(float)height;
-        glyph->s1       = (x + glyph->width)/(float)width;
-        glyph->t1       = (y + glyph->height)/(float)height;
-
-        // Discard hinting to get advance
-        FT_Load_Glyph( face, glyph_index, FT_LOAD_RENDER | FT_LOAD_NO_HINTING);
-        slot = face->glyph;
-        glyph->advance_x = slot->advance.x / HRESf;
-        glyph->advance_y = slot->advance.y / HRESf;
-
-        vector_push_back( self->glyphs, &glyph );
-
-        if( self->outline_type > 0 )
-        {
-            FT_Done_Glyph( ft_glyph );
-        }
 
-		((void) ft_bitmap_pitch); /* shut up, gcc */
+        bitmap.width     = glyphs[i].width;
+        bitmap.height    = glyphs[i].height;
+        bitmap.offset_x  = glyphs[i].offset_x;
+        bitmap.offset_y  = glyphs[i].offset_y;
+        bitmap.advance_x = glyphs[i].advance_x;
+        bitmap.advance_y = glyphs[i].advance_y;
+        bitmap.failed    = 0;
+        bitmap.buffer    = (bitmap.width && bitmap.height)
+            ? (unsigned char *) bitmaps + glyphs[i].bitmap : NULL;
+
+        if( place_glyph( self, glyph, &bitmap, header->depth ) )
+            missed++;
     }
 
-    FT_Done_Face( face );
-    FT_Done_FreeType( library );
+    for( i = 0; i < header->nkerns; ++i )
+        kerning_insert( self, kerns[i].left, kerns[i].right,
+                        kerns[i].kerning );
+
     texture_atlas_upload( self->atlas );
-    texture_font_generate_kerning( self );
+    return missed;
+}
+
+// ----------------------------------------------- texture_font_load_glyphs ---
+size_t
+texture_font_load_glyphs( texture_font_t * self,
+                          const int32_t * charcodes )
+{
+    texture_glyph_batch_t *batch;
+    size_t missed;
+
+    assert( self );
+    assert( charcodes );
+
+    if( !(batch = texture_font_new_batch( self, charcodes )) )
+        return i32len( charcodes );
+
+    texture_glyph_batch_render( batch );
+    missed = texture_font_add_batch( self, batch );
+    texture_glyph_batch_delete( batch );
+
     return missed;
 }
 
@@ -646,39 +1274,33 @@ texture_glyph_t *
 texture_font_get_glyph( texture_font_t * self,
                         int32_t charcode )
 {
-    size_t i;
     int32_t buffer[2] = {0,0};
     texture_glyph_t *glyph;
 
-    assert( self );
-
     assert( self );
     assert( self->filename );
     assert( self->atlas );
 
-    /* Check if charcode has been already loaded */
-    for( i=0; i<self->glyphs->size; ++i )
-    {
-        glyph = *(texture_glyph_t **) vector_get( self->glyphs, i );
-        // If charcode is -1, we don't care about outline type or thickness
-        if( (glyph->charcode == charcode) &&
-            ((charcode == (int32_t)(-1) ) ||
-             ((glyph->outline_type == self->outline_type) &&
-              (glyph->outline_thickness == self->outline_thickness)) ))
-        {
+    /* the common case: ascii and latin-1 text with the font's usual
+     * outline. */
+    if (charcode >= 0 && charcode < 256) {
+        glyph = self->latin1[charcode];
+
+        if (glyph && glyph_matches(glyph, charcode,
+                    self->outline_type, self->outline_thickness))
             return glyph;
-        }
     }
 
     /* charcode -1 is special : it is used for line drawing (overline,
-     * underline, strikethrough) and background.
+     * underline, strikethrough) and background. it's created without an
+     * outline, and it's the same glyph whatever the font's outline is.
      */
     if( charcode == (int32_t)(-1) )
     {
-        size_t width  = self->atlas->width;
-        size_t height = self->atlas->height;
+        if ((glyph = index_lookup(self, charcode, 0, 0.f)))
+            return glyph;
+
         ivec4 region = texture_atlas_get_region( self->atlas, 5, 5 );
-        texture_glyph_t * glyph = texture_glyph_new( );
         static unsigned char data[4*4*3] = {-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
                                             -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
                                             -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
@@ -688,23 +1310,38 @@ texture_font_get_glyph( texture_font_t * self,
             fprintf( stderr, "Texture atlas is full (line %d)\n",  __LINE__ );
             return NULL;
         }
+        if (!(glyph = texture_glyph_new()))
+            return NULL;
         texture_atlas_set_region( self->atlas, region.x, region.y, 4, 4, data, 0 );
         glyph->charcode = (int32_t)(-1);
-        glyph->s0 = (region.x+2)/(float)width;
-        glyph->t0 = (region.y+2)/(float)height;
-        glyph->s1 = (region.x+3)/(float)width;
-        glyph->t1 = (region.y+3)/(float)height;
-        vector_push_back( self->glyphs, &glyph );
-        return glyph; //*(texture_glyph_t **) vector_back( self->glyphs );
+        glyph->s0 = region.x+2;
+        glyph->t0 = region.y+2;
+        glyph->s1 = region.x+3;
+        glyph->t1 = region.y+3;
+        add_glyph(self, glyph);
+        return glyph;
     }
 
-    /* Glyph has not been already loaded */
-    buffer[0] = charcode;
-    if(texture_font_load_glyphs(self, buffer) == 0)
+    glyph = index_lookup(self, charcode,
+            self->outline_type, self->outline_thickness);
+
+    /* Glyph has not been already loaded, or is still waiting on a batch */
+    if( !glyph || glyph->pending )
     {
-        return *(texture_glyph_t **) vector_back(self->glyphs);
+        buffer[0] = charcode;
+        texture_font_load_glyphs(self, buffer);
+
+        glyph = index_lookup(self, charcode,
+                self->outline_type, self->outline_thickness);
+
+        if (!glyph)
+            return NULL;
     }
-    return NULL;
+
+    if (charcode >= 0 && charcode < 256)
+        self->latin1[charcode] = glyph;
+
+    return glyph;
 }
 
 /* vim: set expandtab sw=4 ts=4 :*/
@@ -65,17 +65,20 @@ extern "C" {
 
 
 /**
- * A structure that hold a kerning value relatively to a charcode.
- *
- * This structure cannot be used alone since the (necessary) right charcode is
- * implicitely held by the owner of this structure.
+ * A structure that holds the kerning value for a pair of charcodes.
  */
 typedef struct
 {
     /**
-     * Left character code in the kern pair.
+     * Left character code in the kern pair. 0 marks an empty slot in
+     * the font's kerning table.
      */
-    int32_t charcode;
+    int32_t left;
+
+    /**
+     * Right character code in the kern pair.
+     */
+    int32_t right;
 
     /**
      * Kerning value (in fractional pixels).
@@ -173,30 +176,27 @@ typedef struct
     float advance_y;
 
     /**
-     * First normalized texture coordinate (x) of top-left corner
+     * Texture coordinate (x) of the top-left corner, in atlas pixels.
+     * These stay valid when the atlas grows; divide by the atlas size to
+     * normalize them.
      */
     float s0;
 
     /**
-     * Second normalized texture coordinate (y) of top-left corner
+     * Texture coordinate (y) of the top-left corner, in atlas pixels
      */
     float t0;
 
     /**
-     * First normalized texture coordinate (x) of bottom-right corner
+     * Texture coordinate (x) of the bottom-right corner, in atlas pixels
      */
     float s1;
 
     /**
-     * Second normalized texture coordinate (y) of bottom-right corner
+     * Texture coordinate (y) of the bottom-right corner, in atlas pixels
      */
     float t1;
 
-    /**
-     * A vector of kerning pairs relative to this glyph.
-     */
-    vector_t * kerning;
-
     /**
      * Glyph outline type (0 = None, 1 = line, 2 = inner, 3 = outer)
      */
@@ -207,10 +207,39 @@ typedef struct
      */
     float outline_thickness;
 
+    /**
+     * Set while the glyph is a placeholder, queued with
+     * texture_font_queue_glyph() and waiting on its batch. Until then it's
+     * empty, and its advance is a guess.
+     */
+    int pending;
+
 } texture_glyph_t;
 
 
 
+/**
+ * How a font's glyphs are rasterised into its atlas.
+ */
+typedef enum
+{
+    /**
+     * Coverage at the font's size, or subpixel coverage with an RGB atlas.
+     */
+    RENDER_NORMAL = 0,
+
+    /**
+     * A signed distance field (see distance-field.h), which can be drawn at
+     * any size. Needs an atlas with a depth of 1.
+     */
+    RENDER_SIGNED_DISTANCE_FIELD
+} rendermode_t;
+
+/**
+ * How far (in pixels) distance fields reach past the edges of their glyphs.
+ */
+#define TEXTURE_FONT_SDF_SPREAD 4
+
 /**
  *  Texture font structure.
  */
@@ -221,6 +250,44 @@ typedef struct
      */
     vector_t * glyphs;
 
+    /**
+     * Glyphs for codepoints below 256, indexed by codepoint. Only used
+     * when the glyph's outline matches the font's current one.
+     */
+    texture_glyph_t * latin1[256];
+
+    /**
+     * Open-addressed hash table over `glyphs`, keyed by codepoint,
+     * outline type and outline thickness. `size` is a power of two.
+     */
+    struct
+    {
+        texture_glyph_t ** slots;
+        size_t size;
+        size_t used;
+    } index;
+
+    /**
+     * Open-addressed hash table of the non-zero kerning pairs between
+     * the loaded glyphs, keyed by both charcodes. Each batch adds the
+     * pairs between its glyphs and every glyph the font had when the
+     * batch was made.
+     */
+    struct
+    {
+        kerning_t * pairs;
+        size_t size;
+        size_t used;
+    } kerns;
+
+    /**
+     * Charcodes queued by texture_font_queue_glyph() since the last
+     * texture_font_take_queued(), and how many of the font's glyphs are
+     * still placeholders.
+     */
+    vector_t * queued;
+    size_t pending;
+
     /**
      * Atlas structure to store glyphs data.
      */
@@ -274,6 +341,12 @@ typedef struct
      */
     int filtering;
 
+    /**
+     * How glyphs are rasterised. Set it right after creating the font,
+     * before any glyphs are loaded.
+     */
+    rendermode_t rendermode;
+
     /**
      * Whether to use kerning if available
      */
@@ -368,14 +441,14 @@ typedef struct
 
 
 /**
- * Request a new glyph from the font. If it has not been created yet, it will
- * be.
+ * Request a new glyph from the font. If it has not been created yet (or is
+ * still pending), it will be, right away.
  *
  * @param self     A valid texture font
  * @param charcode Character codepoint to be loaded.
  *
- * @return A pointer on the new glyph or 0 if the texture atlas is not big
- *         enough
+ * @return A pointer on the new glyph or 0 if the texture atlas is full and
+ *         can't grow any further
  *
  */
   texture_glyph_t *
@@ -389,24 +462,144 @@ typedef struct
  * @param self      a valid texture font
  * @param charcodes character codepoints to be loaded.
  *
- * @return Number of missed glyph if the texture is not big enough to hold
- *         every glyphs.
+ * @return Number of missed glyph if the texture is full and can't grow
+ *         enough to hold every glyphs.
  */
   size_t
   texture_font_load_glyphs( texture_font_t * self,
                             const int32_t * charcodes );
 
 /**
- * Get the kerning between two horizontal glyphs.
+ * Glyphs rendered apart from their font, to be added to it afterwards.
+ * Rendering a batch only touches the batch (and the font's file or memory,
+ * which has to outlive it), so it can be done on another thread while the
+ * font is used on this one.
+ */
+typedef struct texture_glyph_batch_t texture_glyph_batch_t;
+
+/**
+ * Like texture_font_get_glyph(), except that a glyph which hasn't been
+ * loaded yet is queued for the next batch and a placeholder is returned in
+ * its place. The placeholder is filled in when the batch is added.
  *
- * @param self      a valid texture glyph
- * @param charcode  codepoint of the peceding glyph
+ * @param self     A valid texture font
+ * @param charcode Character codepoint to be loaded.
+ *
+ * @return The glyph, which might be pending, or 0 if there's no memory
+ *         for a placeholder
+ */
+  texture_glyph_t *
+  texture_font_queue_glyph( texture_font_t * self,
+                            int32_t charcode );
+
+/**
+ * Takes the queued glyphs out of the font, as a batch.
+ *
+ * @param self     A valid texture font
+ *
+ * @return A batch to be rendered and added back to the font, or 0 if
+ *         nothing's queued (or there's no memory for the batch, in which
+ *         case the glyphs stay queued)
+ */
+  texture_glyph_batch_t *
+  texture_font_take_queued( texture_font_t * self );
+
+/**
+ * Makes a batch of the given glyphs, leaving out the ones the font has
+ * already rendered, with placeholders for the ones it didn't have.
+ *
+ * @param self      A valid texture font
+ * @param charcodes Character codepoints to be loaded.
+ *
+ * @return A batch to be rendered and added back to the font, or 0 if
+ *         there's no memory for it
+ */
+  texture_glyph_batch_t *
+  texture_font_new_batch( texture_font_t * self,
+                          const int32_t * charcodes );
+
+/**
+ * Renders the glyphs in a batch, and works out their kerning. Safe to call
+ * from any thread.
+ *
+ * @param batch    A batch from texture_font_take_queued()
+ */
+  void
+  texture_glyph_batch_render( texture_glyph_batch_t * batch );
+
+/**
+ * Puts the glyphs rendered by a batch in the font's atlas, filling in their
+ * placeholders, and uploads the atlas. Glyphs which have been loaded some
+ * other way since the batch was made are left alone.
+ *
+ * @param self     The font the batch was taken from
+ * @param batch    A rendered batch
+ *
+ * @return Number of glyphs which couldn't be rendered or didn't fit in the
+ *         atlas. They're left empty.
+ */
+  size_t
+  texture_font_add_batch( texture_font_t * self,
+                          texture_glyph_batch_t * batch );
+
+/**
+ * How many glyphs a batch renders.
+ */
+  size_t
+  texture_glyph_batch_count( const texture_glyph_batch_t * batch );
+
+/**
+ * Frees a batch, whether or not it was rendered or added.
+ */
+  void
+  texture_glyph_batch_delete( texture_glyph_batch_t * batch );
+
+/**
+ * Packs a rendered batch's glyphs and kerning into one flat block of
+ * memory, without any pointers, to be kept somewhere (a file, say) and
+ * loaded with texture_font_load_packed().
+ *
+ * @param batch    A rendered batch
+ * @param size     Set to the size of the block
+ *
+ * @return The block, to be freed with free(), or 0 if there's no memory
+ *         or any of the batch's glyphs couldn't be rendered
+ */
+  void *
+  texture_glyph_batch_pack( const texture_glyph_batch_t * batch,
+                            size_t * size );
+
+/**
+ * Loads glyphs packed by texture_glyph_batch_pack() into a font, as if
+ * their batch had been added to it. The font has to be the same face at
+ * the same size and settings as the batch's, which is up to the caller.
+ * The block isn't needed afterwards.
+ *
+ * @param self     A valid texture font
+ * @param data     A packed batch, aligned to four bytes
+ * @param size     The size of the packed batch
+ *
+ * @return -1 (without touching the font) if the block isn't a packed batch
+ *         for a font like this one, otherwise the number of glyphs which
+ *         didn't fit in the atlas
+ */
+  int
+  texture_font_load_packed( texture_font_t * self,
+                            const void * data, size_t size );
+
+/**
+ * Get the kerning between two horizontal glyphs. Both have to have been
+ * loaded already.
+ *
+ * @param self      a valid texture font
+ * @param left      codepoint of the preceding glyph
+ * @param right     codepoint of the following glyph
  *
  * @return x kerning value
  */
 float
-texture_glyph_get_kerning( const texture_glyph_t * self,
-                           const int32_t charcode );
+texture_font_get_kerning( const texture_font_t * self,
+                          int32_t left, int32_t right );
 
 
 /**
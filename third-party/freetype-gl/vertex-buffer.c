@@ -148,12 +148,17 @@ vertex_buffer_new( const char *format )
 
     self->vertices = vector_new( stride );
     self->vertices_id  = 0;
+    self->VAO_id = 0;
+    self->configured = 0;
     self->GPU_vsize = 0;
 
     self->indices = vector_new( sizeof(GLuint) );
     self->indices_id  = 0;
     self->GPU_isize = 0;
 
+    self->dirty_vstart = self->dirty_vend = 0;
+    self->dirty_istart = self->dirty_iend = 0;
+
     self->items = vector_new( sizeof(ivec4) );
     self->state = DIRTY;
     self->mode = GL_TRIANGLES;
@@ -196,6 +201,13 @@ vertex_buffer_delete( vertex_buffer_t *self )
     }
     self->indices_id = 0;
 
+    if( self->VAO_id )
+    {
+        glDeleteVertexArrays( 1, &self->VAO_id );
+    }
+    self->VAO_id = 0;
+    self->configured = 0;
+
     vector_delete( self->items );
 
     if( self->format )
@@ -276,59 +288,138 @@ vertex_buffer_print( vertex_buffer_t * self )
 
 
 // ----------------------------------------------------------------------------
-void
-vertex_buffer_upload ( vertex_buffer_t *self )
+static void
+add_range( size_t *start, size_t *end, size_t first, size_t last )
 {
-    if( self->state == FROZEN )
+    if( first >= last )
     {
         return;
     }
 
-    if( !self->vertices_id )
+    if( *start == *end )
     {
-        glGenBuffers( 1, &self->vertices_id );
+        *start = first;
+        *end = last;
+        return;
     }
-    if( !self->indices_id )
+
+    if( first < *start )
     {
-        glGenBuffers( 1, &self->indices_id );
+        *start = first;
     }
+    if( last > *end )
+    {
+        *end = last;
+    }
+}
 
-    size_t vsize = self->vertices->size*self->vertices->item_size;
-    size_t isize = self->indices->size*self->indices->item_size;
-
+static void
+upload_range( GLenum target, GLuint id, size_t *GPU_size,
+              const vector_t *data, size_t *start, size_t *end )
+{
+    size_t size = data->size*data->item_size;
+    size_t first, last;
 
-    // Always upload vertices first such that indices do not point to non
-    // existing data (if we get interrupted in between for example).
+    glBindBuffer( target, id );
 
-    // Upload vertices
-    glBindBuffer( GL_ARRAY_BUFFER, self->vertices_id );
-    if( vsize != self->GPU_vsize )
+    if( size > *GPU_size )
     {
-        glBufferData( GL_ARRAY_BUFFER,
-                      vsize, self->vertices->items, GL_DYNAMIC_DRAW );
-        self->GPU_vsize = vsize;
+        // Grow the buffer geometrically, so that one that's added to a
+        // little at a time isn't reallocated (and uploaded in full) for
+        // every addition.
+        *GPU_size = (*GPU_size*2 > size) ? *GPU_size*2 : size;
+        glBufferData( target, *GPU_size, NULL, GL_DYNAMIC_DRAW );
+        glBufferSubData( target, 0, size, data->items );
     }
     else
     {
-        glBufferSubData( GL_ARRAY_BUFFER,
-                         0, vsize, self->vertices->items );
+        first = *start*data->item_size;
+        last = (*end < data->size ? *end : data->size)*data->item_size;
+
+        if( last > first )
+        {
+            glBufferSubData( target, first, last - first,
+                             (const char *) data->items + first );
+        }
     }
-    glBindBuffer( GL_ARRAY_BUFFER, 0 );
 
-    // Upload indices
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, self->indices_id );
-    if( isize != self->GPU_isize )
+    glBindBuffer( target, 0 );
+    *start = *end = 0;
+}
+
+// Expects the vertex buffer's own vertex array to be bound, since the
+// element array binding belongs to whichever one is.
+static void
+upload_buffers( vertex_buffer_t *self )
+{
+    if( !self->vertices_id )
     {
-        glBufferData( GL_ELEMENT_ARRAY_BUFFER,
-                      isize, self->indices->items, GL_DYNAMIC_DRAW );
-        self->GPU_isize = isize;
+        glGenBuffers( 1, &self->vertices_id );
     }
-    else
+    if( !self->indices_id )
     {
-        glBufferSubData( GL_ELEMENT_ARRAY_BUFFER,
-                         0, isize, self->indices->items );
+        glGenBuffers( 1, &self->indices_id );
     }
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+    // Always upload vertices first such that indices do not point to non
+    // existing data (if we get interrupted in between for example).
+    // Only the parts that changed since the last upload are sent.
+    upload_range( GL_ARRAY_BUFFER, self->vertices_id, &self->GPU_vsize,
+                  self->vertices, &self->dirty_vstart, &self->dirty_vend );
+    upload_range( GL_ELEMENT_ARRAY_BUFFER, self->indices_id, &self->GPU_isize,
+                  self->indices, &self->dirty_istart, &self->dirty_iend );
+}
+
+static void
+bind_vertex_array( vertex_buffer_t *self )
+{
+    if( !self->VAO_id )
+    {
+        glGenVertexArrays( 1, &self->VAO_id );
+    }
+
+    glBindVertexArray( self->VAO_id );
+}
+
+void
+vertex_buffer_upload ( vertex_buffer_t *self )
+{
+    if( self->state == FROZEN )
+    {
+        return;
+    }
+
+    bind_vertex_array( self );
+    upload_buffers( self );
+    glBindVertexArray( 0 );
+}
+
+
+
+// ----------------------------------------------------------------------------
+void
+vertex_buffer_invalidate_vertices( vertex_buffer_t *self,
+                                   size_t first,
+                                   size_t last )
+{
+    assert( self );
+
+    self->state |= DIRTY;
+    add_range( &self->dirty_vstart, &self->dirty_vend, first, last );
+}
+
+
+
+// ----------------------------------------------------------------------------
+void
+vertex_buffer_invalidate_indices( vertex_buffer_t *self,
+                                  size_t first,
+                                  size_t last )
+{
+    assert( self );
+
+    self->state |= DIRTY;
+    add_range( &self->dirty_istart, &self->dirty_iend, first, last );
 }
 
 
@@ -343,6 +434,8 @@ vertex_buffer_clear( vertex_buffer_t *self )
     vector_clear( self->indices );
     vector_clear( self->vertices );
     vector_clear( self->items );
+    self->dirty_vstart = self->dirty_vend = 0;
+    self->dirty_istart = self->dirty_iend = 0;
     self->state = DIRTY;
 }
 
@@ -352,26 +445,36 @@ vertex_buffer_clear( vertex_buffer_t *self )
 void
 vertex_buffer_render_setup ( vertex_buffer_t *self, GLenum mode )
 {
+    bind_vertex_array( self );
+
     if( self->state != CLEAN )
     {
-        vertex_buffer_upload( self );
+        upload_buffers( self );
         self->state = CLEAN;
     }
-    
-    glBindBuffer( GL_ARRAY_BUFFER, self->vertices_id );
 
-    size_t i;
-    for( i=0; i<MAX_VERTEX_ATTRIBUTE; ++i )
+    // Attribute pointers are vertex array state, so they only need to be
+    // set up once.
+    if( !self->configured )
     {
-        vertex_attribute_t *attribute = self->attributes[i];
-        if ( attribute == 0 )
-        {
-            continue;
-        }
-        else
+        glBindBuffer( GL_ARRAY_BUFFER, self->vertices_id );
+
+        size_t i;
+        for( i=0; i<MAX_VERTEX_ATTRIBUTE; ++i )
         {
-            vertex_attribute_enable( attribute );
+            vertex_attribute_t *attribute = self->attributes[i];
+            if ( attribute == 0 )
+            {
+                continue;
+            }
+            else
+            {
+                vertex_attribute_enable( attribute );
+            }
         }
+
+        glBindBuffer( GL_ARRAY_BUFFER, 0 );
+        self->configured = 1;
     }
 
     if( self->indices->size )
@@ -385,8 +488,7 @@ vertex_buffer_render_setup ( vertex_buffer_t *self, GLenum mode )
 void
 vertex_buffer_render_finish ( vertex_buffer_t *self )
 {
-    glBindBuffer( GL_ARRAY_BUFFER, 0 );
-    glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+    glBindVertexArray( 0 );
 }
 
 
@@ -445,8 +547,9 @@ vertex_buffer_push_back_indices ( vertex_buffer_t * self,
 {
     assert( self );
 
-    self->state |= DIRTY;
     vector_push_back_data( self->indices, indices, icount );
+    vertex_buffer_invalidate_indices( self,
+            self->indices->size - icount, self->indices->size );
 }
 
 
@@ -459,8 +562,9 @@ vertex_buffer_push_back_vertices ( vertex_buffer_t * self,
 {
     assert( self );
 
-    self->state |= DIRTY;
     vector_push_back_data( self->vertices, vertices, vcount );
+    vertex_buffer_invalidate_vertices( self,
+            self->vertices->size - vcount, self->vertices->size );
 }
 
 
@@ -476,8 +580,8 @@ vertex_buffer_insert_indices ( vertex_buffer_t *self,
     assert( self->indices );
     assert( index < self->indices->size+1 );
 
-    self->state |= DIRTY;
     vector_insert_data( self->indices, index, indices, count );
+    vertex_buffer_invalidate_indices( self, index, self->indices->size );
 }
 
 
@@ -505,6 +609,8 @@ vertex_buffer_insert_vertices( vertex_buffer_t *self,
     }
 
     vector_insert_data( self->vertices, index, vertices, vcount );
+    vertex_buffer_invalidate_vertices( self, index, self->vertices->size );
+    vertex_buffer_invalidate_indices( self, 0, self->indices->size );
 }
 
 
@@ -520,8 +626,8 @@ vertex_buffer_erase_indices( vertex_buffer_t *self,
     assert( first < self->indices->size );
     assert( (last) <= self->indices->size );
 
-    self->state |= DIRTY;
     vector_erase_range( self->indices, first, last );
+    vertex_buffer_invalidate_indices( self, first, self->indices->size );
 }
 
 
@@ -547,7 +653,9 @@ vertex_buffer_erase_vertices( vertex_buffer_t *self,
             *(GLuint *)(vector_get( self->indices, i )) -= (last-first);
         }
     }
-    vector_erase_range( self->vertices, first, last );    
+    vector_erase_range( self->vertices, first, last );
+    vertex_buffer_invalidate_vertices( self, first, self->vertices->size );
+    vertex_buffer_invalidate_indices( self, 0, self->indices->size );
 }
 
 
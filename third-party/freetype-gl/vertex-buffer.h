@@ -73,12 +73,24 @@ typedef struct
     /** GL identity of the indices buffer. */
     GLuint indices_id;
 
-    /** Current size of the vertices buffer in GPU */
+    /** GL identity of the vertex array object. */
+    GLuint VAO_id;
+
+    /** Whether the vertex array's attributes have been set up. */
+    char configured;
+
+    /** Allocated size of the vertices buffer in GPU */
     size_t GPU_vsize;
 
-    /** Current size of the indices buffer in GPU*/
+    /** Allocated size of the indices buffer in GPU*/
     size_t GPU_isize;
 
+    /** Vertices that have changed since the last upload, [start, end). */
+    size_t dirty_vstart, dirty_vend;
+
+    /** Indices that have changed since the last upload, [start, end). */
+    size_t dirty_istart, dirty_iend;
+
     /** GL primitives to render. */
     GLenum mode;
 
@@ -184,7 +196,8 @@ typedef struct
 
 
 /**
- * Upload buffer to GPU memory.
+ * Upload buffer to GPU memory. The index buffer is bound in the vertex
+ * buffer's own vertex array, and no vertex array is left bound.
  *
  * @param  self  a vertex buffer
  */
@@ -201,6 +214,34 @@ typedef struct
   vertex_buffer_clear( vertex_buffer_t *self );
 
 
+/**
+ * Mark vertices that were changed in place (through vector_get() and the
+ * like) so that the next upload includes them.
+ *
+ * @param  self   a vertex buffer
+ * @param  first  the index of the first vertex that changed
+ * @param  last   the index after the last vertex that changed
+ */
+  void
+  vertex_buffer_invalidate_vertices( vertex_buffer_t *self,
+                                     size_t first,
+                                     size_t last );
+
+
+/**
+ * Mark indices that were changed in place so that the next upload
+ * includes them.
+ *
+ * @param  self   a vertex buffer
+ * @param  first  the index of the first index that changed
+ * @param  last   the index after the last index that changed
+ */
+  void
+  vertex_buffer_invalidate_indices( vertex_buffer_t *self,
+                                    size_t first,
+                                    size_t last );
+
+
 /**
  * Appends indices at the end of the buffer.
  *
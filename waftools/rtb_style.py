@@ -2,6 +2,8 @@
 
 from __future__ import print_function
 
+from collections import OrderedDict
+
 from waflib.Configure import conf
 
 from rutabaga_css import RutabagaStylesheet
@@ -25,7 +27,8 @@ def do_css2c(task):
         copyright + css2c_prelude
         + ("extern const struct rtb_style {var_name}[];\n"
            "extern const size_t {var_name}_size;\n"
-           "extern const size_t {var_name}_fonts;\n").format(var_name=var_name))
+           "extern const size_t {var_name}_fonts;\n"
+           "extern const size_t {var_name}_textures;\n").format(var_name=var_name))
 
     output_file(".c").write(
         copyright + css2c_prelude
@@ -33,7 +36,8 @@ def do_css2c(task):
         + "const struct rtb_style {var_name}[] = ".format(var_name=var_name)
         + stylesheet.c_repr(var_name)
         + "\n\nconst size_t {var_name}_size = sizeof({var_name});".format(var_name=var_name)
-        + "\nconst size_t {var_name}_fonts = {fonts_used};".format(var_name=var_name, fonts_used = stylesheet.fonts_used))
+        + "\nconst size_t {var_name}_fonts = {fonts_used};".format(var_name=var_name, fonts_used = stylesheet.fonts_used)
+        + "\nconst size_t {var_name}_textures = {textures_used};".format(var_name=var_name, textures_used = stylesheet.textures_used))
 
 ####
 # bin2c
@@ -57,7 +61,17 @@ def bin2c(binary, line_wrap=79, line_start=''):
         line_start + ", ".join([hexesc.format(chr_val(byte)) for byte in line])
             for line in batch_gen(binary, bytes_per_line)])
 
-def write_bin2c(header, data_file, data, var):
+def xz_compress(data):
+    import lzma
+
+    # the decoder only has to deal with CRC32, which every liblzma has.
+    return lzma.compress(data, format=lzma.FORMAT_XZ,
+            check=lzma.CHECK_CRC32, preset=9 | lzma.PRESET_EXTREME)
+
+def write_bin2c(header, data_file, data, var, compress=False):
+    if compress:
+        data = xz_compress(data)
+
     header.write(
         copyright + bin2h_prelude
         + "extern const uint8_t {0}[{1}];".format(var, len(data)))
@@ -76,6 +90,7 @@ def write_bin2c(header, data_file, data, var):
 def img2c_task(task):
     img = task.inputs[0].img
     c_var = task.inputs[0].asset_var
+    compress = task.inputs[0].compress
 
     output_file = lambda ext:\
         tuple(filter(matches_extension(ext), task.outputs))[0]
@@ -84,7 +99,8 @@ def img2c_task(task):
         data_file=output_file(".c"),
         header=output_file(".h"),
         data=img.data,
-        var=c_var)
+        var=c_var,
+        compress=compress)
 
 def img2c_rule(bld, asset, src):
     node = bld.path.find_resource(src)
@@ -93,10 +109,12 @@ def img2c_rule(bld, asset, src):
     img.from_bytes(node.read(flags="rb"))
 
     node.asset_var = asset.asset_var
+    node.compress = asset.compressed
     node.img = img
 
     asset.prop.width  = img.width
     asset.prop.height = img.height
+    asset.inflated_size = len(img.data)
 
     bld(
         rule=img2c_task,
@@ -111,6 +129,7 @@ def img2c_rule(bld, asset, src):
 
 def font2c_task(task):
     c_var = task.inputs[0].asset_var
+    compress = task.inputs[0].compress
     data = task.inputs[0].read(flags="rb")
 
     output_file = lambda ext:\
@@ -120,11 +139,17 @@ def font2c_task(task):
         data_file=output_file(".c"),
         header=output_file(".h"),
         data=data,
-        var=c_var)
+        var=c_var,
+        compress=compress)
 
 def font2c_rule(bld, asset, src):
+    from os.path import getsize
+
     node = bld.path.find_resource(src)
     node.asset_var = asset.asset_var
+    node.compress = asset.compressed
+
+    asset.inflated_size = getsize(node.abspath())
 
     bld(
         rule=font2c_task,
@@ -133,6 +158,158 @@ def font2c_rule(bld, asset, src):
         export_includes=".",
         update_outputs=True)
 
+####
+# texture atlases
+####
+
+# images up to this size are packed into atlases shared by the whole
+# style, so that drawing them never has to switch textures. bigger ones
+# (like the patchbay's tile, which is repeated across the canvas) keep a
+# texture of their own.
+ATLAS_MAX_IMAGE  = 64
+ATLAS_WIDTH      = 256
+ATLAS_MAX_HEIGHT = 256
+
+class TextureAtlas(object):
+    """Images packed onto shelves, tallest first. Each one gets a
+    one-pixel copy of its own edge around it, so linear filtering at its
+    edges never picks up its neighbours."""
+
+    def __init__(self, path, asset_var):
+        self.path = path
+        self.asset_var = asset_var
+
+        self.width  = ATLAS_WIDTH
+        self.height = 0
+        self.images = []
+        self.sources = []
+
+        self.shelf_x = 0
+        self.shelf_y = 0
+        self.shelf_h = 0
+
+    def place(self, img):
+        w, h = img.width + 2, img.height + 2
+
+        if self.shelf_x + w > self.width:
+            self.shelf_y += self.shelf_h
+            self.shelf_x = self.shelf_h = 0
+
+        if self.shelf_y + h > ATLAS_MAX_HEIGHT:
+            return None
+
+        x, y = self.shelf_x, self.shelf_y
+
+        self.shelf_x += w
+        self.shelf_h = max(self.shelf_h, h)
+        self.height  = max(self.height, y + h)
+
+        self.images.append((img, x, y))
+        return (x + 1, y + 1)
+
+    @property
+    def data(self):
+        stride = self.width * 4
+        atlas = bytearray(stride * self.height)
+
+        for img, x, y in self.images:
+            row_len = img.width * 4
+            rows = [img.data[r * row_len:(r + 1) * row_len]
+                    for r in range(img.height)]
+
+            for r, row in enumerate([rows[0]] + rows + [rows[-1]]):
+                row = row[:4] + row + row[-4:]
+                start = (y + r) * stride + x * 4
+                atlas[start:start + len(row)] = row
+
+        return bytes(atlas)
+
+def atlas2c_task(task):
+    atlas = task.generator.atlas
+
+    output_file = lambda ext:\
+        tuple(filter(matches_extension(ext), task.outputs))[0]
+
+    write_bin2c(
+        data_file=output_file(".c"),
+        header=output_file(".h"),
+        data=atlas.data,
+        var=atlas.asset_var,
+        compress=atlas.asset.compressed)
+
+def atlas2c_rule(bld, asset, src):
+    atlas = asset.atlas
+    asset.inflated_size = atlas.width * atlas.height * 4
+
+    bld(
+        rule=atlas2c_task,
+        source=[bld.path.find_resource(p) for p in atlas.sources],
+        target=[src + ".h", src + ".c"],
+        atlas=atlas,
+        export_includes=".",
+        update_outputs=True)
+
+def pack_textures(bld, style_name, css):
+    """Packs the small embedded images into atlases, and points the
+    properties using them at their atlas (and its texture slot)."""
+
+    images = OrderedDict()
+
+    for asset in css.embedded_assets:
+        if type(asset) != RutabagaEmbeddedTextureAsset \
+                or asset.path in images:
+            continue
+
+        node = bld.path.find_resource(
+                "{0}/{1}".format(style_name, asset.path))
+
+        img = TargaImage()
+        img.from_bytes(node.read(flags="rb"))
+        images[asset.path] = img
+
+    packable = [path for path in images
+            if images[path].bpp == 32
+                and images[path].width  <= ATLAS_MAX_IMAGE
+                and images[path].height <= ATLAS_MAX_IMAGE]
+
+    atlases = []
+    placed = {}
+
+    for path in sorted(packable, key=lambda p: -images[p].height):
+        for atlas in atlases:
+            at = atlas.place(images[path])
+            if at:
+                break
+        else:
+            n = len(atlases)
+            atlas = TextureAtlas("atlas_{0}".format(n), "ATLAS_{0}".format(n))
+            atlas.asset = RutabagaTextureAtlasAsset(atlas)
+            atlases.append(atlas)
+
+            at = atlas.place(images[path])
+
+        atlas.sources.append("{0}/{1}".format(style_name, path))
+        placed[path] = (atlas, at)
+
+    if not atlases:
+        return
+
+    assets = []
+
+    for asset in css.embedded_assets:
+        if type(asset) != RutabagaEmbeddedTextureAsset \
+                or asset.path not in placed:
+            assets.append(asset)
+            continue
+
+        img = images[asset.path]
+        asset.prop.width  = img.width
+        asset.prop.height = img.height
+        asset.prop.pack_into(*placed[asset.path])
+
+    css.embedded_assets = assets + [atlas.asset for atlas in atlases]
+    css.reassign_texture_slots()
+
 ####
 # css loader
 ####
@@ -141,14 +318,23 @@ def process_embedded_assets(bld, style_name, css):
     from rutabaga_css.properties.texture import RutabagaEmbeddedTextureAsset
     from rutabaga_css.font import RutabagaEmbeddedFontAsset
 
+    pack_textures(bld, style_name, css)
+
     sources = []
 
     for asset in css.embedded_assets:
         path  = "{0}/{1}".format(style_name, asset.path)
 
+        # with --compress-assets, they're decompressed the first time
+        # they're used. see rtb_asset_data().
+        asset.compressed = bool(bld.env.RTB_COMPRESS_ASSETS)
+
         if type(asset) == RutabagaEmbeddedTextureAsset:
             img2c_rule(bld, asset, path)
 
+        elif type(asset) == RutabagaTextureAtlasAsset:
+            atlas2c_rule(bld, asset, path)
+
         elif type(asset) == RutabagaEmbeddedFontAsset:
             font2c_rule(bld, asset, path)
 
@@ -35,6 +35,7 @@ all = [
     "RutabagaEmbeddedAsset",
 
     "RutabagaEmbeddedTextureAsset",
+    "RutabagaTextureAtlasAsset",
     "RutabagaEmbeddedFontAsset",
 
     "sanitize_c_variable"]
@@ -61,6 +62,44 @@ class RutabagaEmbeddedAsset(RutabagaAsset):
         self.header_path = None
         self.prop = prop
 
+        # set by the build if embedded assets are xz-compressed, in which
+        # case they're decompressed into `cache_var` on first use.
+        self.compressed = False
+        self.inflated_size = 0
+
+    @property
+    def cache_var(self):
+        return self.asset_var.lower() + "_cache"
+
+    c_buffer_tpl = (
+        ".loaded = 1",
+        ".location = RTB_ASSET_EMBEDDED",
+        ".compression = RTB_ASSET_UNCOMPRESSED",
+        ".buffer.allocated = 0",
+        ".buffer.data = {var}",
+        ".buffer.size = sizeof({var})")
+
+    c_xz_tpl = (
+        ".location = RTB_ASSET_EMBEDDED",
+        ".compression = RTB_ASSET_COMPRESSED_XZ",
+        ".compressor.xz.data = {var}",
+        ".compressor.xz.deflated_size = sizeof({var})",
+        ".compressor.xz.inflated_size = {size}",
+        ".compressor.xz.cache = &{cache}")
+
+    def c_buffer_repr(self, indent):
+        tpl = self.c_xz_tpl if self.compressed else self.c_buffer_tpl
+
+        return ",\n".join([indent + line.format(
+            var=self.asset_var,
+            size=self.inflated_size,
+            cache=self.cache_var) for line in tpl])
+
+    c_cache_tpl = "static struct rtb_asset_cache {0};"
+
+    def c_cache_repr(self):
+        return self.c_cache_tpl.format(self.cache_var)
+
     def __repr__(self):
         if self.header_path:
             return '<{0.__class__.__name__} embedding {1} as {2} (in {3})>'\
@@ -73,5 +112,13 @@ class RutabagaEmbeddedAsset(RutabagaAsset):
 class RutabagaEmbeddedTextureAsset(RutabagaEmbeddedAsset):
     pass
 
+class RutabagaTextureAtlasAsset(RutabagaEmbeddedAsset):
+    """Small images, packed together at build time. See pack_textures()
+    in rtb_style.py."""
+
+    def __init__(self, atlas):
+        RutabagaEmbeddedAsset.__init__(self, atlas.path, atlas.asset_var)
+        self.atlas = atlas
+
 class RutabagaEmbeddedFontAsset(RutabagaEmbeddedAsset):
     pass
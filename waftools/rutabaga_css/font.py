@@ -62,12 +62,7 @@ class RutabagaFontFace(object):
 static const struct rtb_style_font_face {def_var} = {{
 \t.family = "{family}",
 \t.weight = "{weight}",
-\t.loaded = 1,
-\t.location = RTB_ASSET_EMBEDDED,
-\t.compression = RTB_ASSET_UNCOMPRESSED,
-\t.buffer.allocated = 0,
-\t.buffer.data = {asset_var},
-\t.buffer.size = sizeof({asset_var})
+{buffer}
 }};"""
 
     def c_repr(self):
@@ -75,6 +70,6 @@ static const struct rtb_style_font_face {def_var} = {{
             family=self.family,
             weight=weight,
             def_var=self.weights[weight].descriptor_var,
-            asset_var=self.weights[weight].asset_var)
+            buffer=self.weights[weight].c_buffer_repr("\t"))
                 for weight in self.weights
                     if self.weights[weight].refcount > 0])
@@ -46,8 +46,15 @@ class RutabagaFontProperty(RutabagaStyleProperty):
         self.size   = size or 12
         self.gamma  = gamma
 
-        self.slot = stylesheet.fonts_used
-        stylesheet.fonts_used += 1
+        # every property asking for the same face, size, and gamma (in
+        # any state of any style) shares a slot in the window's fonts,
+        # so it's only loaded once.
+        key = (self.family, self.weight or 'normal', self.size, self.gamma)
+        if key not in stylesheet.font_slots:
+            stylesheet.font_slots[key] = stylesheet.fonts_used
+            stylesheet.fonts_used += 1
+
+        self.slot = stylesheet.font_slots[key]
 
         font = self.stylesheet.fonts[self.family]
         self.font_ref = font.use_weight(self.weight)
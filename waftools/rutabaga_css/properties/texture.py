@@ -44,6 +44,18 @@ class RutabagaTexture(object):
         self.path = path
         self.stylesheet = stylesheet
 
+        # every reference to the same image (or to images packed into the
+        # same atlas) shares a slot in the window's texture cache, so it
+        # only gets uploaded once.
+        self.slot_key = path
+        stylesheet.textures.append(self)
+
+        if path not in stylesheet.texture_slots:
+            stylesheet.texture_slots[path] = stylesheet.textures_used
+            stylesheet.textures_used += 1
+
+        self.slot = stylesheet.texture_slots[path]
+
 class RutabagaExternalTexture(RutabagaTexture):
     def __init__(self, stylesheet, path):
         super(RutabagaExternalTexture, self).__init__(stylesheet, path)
@@ -57,10 +69,13 @@ class RutabagaExternalTexture(RutabagaTexture):
 \t\t\t\t\t\t.location = RTB_ASSET_EXTERNAL,
 \t\t\t\t\t\t.compression = RTB_ASSET_UNCOMPRESSED,
 \t\t\t\t\t\t.external.path = "{0}",
+\t\t\t\t\t\t.external.map = 1,
+\t\t\t\t\t\t.slot = {slot},
 {extra}}}"""
 
     def c_repr(self, extra=''):
-        return self.c_repr_tpl.format(self.asset.path, extra=extra)
+        return self.c_repr_tpl.format(self.asset.path,
+                slot=self.slot, extra=extra)
 
 class RutabagaEmbeddedTexture(RutabagaTexture):
     def __init__(self, stylesheet, path):
@@ -69,28 +84,53 @@ class RutabagaEmbeddedTexture(RutabagaTexture):
         self.width  = 0
         self.height = 0
 
+        # set if the image has been packed into an atlas at build time,
+        # along with where in the atlas it went.
+        self.atlas = None
+        self.atlas_origin = (0, 0)
+
         self.texture_var = sanitize_c_variable(path).upper()
-        self.stylesheet.embedded_assets.append(
-            RutabagaEmbeddedTextureAsset(path, self.texture_var, self))
+        self.asset = RutabagaEmbeddedTextureAsset(path, self.texture_var, self)
+        self.stylesheet.embedded_assets.append(self.asset)
+
+    def pack_into(self, atlas, origin):
+        self.atlas = atlas
+        self.atlas_origin = origin
+
+        self.asset = atlas.asset
+        self.slot_key = atlas.path
 
     c_repr_tpl = """\
 \t\t\t\t\t.type = RTB_STYLE_PROP_TEXTURE,
 \t\t\t\t\t.texture = {{
-\t\t\t\t\t\t.loaded = 1,
-\t\t\t\t\t\t.location = RTB_ASSET_EMBEDDED,
-\t\t\t\t\t\t.compression = RTB_ASSET_UNCOMPRESSED,
-\t\t\t\t\t\t.buffer.allocated = 0,
-\t\t\t\t\t\t.buffer.data = {var},
-\t\t\t\t\t\t.buffer.size = sizeof({var}),
+{buffer},
 \t\t\t\t\t\t.w = {width},
 \t\t\t\t\t\t.h = {height},
+{atlas}\t\t\t\t\t\t.slot = {slot},
 {extra}}}"""
 
+    c_atlas_tpl = """\
+\t\t\t\t\t\t.atlas = {{
+\t\t\t\t\t\t\t.x = {origin[0]},
+\t\t\t\t\t\t\t.y = {origin[1]},
+\t\t\t\t\t\t\t.w = {atlas.width},
+\t\t\t\t\t\t\t.h = {atlas.height}
+\t\t\t\t\t\t}},
+"""
+
     def c_repr(self, extra=''):
+        atlas = ''
+        if self.atlas:
+            atlas = self.c_atlas_tpl.format(
+                atlas=self.atlas,
+                origin=self.atlas_origin)
+
         return self.c_repr_tpl.format(
-            var=self.texture_var,
+            buffer=self.asset.c_buffer_repr("\t" * 6),
             width=self.width,
             height=self.height,
+            atlas=atlas,
+            slot=self.slot,
             extra=extra)
 
 c_repr_extra = """\
@@ -63,8 +63,13 @@ class RutabagaStylesheet(object):
         self.external_assets = []
 
         self.fonts_used = 0
+        self.font_slots = {}
         self.fonts = {}
 
+        self.textures = []
+        self.textures_used = 0
+        self.texture_slots = {}
+
         if autoparse:
             self.parse()
 
@@ -205,15 +210,36 @@ class RutabagaStylesheet(object):
                 else:
                     bail(ptok)
 
+    def reassign_texture_slots(self):
+        """Numbers the texture slots again, once images have been packed
+        into atlases and share slots by atlas rather than by path."""
+
+        self.texture_slots = {}
+
+        for tex in self.textures:
+            if tex.slot_key not in self.texture_slots:
+                self.texture_slots[tex.slot_key] = len(self.texture_slots)
+
+            tex.slot = self.texture_slots[tex.slot_key]
+
+        self.textures_used = len(self.texture_slots)
+
     c_include_tpl = '#include "{header}"'
 
     def c_prelude(self):
-        return "\n\n".join((
+        # an image that's used more than once shares one cache.
+        caches = []
+        for a in self.embedded_assets:
+            if a.compressed and a.c_cache_repr() not in caches:
+                caches.append(a.c_cache_repr())
+
+        return "\n\n".join(filter(None, (
             "\n".join(
                 [self.c_include_tpl.format(header=a.header_path)
                     for a in self.embedded_assets]),
+            "\n".join(caches),
             "\n".join(
-                [self.fonts[face].c_repr() for face in self.fonts])))
+                [self.fonts[face].c_repr() for face in self.fonts]))))
 
     c_repr_tpl = """\
 {{